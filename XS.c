@@ -0,0 +1,2057 @@
+/*
+ * This file was generated automatically by ExtUtils::ParseXS version 3.45 from the
+ * contents of XS.xs. Do not edit this file, edit XS.xs instead.
+ *
+ *    ANY CHANGES MADE HERE WILL BE LOST!
+ *
+ */
+
+#line 1 "XS.xs"
+
+#include "EXTERN.h"
+#include "perl.h"
+#include "XSUB.h"
+/* We're not using anything for which we need ppport.h */
+
+#include <string.h>
+#include <gmp.h>
+
+#include "ptypes.h"
+#include "gmp_main.h"
+#include "small_factor.h"
+#include "ecm.h"
+#include "simpqs.h"
+#include "bls75.h"
+#include "ecpp.h"
+#include "utility.h"
+#include "stats.h"
+#include "factor.h"
+#define _GMP_ECM_FACTOR(n, f, b1, ncurves) \
+   _GMP_ecm_factor_projective(n, f, b1, 0, ncurves)
+
+
+/* Instead of trying to suck in lots of Math::BigInt::GMP and be terribly
+ * clever (and brittle), just do all C<->Perl bigints via strings.  It's
+ * crude but seems to work pretty well.
+ */
+
+/* The C code gives back its scratch temporaries (utility.h) before it
+ * returns, but a croak skips that.  So each XSUB, when it validates its
+ * input, saves the stack mark to be restored as the caller's scope unwinds.
+ * After a normal return this does nothing; after a croak caught by eval it
+ * hands back whatever the C code had taken. */
+static void _scratch_unwind(pTHX_ void* mark)
+{
+  if (PTR2UV(mark) < scratch_mark())
+    scratch_release(PTR2UV(mark));
+}
+
+static void validate_string_number(const char* f, const char* s)
+{
+  const char* p;
+  dTHX;
+  SAVEDESTRUCTOR_X(_scratch_unwind, INT2PTR(void*, scratch_mark()));
+  if (s == 0)
+    croak("%s: null string pointer as input", f);
+  if (*s == 0)
+    croak("%s: empty string as input", f);
+  p = s;
+  while (*p != 0) {
+    if (!isdigit(*p))
+      croak("%s: input '%s' must be a positive integer", f, s);
+    p++;
+  }
+}
+
+#define VALIDATE_AND_SET(func, var, str) \
+  validate_string_number(func " (" #var ")", str); \
+  mpz_init_set_str(var, str, 10);
+
+
+#line 72 "XS.c"
+#ifndef PERL_UNUSED_VAR
+#  define PERL_UNUSED_VAR(var) if (0) var = var
+#endif
+
+#ifndef dVAR
+#  define dVAR		dNOOP
+#endif
+
+
+/* This stuff is not part of the API! You have been warned. */
+#ifndef PERL_VERSION_DECIMAL
+#  define PERL_VERSION_DECIMAL(r,v,s) (r*1000000 + v*1000 + s)
+#endif
+#ifndef PERL_DECIMAL_VERSION
+#  define PERL_DECIMAL_VERSION \
+	  PERL_VERSION_DECIMAL(PERL_REVISION,PERL_VERSION,PERL_SUBVERSION)
+#endif
+#ifndef PERL_VERSION_GE
+#  define PERL_VERSION_GE(r,v,s) \
+	  (PERL_DECIMAL_VERSION >= PERL_VERSION_DECIMAL(r,v,s))
+#endif
+#ifndef PERL_VERSION_LE
+#  define PERL_VERSION_LE(r,v,s) \
+	  (PERL_DECIMAL_VERSION <= PERL_VERSION_DECIMAL(r,v,s))
+#endif
+
+/* XS_INTERNAL is the explicit static-linkage variant of the default
+ * XS macro.
+ *
+ * XS_EXTERNAL is the same as XS_INTERNAL except it does not include
+ * "STATIC", ie. it exports XSUB symbols. You probably don't want that
+ * for anything but the BOOT XSUB.
+ *
+ * See XSUB.h in core!
+ */
+
+
+/* TODO: This might be compatible further back than 5.10.0. */
+#if PERL_VERSION_GE(5, 10, 0) && PERL_VERSION_LE(5, 15, 1)
+#  undef XS_EXTERNAL
+#  undef XS_INTERNAL
+#  if defined(__CYGWIN__) && defined(USE_DYNAMIC_LOADING)
+#    define XS_EXTERNAL(name) __declspec(dllexport) XSPROTO(name)
+#    define XS_INTERNAL(name) STATIC XSPROTO(name)
+#  endif
+#  if defined(__SYMBIAN32__)
+#    define XS_EXTERNAL(name) EXPORT_C XSPROTO(name)
+#    define XS_INTERNAL(name) EXPORT_C STATIC XSPROTO(name)
+#  endif
+#  ifndef XS_EXTERNAL
+#    if defined(HASATTRIBUTE_UNUSED) && !defined(__cplusplus)
+#      define XS_EXTERNAL(name) void name(pTHX_ CV* cv __attribute__unused__)
+#      define XS_INTERNAL(name) STATIC void name(pTHX_ CV* cv __attribute__unused__)
+#    else
+#      ifdef __cplusplus
+#        define XS_EXTERNAL(name) extern "C" XSPROTO(name)
+#        define XS_INTERNAL(name) static XSPROTO(name)
+#      else
+#        define XS_EXTERNAL(name) XSPROTO(name)
+#        define XS_INTERNAL(name) STATIC XSPROTO(name)
+#      endif
+#    endif
+#  endif
+#endif
+
+/* perl >= 5.10.0 && perl <= 5.15.1 */
+
+
+/* The XS_EXTERNAL macro is used for functions that must not be static
+ * like the boot XSUB of a module. If perl didn't have an XS_EXTERNAL
+ * macro defined, the best we can do is assume XS is the same.
+ * Dito for XS_INTERNAL.
+ */
+#ifndef XS_EXTERNAL
+#  define XS_EXTERNAL(name) XS(name)
+#endif
+#ifndef XS_INTERNAL
+#  define XS_INTERNAL(name) XS(name)
+#endif
+
+/* Now, finally, after all this mess, we want an ExtUtils::ParseXS
+ * internal macro that we're free to redefine for varying linkage due
+ * to the EXPORT_XSUB_SYMBOLS XS keyword. This is internal, use
+ * XS_EXTERNAL(name) or XS_INTERNAL(name) in your code if you need to!
+ */
+
+#undef XS_EUPXS
+#if defined(PERL_EUPXS_ALWAYS_EXPORT)
+#  define XS_EUPXS(name) XS_EXTERNAL(name)
+#else
+   /* default to internal */
+#  define XS_EUPXS(name) XS_INTERNAL(name)
+#endif
+
+#ifndef PERL_ARGS_ASSERT_CROAK_XS_USAGE
+#define PERL_ARGS_ASSERT_CROAK_XS_USAGE assert(cv); assert(params)
+
+/* prototype to pass -Wmissing-prototypes */
+STATIC void
+S_croak_xs_usage(const CV *const cv, const char *const params);
+
+STATIC void
+S_croak_xs_usage(const CV *const cv, const char *const params)
+{
+    const GV *const gv = CvGV(cv);
+
+    PERL_ARGS_ASSERT_CROAK_XS_USAGE;
+
+    if (gv) {
+        const char *const gvname = GvNAME(gv);
+        const HV *const stash = GvSTASH(gv);
+        const char *const hvname = stash ? HvNAME(stash) : NULL;
+
+        if (hvname)
+	    Perl_croak_nocontext("Usage: %s::%s(%s)", hvname, gvname, params);
+        else
+	    Perl_croak_nocontext("Usage: %s(%s)", gvname, params);
+    } else {
+        /* Pants. I don't think that it should be possible to get here. */
+	Perl_croak_nocontext("Usage: CODE(0x%" UVxf ")(%s)", PTR2UV(cv), params);
+    }
+}
+#undef  PERL_ARGS_ASSERT_CROAK_XS_USAGE
+
+#define croak_xs_usage        S_croak_xs_usage
+
+#endif
+
+/* NOTE: the prototype of newXSproto() is different in versions of perls,
+ * so we define a portable version of newXSproto()
+ */
+#ifdef newXS_flags
+#define newXSproto_portable(name, c_impl, file, proto) newXS_flags(name, c_impl, file, proto, 0)
+#else
+#define newXSproto_portable(name, c_impl, file, proto) (PL_Sv=(SV*)newXS(name, c_impl, file), sv_setpv(PL_Sv, proto), (CV*)PL_Sv)
+#endif /* !defined(newXS_flags) */
+
+#if PERL_VERSION_LE(5, 21, 5)
+#  define newXS_deffile(a,b) Perl_newXS(aTHX_ a,b,file)
+#else
+#  define newXS_deffile(a,b) Perl_newXS_deffile(aTHX_ a,b)
+#endif
+
+#line 216 "XS.c"
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_set_verbose); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_set_verbose)
+{
+    dVAR; dXSARGS;
+    if (items != 1)
+       croak_xs_usage(cv,  "v");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+	int	v = (int)SvIV(ST(0))
+;
+#line 69 "XS.xs"
+     set_verbose_level(v);
+#line 231 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_set_threads); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_set_threads)
+{
+    dVAR; dXSARGS;
+    if (items != 1)
+       croak_xs_usage(cv,  "n");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+	int	n = (int)SvIV(ST(0))
+;
+#line 74 "XS.xs"
+     set_thread_count(n);
+#line 251 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_get_stats); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_get_stats)
+{
+    dVAR; dXSARGS;
+    if (items != 0)
+       croak_xs_usage(cv,  "");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 79 "XS.xs"
+    HV* hv;
+    int i;
+#line 270 "XS.c"
+#line 82 "XS.xs"
+    hv = newHV();
+    for (i = 0; i < STATS_NMETHODS; i++) {
+      stats_counter_t c;
+      const char* name = stats_method_name(i);
+      HV* mhv = newHV();
+      stats_get_counter(i, &c);
+      (void) hv_store(mhv, "calls",     5, newSVuv(c.calls), 0);
+      (void) hv_store(mhv, "successes", 9, newSVuv(c.successes), 0);
+      (void) hv_store(mhv, "seconds",   7, newSVnv(c.seconds), 0);
+      (void) hv_store(hv, name, strlen(name), newRV_noinc((SV*)mhv), 0);
+    }
+    XPUSHs(sv_2mortal(newRV_noinc((SV*)hv)));
+#line 284 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_reset_stats); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_reset_stats)
+{
+    dVAR; dXSARGS;
+    if (items != 0)
+       croak_xs_usage(cv,  "");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 98 "XS.xs"
+    stats_reset();
+#line 302 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_init); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_init)
+{
+    dVAR; dXSARGS;
+    if (items != 0)
+       croak_xs_usage(cv,  "");
+    {
+
+	_GMP_init();
+    }
+    XSRETURN_EMPTY;
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_destroy); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_destroy)
+{
+    dVAR; dXSARGS;
+    if (items != 0)
+       croak_xs_usage(cv,  "");
+    {
+
+	_GMP_destroy();
+    }
+    XSRETURN_EMPTY;
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_miller_rabin); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_miller_rabin)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items < 1)
+       croak_xs_usage(cv,  "strn, ...");
+    {
+#line 112 "XS.xs"
+    mpz_t n, a;
+    char* strbase;
+    int i;
+#line 349 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 116 "XS.xs"
+    validate_string_number("GMP_miller_rabin (n)", strn);
+    strbase = (items == 1) ? "2" : SvPV_nolen(ST(1));  /* default base = 2 */
+    validate_string_number("GMP_miller_rabin (base)", strbase);
+    for (i = 2; i < items; i++)
+      validate_string_number("GMP_miller_rabin (base)", SvPV_nolen(ST(i)));
+    /* Check every base before taking the shared context */
+    if (ix == 0) {
+      for (i = 1; i < items; i++) {
+        const char* sb = (i == 1) ? strbase : SvPV_nolen(ST(i));
+        while (sb[0] == '0' && sb[1] != 0)  sb++;
+        if (sb[1] == 0 && (sb[0] == '0' || sb[0] == '1'))
+          croak("Base %c is invalid", sb[0]);
+      }
+    }
+    if (strn[1] == 0) {
+      switch (strn[0]) {
+        case '2': case '3': case '5': case '7': XSRETURN_IV(1); break;
+        case '0': case '1': case '4': case '6': case '8': XSRETURN_IV(0); break;
+        default:  break; /* let 9 fall through */
+      }
+    }
+    mpz_init_set_str(n, strn, 10);
+    mpz_init_set_str(a, strbase, 10);
+    if (ix == 0) {
+      if (items <= 2 || mpz_even_p(n)) {
+        RETVAL = _GMP_miller_rabin(n, a);
+      } else {
+        /* Several bases share the n-1 = d*2^s setup */
+        mr_ctx_t ctx;
+        mr_ctx_init(&ctx, n);
+        RETVAL = mr_ctx_test(&ctx, a);
+        for (i = 2; RETVAL && i < items; i++) {
+          mpz_set_str(a, SvPV_nolen(ST(i)), 10);
+          RETVAL = mr_ctx_test(&ctx, a);
+        }
+        mr_ctx_destroy(&ctx);
+      }
+    } else {
+      mpz_t nm1; mpz_init(nm1); mpz_sub_ui(nm1, n, 1);
+      mpz_powm(a, a, nm1, n);
+      mpz_clear(nm1);
+      RETVAL = !mpz_cmp_ui(a,1);
+    }
+    mpz_clear(a);
+    mpz_clear(n);
+#line 400 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_miller_rabin_random); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_miller_rabin_random)
+{
+    dVAR; dXSARGS;
+    if (items < 2 || items > 3)
+       croak_xs_usage(cv,  "strn, nbases, seedstr= 0");
+    {
+#line 166 "XS.xs"
+    mpz_t n;
+#line 417 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char *	strn = (char *)SvPV_nolen(ST(0))
+;
+	UV	nbases = (UV)SvUV(ST(1))
+;
+	char *	seedstr;
+
+	if (items < 3)
+	    seedstr = 0;
+	else {
+	    seedstr = (char *)SvPV_nolen(ST(2))
+;
+	}
+#line 168 "XS.xs"
+    VALIDATE_AND_SET("miller_rabin_random", n, strn);
+    RETVAL = _GMP_miller_rabin_random(n, nbases, seedstr);
+    mpz_clear(n);
+#line 436 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+#define PRIMALITY_START(name, small_retval, test_small_factors) \
+    /* Negative numbers return 0 */ \
+    if ((strn != 0) && (strn[0] == '-') ) \
+      XSRETURN_IV(0); \
+    validate_string_number(name " (n)", strn); \
+    /* Handle single digit numbers */ \
+    if (strn[1] == 0) { \
+      int q_is_prime = 0; \
+      switch (strn[0]) { \
+        case '2': case '3': case '5': case '7': q_is_prime = small_retval; \
+                                                break; \
+      } \
+      XSRETURN_IV(q_is_prime); \
+    } \
+    /* Test for small multiples while it is still a string */ \
+    if (test_small_factors) { \
+      UV digsum = 0; \
+      int i, slen = strlen(strn); \
+      /* Multiples of 2 and 5 return 0 */ \
+      switch (strn[slen-1]-'0') { \
+        case 0: case 2: case 4: case 5: case 6: case 8: \
+           XSRETURN_IV(0); break; \
+      } \
+      /* Multiples of 3 return 0 */ \
+      for (i = 0; i < slen; i++)  digsum += strn[i]-'0'; \
+      if (digsum % 3 == 0)  XSRETURN_IV(0); \
+    } \
+    mpz_init_set_str(n, strn, 10);
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_lucas_pseudoprime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_lucas_pseudoprime)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    {
+#line 211 "XS.xs"
+    mpz_t n;
+#line 482 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 213 "XS.xs"
+    if ((strn != 0) && (strn[0] == '-') )
+      croak("Parameter '%s' must be a positive integer\n", strn);
+    PRIMALITY_START("is_lucas_pseudoprime", 1, 0);
+    switch (ix) {
+      case 0: RETVAL = _GMP_is_lucas_pseudoprime(n, 0); break;
+      case 1: RETVAL = _GMP_is_lucas_pseudoprime(n, 1); break;
+      case 2: RETVAL = _GMP_is_lucas_pseudoprime(n, 2); break;
+      case 3: RETVAL = _GMP_is_frobenius_underwood_pseudoprime(n); break;
+      case 4:
+      default:RETVAL = is_perrin_pseudoprime(n); break;
+    }
+    mpz_clear(n);
+#line 500 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_almost_extra_strong_lucas_pseudoprime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_almost_extra_strong_lucas_pseudoprime)
+{
+    dVAR; dXSARGS;
+    if (items < 1 || items > 2)
+       croak_xs_usage(cv,  "strn, increment= 1");
+    {
+#line 231 "XS.xs"
+    mpz_t n;
+#line 517 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	UV	increment;
+
+	if (items < 2)
+	    increment = 1;
+	else {
+	    increment = (UV)SvUV(ST(1))
+;
+	}
+#line 233 "XS.xs"
+    if ((strn != 0) && (strn[0] == '-') )
+      croak("Parameter '%s' must be a positive integer\n", strn);
+    if (increment == 0 || increment > 65535)
+      croak("Increment parameter must be >0 and < 65536");
+    PRIMALITY_START("is_almost_extra_strong_lucas_pseudoprime", 1, 0);
+    RETVAL = _GMP_is_almost_extra_strong_lucas_pseudoprime(n, increment);
+    mpz_clear(n);
+#line 538 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_frobenius_pseudoprime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_frobenius_pseudoprime)
+{
+    dVAR; dXSARGS;
+    if (items < 1 || items > 3)
+       croak_xs_usage(cv,  "strn, P= 0, Q= 0");
+    {
+#line 246 "XS.xs"
+    mpz_t n;
+#line 555 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	IV	P;
+	IV	Q;
+
+	if (items < 2)
+	    P = 0;
+	else {
+	    P = (IV)SvIV(ST(1))
+;
+	}
+
+	if (items < 3)
+	    Q = 0;
+	else {
+	    Q = (IV)SvIV(ST(2))
+;
+	}
+#line 248 "XS.xs"
+    if ((strn != 0) && (strn[0] == '-') )
+      croak("Parameter '%s' must be a positive integer\n", strn);
+    PRIMALITY_START("is_frobenius_pseudoprime", 1, 0);
+    RETVAL = is_frobenius_pseudoprime(n, P, Q);
+    mpz_clear(n);
+#line 582 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_prime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_prime)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    {
+#line 267 "XS.xs"
+    mpz_t n;
+    int ret;
+#line 601 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 270 "XS.xs"
+    /* Returns arg for single-dig primes, 0 for multiples of 2, 3, 5, or neg */
+    PRIMALITY_START("is_prime", 2, 1);
+    switch (ix) {
+      case 0: ret = _GMP_is_prime(n); break;
+      case 1: ret = _GMP_is_prob_prime(n); break;
+      case 2: ret = _GMP_is_aks_prime(n); break;
+      case 3: ret = llr(n); break;
+      case 4: ret = _GMP_primality_bls_nm1(n, 100, 0); break;
+      case 5: ret = _GMP_ecpp(n, 0); break;
+      case 6: ret = _GMP_BPSW(n); break;
+      case 7:
+      default:ret = _GMP_primality_bls_np1(n, 100, 0); break;
+    }
+    RETVAL = ret;
+    mpz_clear(n);
+#line 622 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__is_provable_prime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__is_provable_prime)
+{
+    dVAR; dXSARGS;
+    if (items < 1 || items > 2)
+       croak_xs_usage(cv,  "strn, wantproof= 0");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 292 "XS.xs"
+    int result;
+    mpz_t n;
+#line 642 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	int	wantproof;
+
+	if (items < 2)
+	    wantproof = 0;
+	else {
+	    wantproof = (int)SvIV(ST(1))
+;
+	}
+#line 295 "XS.xs"
+    PRIMALITY_START("is_provable_prime", 2, 1);
+    if (wantproof == 0) {
+      result = _GMP_is_provable_prime(n, 0);
+      XPUSHs(sv_2mortal(newSViv( result )));
+    } else {
+      char* prooftext = 0;
+      result = _GMP_is_provable_prime(n, &prooftext);
+      XPUSHs(sv_2mortal(newSViv( result )));
+      if (prooftext) {
+        XPUSHs(sv_2mortal(newSVpv(prooftext, 0)));
+        Safefree(prooftext);
+      } else {
+        XPUSHs(sv_2mortal(newSVpv("", 0)));
+      }
+    }
+    mpz_clear(n);
+#line 670 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__prove_with_factors); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__prove_with_factors)
+{
+    dVAR; dXSARGS;
+    if (items < 2)
+       croak_xs_usage(cv,  "strn, np1, ...");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 315 "XS.xs"
+    int i, nf, result;
+    mpz_t n, *f;
+    char* prooftext = 0;
+#line 690 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	int	np1 = (int)SvIV(ST(1))
+;
+#line 319 "XS.xs"
+    VALIDATE_AND_SET("_prove_with_factors", n, strn);
+    nf = items - 2;
+    New(0, f, nf+1, mpz_t);
+    for (i = 0; i < nf; i++) {
+      char* strf = SvPV_nolen(ST(2+i));
+      validate_string_number("_prove_with_factors", strf);
+      mpz_init_set_str(f[i], strf, 10);
+    }
+    if (!np1)
+      result = _GMP_primality_bls_nm1_known(n, f, nf, &prooftext);
+    else
+      result = _GMP_primality_bls_np1_known(n, f, nf, &prooftext);
+    for (i = 0; i < nf; i++)  mpz_clear(f[i]);
+    Safefree(f);
+    mpz_clear(n);
+    XPUSHs(sv_2mortal(newSViv( result )));
+    if (prooftext) {
+      XPUSHs(sv_2mortal(newSVpv(prooftext, 0)));
+      Safefree(prooftext);
+    } else {
+      XPUSHs(sv_2mortal(newSVpv("", 0)));
+    }
+#line 718 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__validate_ecpp_curve); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__validate_ecpp_curve)
+{
+    dVAR; dXSARGS;
+    if (items != 7)
+       croak_xs_usage(cv,  "stra, strb, strn, strpx, strpy, strm, strq");
+    {
+#line 345 "XS.xs"
+    mpz_t a, n, px, py, m, q, t1, t2;
+#line 734 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	stra = (char *)SvPV_nolen(ST(0))
+;
+	char*	strb = (char *)SvPV_nolen(ST(1))
+;
+	char*	strn = (char *)SvPV_nolen(ST(2))
+;
+	char*	strpx = (char *)SvPV_nolen(ST(3))
+;
+	char*	strpy = (char *)SvPV_nolen(ST(4))
+;
+	char*	strm = (char *)SvPV_nolen(ST(5))
+;
+	char*	strq = (char *)SvPV_nolen(ST(6))
+;
+#line 347 "XS.xs"
+    VALIDATE_AND_SET("_validate_ecpp_curve", a, stra);
+    /* ignore b */
+    VALIDATE_AND_SET("_validate_ecpp_curve", n, strn);
+    VALIDATE_AND_SET("_validate_ecpp_curve", px, strpx);
+    VALIDATE_AND_SET("_validate_ecpp_curve", py, strpy);
+    VALIDATE_AND_SET("_validate_ecpp_curve", m, strm);
+    VALIDATE_AND_SET("_validate_ecpp_curve", q, strq);
+    mpz_init(t1);  mpz_init(t2);
+    RETVAL = (ecpp_check_point(px, py, m, q, a, n, t1, t2) == 2) ? 1 : 0;
+    mpz_clear(t1); mpz_clear(t2);
+    mpz_clear(a); mpz_clear(n); mpz_clear(px); mpz_clear(py);
+    mpz_clear(m); mpz_clear(q);
+#line 764 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_power); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_is_power)
+{
+    dVAR; dXSARGS;
+    if (items < 1 || items > 2)
+       croak_xs_usage(cv,  "strn, a= 0");
+    {
+#line 365 "XS.xs"
+    mpz_t n;
+    int isneg;
+#line 782 "XS.c"
+	UV	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	UV	a;
+
+	if (items < 2)
+	    a = 0;
+	else {
+	    a = (UV)SvUV(ST(1))
+;
+	}
+#line 368 "XS.xs"
+    isneg = (strn[0] == '-');
+    if (isneg) strn++;
+    validate_string_number("is_power (n)", strn);
+    RETVAL = 0;
+    if (!isneg || (a == 0 || a & 1)) {
+      mpz_init_set_str(n, strn, 10);
+      RETVAL = is_power(n, a);
+      mpz_clear(n);
+    }
+    if (isneg && a == 0 && RETVAL != 0) {
+      UV r = RETVAL;
+      while (!(r & 1)) r >>= 1;
+      RETVAL = (r == 1) ? 0 : r;
+    }
+#line 810 "XS.c"
+	XSprePUSH;
+	PUSHu((UV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+#define XPUSH_MPZ(n) \
+  do { \
+    /* Push as a scalar if <= min(ULONG_MAX,UV_MAX), string otherwise */ \
+    UV _v = mpz_get_ui(n); \
+    if (!mpz_cmp_ui(n, _v)) { \
+      XPUSHs(sv_2mortal(newSVuv( _v ))); \
+    } else { \
+      char* str; \
+      int nsize = mpz_sizeinbase(n, 10) + 2; \
+      New(0, str, nsize, char); \
+      mpz_get_str(str, 10, n); \
+      XPUSHs(sv_2mortal(newSVpv(str, 0))); \
+      Safefree(str); \
+    } \
+  } while (0)
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_next_prime); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_next_prime)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 407 "XS.xs"
+    mpz_t n;
+#line 845 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 409 "XS.xs"
+    VALIDATE_AND_SET("next_prime", n, strn);
+
+    if (ix == 0) _GMP_next_prime(n);
+    else         _GMP_prev_prime(n);
+
+    XPUSH_MPZ(n);
+    mpz_clear(n);
+#line 856 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_prime_count); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_prime_count)
+{
+    dVAR; dXSARGS;
+    if (items != 2)
+       croak_xs_usage(cv,  "strlow, strhigh");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 421 "XS.xs"
+    mpz_t low, high, count;
+#line 874 "XS.c"
+	char*	strlow = (char *)SvPV_nolen(ST(0))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(1))
+;
+#line 423 "XS.xs"
+    VALIDATE_AND_SET("prime_count", low, strlow);
+    VALIDATE_AND_SET("prime_count", high, strhigh);
+    mpz_init_set_ui(count, 0);
+
+    if (mpz_cmp(low, high) <= 0) {
+      mpz_t curprime;
+      mpz_init_set(curprime, low);
+      if (mpz_cmp_ui(curprime, 2) >= 0)
+        mpz_sub_ui(curprime, curprime, 1);  /* Make sure low gets included */
+      _GMP_next_prime(curprime);
+      while (mpz_cmp(curprime, high) <= 0) {
+        mpz_add_ui(count, count, 1);
+        _GMP_next_prime(curprime);
+      }
+      mpz_clear(curprime);
+    }
+    XPUSH_MPZ(count);
+    mpz_clear(count);
+    mpz_clear(high);
+    mpz_clear(low);
+#line 900 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_primorial); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_primorial)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 456 "XS.xs"
+    mpz_t res, n;
+    UV un;
+#line 920 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 459 "XS.xs"
+    if (strn != 0 && strn[0] == '-') { /* If input is negative... */
+      if (ix == 3)  XSRETURN_IV(1);    /* exp_mangoldt return 1 */
+      if (ix == 8)  strn++;            /* znprimroot flip sign */
+    }
+    VALIDATE_AND_SET("primorial", n, strn);
+    un = mpz_get_ui(n);
+    mpz_init(res);
+    switch (ix) {
+      case 0:  _GMP_primorial(res, n);  break;
+      case 1:  _GMP_pn_primorial(res, un);  break;
+      case 2:  _GMP_lcm_of_consecutive_integers(un, res);  break;
+      case 3:  exp_mangoldt(res, n);  break;
+      case 4:  totient(res, n);  break;
+      case 5:  carmichael_lambda(res, n);  break;
+      case 6:  mpz_fac_ui(res, un);  break;  /* Uses swing, so let's use it */
+      case 7:  bernfrac(n, res, n);
+               XPUSH_MPZ(n);
+               break;
+      case 8:
+      default: znprimroot(res, n);  break;
+    }
+    if (ix == 8 && !mpz_sgn(res) && mpz_cmp_ui(n,1) != 0)
+      {  mpz_clear(n);  mpz_clear(res);  XSRETURN_UNDEF;  }
+    XPUSH_MPZ(res);
+    mpz_clear(n);
+    mpz_clear(res);
+#line 950 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_gcd); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_gcd)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    PERL_UNUSED_VAR(cv); /* -W */
+    PERL_UNUSED_VAR(items); /* -W */
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 495 "XS.xs"
+    int i;
+    mpz_t ret, n;
+#line 970 "XS.c"
+#line 498 "XS.xs"
+    if (items == 0) XSRETURN_IV( (ix == 3) ? 1 : 0);
+    if (ix == 3) {
+      mpz_t* list;
+      New(0, list, items, mpz_t);
+      for (i = 0; i < items; i++) {
+        char* strn = SvPV_nolen(ST(i));
+        validate_string_number("vecprod", (strn[0]=='-') ? strn+1 : strn);
+        mpz_init_set_str(list[i], strn, 10);
+      }
+      mpz_product(list, 0, items-1);
+      XPUSH_MPZ(list[0]);
+      for (i = 0; i < items; i++)  mpz_clear(list[i]);
+      Safefree(list);
+      XSRETURN(1);
+    }
+    mpz_init(n);
+    mpz_init_set_ui(ret, (ix == 1 || ix == 3) ? 1 : 0);
+    for (i = 0; i < items; i++) {
+      char* strn = SvPV_nolen(ST(i));
+      validate_string_number("gcd/lcm", (strn[0]=='-') ? strn+1 : strn);
+      if (ix <= 1 && strn != 0 && strn[0] == '-') strn++;
+      mpz_set_str(n, strn, 10);
+      switch (ix) {
+        case 0:  mpz_gcd(ret, ret, n); break;
+        case 1:  mpz_lcm(ret, ret, n); break;
+        case 2:  mpz_add(ret, ret, n); break;
+        case 3:
+        default: mpz_mul(ret, ret, n); break;
+      }
+    }
+    XPUSH_MPZ(ret);
+    mpz_clear(n);
+    mpz_clear(ret);
+#line 1005 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_kronecker); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_kronecker)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 2)
+       croak_xs_usage(cv,  "stra, strb");
+    {
+#line 537 "XS.xs"
+    mpz_t a, b;
+#line 1022 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	stra = (char *)SvPV_nolen(ST(0))
+;
+	char*	strb = (char *)SvPV_nolen(ST(1))
+;
+#line 539 "XS.xs"
+    validate_string_number("kronecker", (stra[0]=='-') ? stra+1 : stra);
+    validate_string_number("kronecker", (strb[0]=='-') ? strb+1 : strb);
+    mpz_init_set_str(a, stra, 10);
+    mpz_init_set_str(b, strb, 10);
+    if (ix == 0) {
+      RETVAL = mpz_kronecker(a, b);
+    } else {
+      mpz_abs(a,a);
+      mpz_abs(b,b);
+      if (mpz_cmp_ui(a,1) <= 0 || mpz_cmp_ui(b,1) <= 0)
+        RETVAL = 0;
+      else
+        RETVAL = mpz_remove(a, a, b);
+    }
+    mpz_clear(b);
+    mpz_clear(a);
+#line 1046 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_moebius); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_moebius)
+{
+    dVAR; dXSARGS;
+    if (items < 1 || items > 2)
+       croak_xs_usage(cv,  "strn, stro= 0");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 561 "XS.xs"
+    mpz_t n;
+#line 1065 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	char*	stro;
+
+	if (items < 2)
+	    stro = 0;
+	else {
+	    stro = (char *)SvPV_nolen(ST(1))
+;
+	}
+#line 563 "XS.xs"
+    VALIDATE_AND_SET("moebius", n, strn);
+    if (stro == 0) {
+      int result = moebius(n);
+      mpz_clear(n);
+      XSRETURN_IV(result);
+    } else {   /* Ranged result */
+      mpz_t nhi;
+      VALIDATE_AND_SET("moebius high value", nhi, stro);
+      while (mpz_cmp(n, nhi) <= 0) {
+        XPUSHs(sv_2mortal(newSViv( moebius(n) )));
+        mpz_add_ui(n, n, 1);
+      }
+      mpz_clear(n);
+      mpz_clear(nhi);
+    }
+#line 1092 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucasu); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucasu)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 3)
+       croak_xs_usage(cv,  "P, Q, strk");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 584 "XS.xs"
+    mpz_t u, v, k;
+#line 1111 "XS.c"
+	IV	P = (IV)SvIV(ST(0))
+;
+	IV	Q = (IV)SvIV(ST(1))
+;
+	char*	strk = (char *)SvPV_nolen(ST(2))
+;
+#line 586 "XS.xs"
+    VALIDATE_AND_SET("lucasu/lucasv", k, strk);
+    /* We could call mpz_fib_ui / mpz_lucnum_ui when P=1,Q=-1,
+     * but it is only 10-15% faster so let's not special case. */
+    mpz_init(u);  mpz_init(v);
+    lucasuv(u, v, P, Q, k);
+    XPUSH_MPZ( ((ix == 0) ? u : v) );
+    mpz_clear(v); mpz_clear(u);
+    mpz_clear(k);
+#line 1127 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucasumod); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucasumod)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items < 3)
+       croak_xs_usage(cv,  "P, Q, strn, ...");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 600 "XS.xs"
+    lucas_ctx_t ctx;
+    mpz_t n, *k, *r;
+    int i, nk;
+#line 1148 "XS.c"
+	IV	P = (IV)SvIV(ST(0))
+;
+	IV	Q = (IV)SvIV(ST(1))
+;
+	char*	strn = (char *)SvPV_nolen(ST(2))
+;
+#line 604 "XS.xs"
+    nk = items - 3;
+    for (i = 0; i < nk; i++)
+      validate_string_number("lucasumod (k)", SvPV_nolen(ST(i+3)));
+    VALIDATE_AND_SET("lucasumod", n, strn);
+    lucas_ctx_init(&ctx, n, P, Q);
+    mpz_clear(n);
+    if (nk <= 0) { lucas_ctx_destroy(&ctx); XSRETURN_EMPTY; }
+    New(0, k, nk, mpz_t);
+    New(0, r, nk, mpz_t);
+    for (i = 0; i < nk; i++) {
+      mpz_init_set_str(k[i], SvPV_nolen(ST(i+3)), 10);
+      mpz_init(r[i]);
+    }
+    lucas_ctx_seq_multi(&ctx, (ix == 0) ? r : 0, (ix == 0) ? 0 : r, k, nk);
+    lucas_ctx_destroy(&ctx);
+    for (i = 0; i < nk; i++) {
+      XPUSH_MPZ(r[i]);
+      mpz_clear(r[i]);
+      mpz_clear(k[i]);
+    }
+    Safefree(r);
+    Safefree(k);
+#line 1178 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_liouville); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_liouville)
+{
+    dVAR; dXSARGS;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    {
+#line 630 "XS.xs"
+    mpz_t n;
+#line 1194 "XS.c"
+	int	RETVAL;
+	dXSTARG;
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 632 "XS.xs"
+    VALIDATE_AND_SET("liouville", n, strn);
+    RETVAL = liouville(n);
+    mpz_clear(n);
+#line 1203 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_invmod); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_invmod)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 2)
+       croak_xs_usage(cv,  "stra, strb");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 646 "XS.xs"
+    mpz_t a, b, t;
+    int retundef;
+#line 1224 "XS.c"
+	char*	stra = (char *)SvPV_nolen(ST(0))
+;
+	char*	strb = (char *)SvPV_nolen(ST(1))
+;
+#line 649 "XS.xs"
+    validate_string_number("invmod", (stra[0]=='-') ? stra+1 : stra);
+    validate_string_number("invmod", (strb[0]=='-') ? strb+1 : strb);
+    mpz_init_set_str(a, stra, 10);
+    mpz_init_set_str(b, strb, 10);
+    retundef = 0;
+    if (ix == 0) {
+      /* undef if a|b is zero, 0 if b is 1, otherwise result of mpz_invert */
+      if (!mpz_sgn(b) || !mpz_sgn(a))  retundef = 1;
+      else if (!mpz_cmp_ui(b,1))       mpz_set_ui(a,0);
+      else                             retundef = !mpz_invert(a,a,b);
+    } else if (ix == 1) {
+      unsigned long n, k;
+      if (mpz_sgn(b) < 0) {   /* Handle negative k */
+        if (mpz_sgn(a) >= 0 || mpz_cmp(b,a) > 0)  mpz_set_ui(a, 0);
+        else                                      mpz_sub(b, a, b);
+      }
+      n = mpz_get_ui(a);
+      k = mpz_get_ui(b);
+      if (k > n || k == 0 || k == n || mpz_sgn(a) < 0) {
+        mpz_bin_ui(a, a, k);
+      } else {
+        if (k > n/2) k = n-k;
+        /* Note: mpz_bin_uiui is *much* faster than mpz_bin_ui.  It is a
+         * bit faster than our code for small values, and a tiny bit slower
+         * for larger values. */
+        if (n > 50000 && k > 1000)  binomial(a, n, k);
+        else                        mpz_bin_uiui(a, n, k);
+      }
+    } else if (ix == 2) {
+      mpz_init(t);
+      mpz_gcdext(a, t, b, a, b);
+      XPUSH_MPZ(t);  XPUSH_MPZ(b);
+      mpz_clear(t);
+    } else if (ix == 3) {
+      jordan_totient(a, b, mpz_get_ui(a));
+    } else {
+      znorder(a, a, b);
+      if (!mpz_sgn(a)) retundef = 1;
+    }
+    if (!retundef) XPUSH_MPZ(a);
+    mpz_clear(b); mpz_clear(a);
+    if (retundef) XSRETURN_UNDEF;
+#line 1272 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_partitions); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_partitions)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items != 1)
+       croak_xs_usage(cv,  "n");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 697 "XS.xs"
+    UV i, j, k;
+#line 1291 "XS.c"
+	UV	n = (UV)SvUV(ST(0))
+;
+#line 699 "XS.xs"
+    if (ix == 2) {
+      XSRETURN_IV(lucas_lehmer(n));
+    } else if (ix == 1) {
+      if (n == 1)
+        XSRETURN_IV(3);
+      else if (n > 0) {
+        char* pi = pidigits(n);
+        XPUSHs(sv_2mortal(newSVpvn(pi, n+1)));
+        Safefree(pi);
+      }
+    } else if (n == 0) {
+      XPUSHs(sv_2mortal(newSVuv( 1 )));
+    } else if (n <= 3) {
+      XPUSHs(sv_2mortal(newSVuv( n )));
+    } else {
+      mpz_t psum;
+      mpz_t* part;
+      UV* pent;
+      UV d = (UV) sqrt(n+1);
+
+      New(0, pent, 2*d+2, UV);
+      pent[0] = 0;
+      pent[1] = 1;
+      for (i = 1; i <= d; i++) {
+        pent[2*i  ] = ( i   *(3*i+1)) / 2;
+        pent[2*i+1] = ((i+1)*(3*i+2)) / 2;
+      }
+      New(0, part, n+1, mpz_t);
+      mpz_init_set_ui(part[0], 1);
+      mpz_init(psum);
+      for (j = 1; j <= n; j++) {
+        mpz_set_ui(psum, 0);
+        for (k = 1; pent[k] <= j; k++) {
+          if ((k+1) & 2) mpz_add(psum, psum, part[ j - pent[k] ]);
+          else           mpz_sub(psum, psum, part[ j - pent[k] ]);
+        }
+        mpz_init_set(part[j], psum);
+      }
+      mpz_clear(psum);
+      XPUSH_MPZ( part[n] );
+      for (i = 0; i <= n; i++)
+        mpz_clear(part[i]);
+      Safefree(part);
+      Safefree(pent);
+    }
+#line 1340 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__pidigits_fd); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__pidigits_fd)
+{
+    dVAR; dXSARGS;
+    if (items != 2)
+       croak_xs_usage(cv,  "n, fd");
+    {
+	int	RETVAL;
+	dXSTARG;
+	UV	n = (UV)SvUV(ST(0))
+;
+	int	fd = (int)SvIV(ST(1))
+;
+#line 748 "XS.xs"
+    /* Pi(n) streamed to a file descriptor, without the string in memory */
+    RETVAL = pidigits_fd(n, fd);
+#line 1363 "XS.c"
+	XSprePUSH;
+	PUSHi((IV)RETVAL);
+    }
+    XSRETURN(1);
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_stirling); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_stirling)
+{
+    dVAR; dXSARGS;
+    if (items < 2 || items > 3)
+       croak_xs_usage(cv,  "n, m, type= 1");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 756 "XS.xs"
+    mpz_t r;
+#line 1382 "XS.c"
+	UV	n = (UV)SvUV(ST(0))
+;
+	UV	m = (UV)SvUV(ST(1))
+;
+	UV	type;
+
+	if (items < 3)
+	    type = 1;
+	else {
+	    type = (UV)SvUV(ST(2))
+;
+	}
+#line 758 "XS.xs"
+    mpz_init(r);
+    stirling(r, n, m, type);
+    XPUSH_MPZ( r );
+    mpz_clear(r);
+#line 1400 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_trial_primes); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_trial_primes)
+{
+    dVAR; dXSARGS;
+    if (items != 2)
+       croak_xs_usage(cv,  "strlow, strhigh");
+    {
+#line 766 "XS.xs"
+    mpz_t low, high;
+    AV* av = newAV();
+#line 1417 "XS.c"
+	SV *	RETVAL;
+	char*	strlow = (char *)SvPV_nolen(ST(0))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(1))
+;
+#line 769 "XS.xs"
+    VALIDATE_AND_SET("trial_primes", low, strlow);
+    VALIDATE_AND_SET("trial_primes", high, strhigh);
+
+    if (mpz_cmp(low, high) <= 0) {
+      mpz_t curprime;
+      char* str;
+      int nsize = mpz_sizeinbase(high, 10) + 2;
+
+      New(0, str, nsize, char);
+      if (str == 0)  croak("Could not allocate space for return string");
+
+      mpz_init_set(curprime, low);
+      if (mpz_cmp_ui(curprime, 2) >= 0)
+        mpz_sub_ui(curprime, curprime, 1);  /* Make sure low gets included */
+      _GMP_next_prime(curprime);
+
+      while (mpz_cmp(curprime, high) <= 0) {
+        UV v = mpz_get_ui(curprime);     /* mpz_fits_ulong_p is nice, but if */
+        if (!mpz_cmp_ui(curprime, v)) {  /* UV_MAX < ULONG_MAX then it fails */
+          av_push(av,newSVuv(v));
+        } else {
+          mpz_get_str(str, 10, curprime);
+          av_push(av,newSVpv(str, 0));
+        }
+        _GMP_next_prime(curprime);
+      }
+      Safefree(str);
+      mpz_clear(curprime);
+    }
+    mpz_clear(low);
+    mpz_clear(high);
+    RETVAL = newRV_noinc( (SV*) av );
+#line 1456 "XS.c"
+	RETVAL = sv_2mortal(RETVAL);
+	ST(0) = RETVAL;
+    }
+    XSRETURN(1);
+}
+
+#define TSTAVAL(arr, val)   (arr[(val) >> 6] & (1U << (((val)>>1) & 0x1F)))
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_primes); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_primes)
+{
+    dVAR; dXSARGS;
+    if (items < 2 || items > 3)
+       croak_xs_usage(cv,  "strlow, strhigh, k= 0");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 809 "XS.xs"
+    mpz_t low, high, t;
+    UV i, length;
+    int test_primality;
+    uint32_t* comp;
+#line 1479 "XS.c"
+	char*	strlow = (char *)SvPV_nolen(ST(0))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(1))
+;
+	UV	k;
+
+	if (items < 3)
+	    k = 0;
+	else {
+	    k = (UV)SvUV(ST(2))
+;
+	}
+#line 814 "XS.xs"
+    VALIDATE_AND_SET("sieve_primes", low, strlow);
+    VALIDATE_AND_SET("sieve_primes", high, strhigh);
+    test_primality = 0;
+    if (k < 2) {
+      test_primality = 1;
+      k = 5000 * mpz_sizeinbase(high,2);
+    }
+
+    if (mpz_cmp_ui(low, k) < 0)    croak("TODO: small sieves");
+    if (mpz_even_p(low))           mpz_add_ui(low, low, 1);
+    if (mpz_even_p(high))          mpz_sub_ui(high, high, 1);
+
+    if (mpz_cmp(low, high) <= 0) {
+      mpz_init(t);
+
+      mpz_sqrt(t, high);           /* No need for k to be > sqrt(high) */
+      if (mpz_cmp_ui(t, k) < 0)
+        k = mpz_get_ui(t);
+
+      mpz_sub(t, high, low);
+      length = mpz_get_ui(t) + 1;
+
+      /* Get bit array of odds marked with composites(k) marked with 1 */
+      comp = partial_sieve(low, length, k);
+      /* Convert to corresponding mpz and send to output */
+      for (i = 1; i <= length; i += 2) {
+        if (!TSTAVAL(comp, i)) {
+          mpz_add_ui(t, low, i);
+          if (!test_primality || _GMP_BPSW(t))
+            XPUSH_MPZ( t );
+        }
+      }
+      mpz_clear(t);
+      Safefree(comp);
+    }
+    mpz_clear(low);
+    mpz_clear(high);
+#line 1530 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_prime_cluster); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_prime_cluster)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items < 2)
+       croak_xs_usage(cv,  "strlow, strhigh, ...");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 857 "XS.xs"
+    mpz_t low, high, t;
+    UV i, nforms, nlist, *mult, *list;
+    IV *add;
+#line 1551 "XS.c"
+	char*	strlow = (char *)SvPV_nolen(ST(0))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(1))
+;
+#line 861 "XS.xs"
+    VALIDATE_AND_SET("sieve_prime_cluster", low, strlow);
+    VALIDATE_AND_SET("sieve_prime_cluster", high, strhigh);
+    for (i = 2; i < (UV)items; i++)
+      validate_string_number("sieve_prime_cluster (offset)", SvPV_nolen(ST(i)));
+    if (ix == 0) {                       /* n, n+o1, n+o2, ... */
+      nforms = items - 1;
+      New(0, mult, nforms, UV);
+      New(0, add, nforms, IV);
+      mult[0] = 1;  add[0] = 0;
+      for (i = 1; i < nforms; i++) {
+        UV o = SvUV(ST(i+1));
+        if (o > (UV)IV_MAX)  croak("sieve_prime_cluster: offset too large");
+        mult[i] = 1;  add[i] = o;
+      }
+    } else {                             /* length, kind 1 (2p+1) or 2 (2p-1) */
+      UV kind = (items > 3) ? SvUV(ST(3)) : 1;
+      nforms = (items > 2) ? SvUV(ST(2)) : 2;
+      if (nforms < 1 || nforms >= BITS_PER_WORD-1)
+        croak("sieve_cunningham_chain: length must be 1 to %d", BITS_PER_WORD-2);
+      if (kind != 1 && kind != 2)
+        croak("sieve_cunningham_chain: kind must be 1 or 2");
+      New(0, mult, nforms, UV);
+      New(0, add, nforms, IV);
+      for (i = 0; i < nforms; i++) {
+        mult[i] = UVCONST(1) << i;
+        add[i] = (kind == 1) ? (IV)(mult[i]-1) : -(IV)(mult[i]-1);
+      }
+    }
+    list = sieve_cluster(low, high, nforms, mult, add, &nlist);
+    Safefree(add);
+    Safefree(mult);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_add_ui(t, low, list[i]);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(low);
+    mpz_clear(high);
+#line 1597 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_polynomial); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_sieve_polynomial)
+{
+    dVAR; dXSARGS;
+    if (items < 2)
+       croak_xs_usage(cv,  "strlow, strhigh, ...");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 905 "XS.xs"
+    mpz_t low, high, t, *coef;
+    UV i, deg, nlist, *list;
+#line 1616 "XS.c"
+	char*	strlow = (char *)SvPV_nolen(ST(0))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(1))
+;
+#line 908 "XS.xs"
+    if (items < 3)
+      croak("Usage: sieve_polynomial(low, high, c_d, ..., c_1, c_0)");
+    VALIDATE_AND_SET("sieve_polynomial", low, strlow);
+    VALIDATE_AND_SET("sieve_polynomial", high, strhigh);
+    deg = items - 3;
+    New(0, coef, deg+1, mpz_t);
+    for (i = 0; i <= deg; i++) {         /* given highest degree first */
+      char* strc = SvPV_nolen(ST(2+deg-i));
+      validate_string_number("sieve_polynomial", (strc[0]=='-') ? strc+1 : strc);
+      mpz_init_set_str(coef[i], strc, 10);
+    }
+    list = sieve_polynomial(low, high, deg, coef, &nlist);
+    for (i = 0; i <= deg; i++)  mpz_clear(coef[i]);
+    Safefree(coef);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_add_ui(t, low, list[i]);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(low);
+    mpz_clear(high);
+#line 1645 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_primes_in_ap); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_primes_in_ap)
+{
+    dVAR; dXSARGS;
+    if (items != 4)
+       croak_xs_usage(cv,  "stra, strd, strlow, strhigh");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 935 "XS.xs"
+    mpz_t a, d, low, high, first, t;
+    UV i, nlist, *list;
+#line 1664 "XS.c"
+	char*	stra = (char *)SvPV_nolen(ST(0))
+;
+	char*	strd = (char *)SvPV_nolen(ST(1))
+;
+	char*	strlow = (char *)SvPV_nolen(ST(2))
+;
+	char*	strhigh = (char *)SvPV_nolen(ST(3))
+;
+#line 938 "XS.xs"
+    VALIDATE_AND_SET("primes_in_ap", a, stra);
+    VALIDATE_AND_SET("primes_in_ap", d, strd);
+    VALIDATE_AND_SET("primes_in_ap", low, strlow);
+    VALIDATE_AND_SET("primes_in_ap", high, strhigh);
+    mpz_init(first);
+    list = primes_in_ap(first, a, d, low, high, &nlist);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_set(t, d);
+      mpz_mul_ui(t, t, list[i]);
+      mpz_add(t, t, first);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(first);
+    mpz_clear(a);  mpz_clear(d);  mpz_clear(low);  mpz_clear(high);
+#line 1691 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucas_sequence); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_lucas_sequence)
+{
+    dVAR; dXSARGS;
+    if (items != 4)
+       croak_xs_usage(cv,  "strn, P, Q, strk");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 959 "XS.xs"
+    mpz_t U, V, Qk, n, k, t;
+#line 1709 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+	IV	P = (IV)SvIV(ST(1))
+;
+	IV	Q = (IV)SvIV(ST(2))
+;
+	char*	strk = (char *)SvPV_nolen(ST(3))
+;
+#line 961 "XS.xs"
+    VALIDATE_AND_SET("lucas_sequence", n, strn);
+    VALIDATE_AND_SET("lucas_sequence", k, strk);
+    mpz_init(U);  mpz_init(V);  mpz_init(Qk);  mpz_init(t);
+
+    _GMP_lucas_seq(U, V, n, P, Q, k, Qk, t);
+    XPUSH_MPZ(U);
+    XPUSH_MPZ(V);
+    XPUSH_MPZ(Qk);
+
+    mpz_clear(n);  mpz_clear(k);
+    mpz_clear(U);  mpz_clear(V);  mpz_clear(Qk);  mpz_clear(t);
+#line 1730 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+#define SET_UV_VIA_MPZ_STRING(uva, sva, name) \
+  { \
+      mpz_t t; \
+      char* stra = SvPV_nolen(sva); \
+      validate_string_number(name, stra); \
+      mpz_init_set_str(t, stra, 10); \
+      uva = mpz_get_ui(t); \
+      mpz_clear(t); \
+  }
+
+XS_EUPXS(XS_Math__Prime__Util__GMP_trial_factor); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP_trial_factor)
+{
+    dVAR; dXSARGS;
+    dXSI32;
+    if (items < 1)
+       croak_xs_usage(cv,  "strn, ...");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 996 "XS.xs"
+    mpz_t n;
+    UV arg1, arg2, uf;
+    static const UV default_arg1[] =
+       {0,    64000000,64000000,5000000,5000000,256000000,16000000,0,  0  };
+     /* Trial,Rho,     Brent,   P-1,    P+1,    HOLF,     SQUFOF,  ECM,QS */
+#line 1762 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 1002 "XS.xs"
+    VALIDATE_AND_SET(" specific factor", n, strn);
+    {
+      int cmpr = mpz_cmp_ui(n,1);
+      if (cmpr <= 0) {
+        mpz_clear(n);
+        XSRETURN_IV( (cmpr < 0)  ?  0  :  1 );
+      }
+    }
+    arg1 = default_arg1[ix];
+    arg2 = 0;
+    if (items >= 2) SET_UV_VIA_MPZ_STRING(arg1, ST(1), "specific factor arg 1");
+    if (items >= 3) SET_UV_VIA_MPZ_STRING(arg2, ST(2), "specific factor arg 2");
+    while (mpz_even_p(n)) {
+      XPUSHs(sv_2mortal(newSVuv(2)));
+      mpz_divexact_ui(n, n, 2);
+    }
+    while (mpz_divisible_ui_p(n, 3)) {
+      XPUSHs(sv_2mortal(newSVuv(3)));
+      mpz_divexact_ui(n, n, 3);
+    }
+    while (mpz_divisible_ui_p(n, 5)) {
+      XPUSHs(sv_2mortal(newSVuv(5)));
+      mpz_divexact_ui(n, n, 5);
+    }
+    if (mpz_cmp_ui(n,1) > 0 && !_GMP_is_prob_prime(n)) {
+      mpz_t f;
+      int success = 0;
+
+      mpz_init(f);
+      switch (ix) {
+        case 0: if (arg1 == 0) arg1 = 2147483647;
+                uf = _GMP_trial_factor(n, 2, arg1);
+                mpz_set_ui(f, uf);
+                success = (uf > 0);
+                break;
+        case 1: success = _GMP_prho_factor(n, f, 3, arg1);        break;
+        case 2: success = _GMP_pbrent_factor(n, f, 3, arg1);      break;
+        case 3: if (arg2 == 0)  arg2 = arg1*10;
+                success = _GMP_pminus1_factor(n, f, arg1,arg2);   break;
+        case 4: if (arg2 == 0)  arg2 = arg1*10;
+                success = _GMP_pplus1_factor(n, f, 0,arg1,arg2);  break;
+        case 5: success = _GMP_holf_factor(n, f, arg1);           break;
+        case 6: success = _GMP_squfof_factor(n, f, arg1);         break;
+        case 7: if (arg2 == 0) arg2 = 100;
+                if (arg1 == 0) {
+                  success =    _GMP_ECM_FACTOR(n, f,     1000, 40)
+                            || _GMP_ECM_FACTOR(n, f,    10000, 40)
+                            || _GMP_ECM_FACTOR(n, f,   100000, 40)
+                            || _GMP_ECM_FACTOR(n, f,  1000000, 40)
+                            || _GMP_ECM_FACTOR(n, f, 10000000,100);
+                } else {
+                  success = _GMP_ECM_FACTOR(n, f, arg1, arg2);
+                }
+                break;
+        case 8:
+        default:{
+                  mpz_t farray[66];
+                  int i, nfactors;
+                  for (i = 0; i < 66; i++)
+                    mpz_init(farray[i]);
+                  nfactors = _GMP_simpqs(n, farray);
+                  for (i = 0; i < nfactors; i++)
+                    XPUSH_MPZ(farray[i]);
+                  for (i = 0; i < 66; i++)
+                    mpz_clear(farray[i]);
+                  if (nfactors > 0)
+                    mpz_set_ui(n, 1);
+                }
+                break;
+      }
+
+      if (success) {
+        XPUSH_MPZ(f);
+        mpz_divexact(n, n, f);
+      }
+      mpz_clear(f);
+    }
+    if (mpz_cmp_ui(n,1) > 0)
+      XPUSH_MPZ(n);
+    mpz_clear(n);
+#line 1846 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_factor); /* prototype to pass -Wmissing-prototypes */
+XS_EUPXS(XS_Math__Prime__Util__GMP__GMP_factor)
+{
+    dVAR; dXSARGS;
+    if (items != 1)
+       croak_xs_usage(cv,  "strn");
+    PERL_UNUSED_VAR(ax); /* -Wall */
+    SP -= items;
+    {
+#line 1086 "XS.xs"
+    mpz_t n;
+    mpz_t* factors;
+    int* exponents;
+    int nfactors, i, j;
+#line 1867 "XS.c"
+	char*	strn = (char *)SvPV_nolen(ST(0))
+;
+#line 1091 "XS.xs"
+    VALIDATE_AND_SET("factor", n, strn);
+    nfactors = factor(n, &factors, &exponents);
+    for (i = 0; i < nfactors; i++) {
+      for (j = 0; j < exponents[i]; j++) {
+        XPUSH_MPZ(factors[i]);
+      }
+    }
+    clear_factors(nfactors, &factors, &exponents);
+    mpz_clear(n);
+#line 1880 "XS.c"
+	PUTBACK;
+	return;
+    }
+}
+
+#ifdef __cplusplus
+extern "C"
+#endif
+XS_EXTERNAL(boot_Math__Prime__Util__GMP); /* prototype to pass -Wmissing-prototypes */
+XS_EXTERNAL(boot_Math__Prime__Util__GMP)
+{
+#if PERL_VERSION_LE(5, 21, 5)
+    dVAR; dXSARGS;
+#else
+    dVAR; dXSBOOTARGSXSAPIVERCHK;
+#endif
+#if PERL_VERSION_LE(5, 8, 999) /* PERL_VERSION_LT is 5.33+ */
+    char* file = __FILE__;
+#else
+    const char* file = __FILE__;
+#endif
+
+    PERL_UNUSED_VAR(file);
+
+    PERL_UNUSED_VAR(cv); /* -W */
+    PERL_UNUSED_VAR(items); /* -W */
+#if PERL_VERSION_LE(5, 21, 5)
+    XS_VERSION_BOOTCHECK;
+#  ifdef XS_APIVERSION_BOOTCHECK
+    XS_APIVERSION_BOOTCHECK;
+#  endif
+#endif
+
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_set_verbose", XS_Math__Prime__Util__GMP__GMP_set_verbose, file, "$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_set_threads", XS_Math__Prime__Util__GMP__GMP_set_threads, file, "$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::get_stats", XS_Math__Prime__Util__GMP_get_stats, file, "");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::reset_stats", XS_Math__Prime__Util__GMP_reset_stats, file, "");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_init", XS_Math__Prime__Util__GMP__GMP_init, file, "");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_destroy", XS_Math__Prime__Util__GMP__GMP_destroy, file, "");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::_GMP_miller_rabin", XS_Math__Prime__Util__GMP__GMP_miller_rabin, file, "$;@");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_pseudoprime", XS_Math__Prime__Util__GMP__GMP_miller_rabin, file, "$;@");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::miller_rabin_random", XS_Math__Prime__Util__GMP_miller_rabin_random, file, "$$;$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_extra_strong_lucas_pseudoprime", XS_Math__Prime__Util__GMP_is_lucas_pseudoprime, file, "$");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_frobenius_underwood_pseudoprime", XS_Math__Prime__Util__GMP_is_lucas_pseudoprime, file, "$");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_lucas_pseudoprime", XS_Math__Prime__Util__GMP_is_lucas_pseudoprime, file, "$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_perrin_pseudoprime", XS_Math__Prime__Util__GMP_is_lucas_pseudoprime, file, "$");
+        XSANY.any_i32 = 4;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_strong_lucas_pseudoprime", XS_Math__Prime__Util__GMP_is_lucas_pseudoprime, file, "$");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::is_almost_extra_strong_lucas_pseudoprime", XS_Math__Prime__Util__GMP_is_almost_extra_strong_lucas_pseudoprime, file, "$;$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::is_frobenius_pseudoprime", XS_Math__Prime__Util__GMP_is_frobenius_pseudoprime, file, "$;$$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_aks_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_bpsw_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 6;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_ecpp_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 5;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_llr_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_nminus1_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 4;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_nplus1_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 7;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_prob_prime", XS_Math__Prime__Util__GMP_is_prime, file, "$");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_is_provable_prime", XS_Math__Prime__Util__GMP__is_provable_prime, file, "$;$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_prove_with_factors", XS_Math__Prime__Util__GMP__prove_with_factors, file, "$$;@");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_validate_ecpp_curve", XS_Math__Prime__Util__GMP__validate_ecpp_curve, file, "$$$$$$$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::is_power", XS_Math__Prime__Util__GMP_is_power, file, "$;$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::next_prime", XS_Math__Prime__Util__GMP_next_prime, file, "$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::prev_prime", XS_Math__Prime__Util__GMP_next_prime, file, "$");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::prime_count", XS_Math__Prime__Util__GMP_prime_count, file, "$$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::bernfrac", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 7;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::carmichael_lambda", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 5;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::consecutive_integer_lcm", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::exp_mangoldt", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::factorial", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 6;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::pn_primorial", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::primorial", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::totient", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 4;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::znprimroot", XS_Math__Prime__Util__GMP_primorial, file, "$");
+        XSANY.any_i32 = 8;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::gcd", XS_Math__Prime__Util__GMP_gcd, file, "@");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::lcm", XS_Math__Prime__Util__GMP_gcd, file, "@");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::vecprod", XS_Math__Prime__Util__GMP_gcd, file, "@");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::vecsum", XS_Math__Prime__Util__GMP_gcd, file, "@");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::kronecker", XS_Math__Prime__Util__GMP_kronecker, file, "$$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::valuation", XS_Math__Prime__Util__GMP_kronecker, file, "$$");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::moebius", XS_Math__Prime__Util__GMP_moebius, file, "$;$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::lucasu", XS_Math__Prime__Util__GMP_lucasu, file, "$$$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::lucasv", XS_Math__Prime__Util__GMP_lucasu, file, "$$$");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::lucasumod", XS_Math__Prime__Util__GMP_lucasumod, file, "$$$;@");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::lucasvmod", XS_Math__Prime__Util__GMP_lucasumod, file, "$$$;@");
+        XSANY.any_i32 = 1;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::liouville", XS_Math__Prime__Util__GMP_liouville, file, "$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::binomial", XS_Math__Prime__Util__GMP_invmod, file, "$$");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::gcdext", XS_Math__Prime__Util__GMP_invmod, file, "$$");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::invmod", XS_Math__Prime__Util__GMP_invmod, file, "$$");
+        XSANY.any_i32 = 0;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::jordan_totient", XS_Math__Prime__Util__GMP_invmod, file, "$$");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::znorder", XS_Math__Prime__Util__GMP_invmod, file, "$$");
+        XSANY.any_i32 = 4;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::Pi", XS_Math__Prime__Util__GMP_partitions, file, "$");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::is_mersenne_prime", XS_Math__Prime__Util__GMP_partitions, file, "$");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::partitions", XS_Math__Prime__Util__GMP_partitions, file, "$");
+        XSANY.any_i32 = 0;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_pidigits_fd", XS_Math__Prime__Util__GMP__pidigits_fd, file, "$$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::stirling", XS_Math__Prime__Util__GMP_stirling, file, "$$;$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_trial_primes", XS_Math__Prime__Util__GMP__GMP_trial_primes, file, "$$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::sieve_primes", XS_Math__Prime__Util__GMP_sieve_primes, file, "$$;$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::sieve_cunningham_chain", XS_Math__Prime__Util__GMP_sieve_prime_cluster, file, "$$;@");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::sieve_prime_cluster", XS_Math__Prime__Util__GMP_sieve_prime_cluster, file, "$$;@");
+        XSANY.any_i32 = 0;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::sieve_polynomial", XS_Math__Prime__Util__GMP_sieve_polynomial, file, "$$;@");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::primes_in_ap", XS_Math__Prime__Util__GMP_primes_in_ap, file, "$$$$");
+        (void)newXSproto_portable("Math::Prime::Util::GMP::lucas_sequence", XS_Math__Prime__Util__GMP_lucas_sequence, file, "$$$$");
+        cv = newXSproto_portable("Math::Prime::Util::GMP::ecm_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 7;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::holf_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 5;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::pbrent_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 2;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::pminus1_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 3;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::pplus1_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 4;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::prho_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 1;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::qs_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 8;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::squfof_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 6;
+        cv = newXSproto_portable("Math::Prime::Util::GMP::trial_factor", XS_Math__Prime__Util__GMP_trial_factor, file, "$;@");
+        XSANY.any_i32 = 0;
+        (void)newXSproto_portable("Math::Prime::Util::GMP::_GMP_factor", XS_Math__Prime__Util__GMP__GMP_factor, file, "$");
+#if PERL_VERSION_LE(5, 21, 5)
+#  if PERL_VERSION_GE(5, 9, 0)
+    if (PL_unitcheckav)
+        call_list(PL_scopestack_ix, PL_unitcheckav);
+#  endif
+    XSRETURN_YES;
+#else
+    Perl_xs_boot_epilog(aTHX_ ax);
+#endif
+}
+
@@ -15,6 +15,7 @@
 #include "bls75.h"
 #include "ecpp.h"
 #include "utility.h"
+#include "stats.h"
 #include "factor.h"
 #define _GMP_ECM_FACTOR(n, f, b1, ncurves) \
    _GMP_ecm_factor_projective(n, f, b1, 0, ncurves)
@@ -25,9 +26,22 @@
  * crude but seems to work pretty well.
  */
 
+/* The C code gives back its scratch temporaries (utility.h) before it
+ * returns, but a croak skips that.  So each XSUB, when it validates its
+ * input, saves the stack mark to be restored as the caller's scope unwinds.
+ * After a normal return this does nothing; after a croak caught by eval it
+ * hands back whatever the C code had taken. */
+static void _scratch_unwind(pTHX_ void* mark)
+{
+  if (PTR2UV(mark) < scratch_mark())
+    scratch_release(PTR2UV(mark));
+}
+
 static void validate_string_number(const char* f, const char* s)
 {
   const char* p;
+  dTHX;
+  SAVEDESTRUCTOR_X(_scratch_unwind, INT2PTR(void*, scratch_mark()));
   if (s == 0)
     croak("%s: null string pointer as input", f);
   if (*s == 0)
@@ -54,6 +68,35 @@ _GMP_set_verbose(IN int v)
   PPCODE:
      set_verbose_level(v);
 
+void
+_GMP_set_threads(IN int n)
+  PPCODE:
+     set_thread_count(n);
+
+void
+get_stats()
+  PREINIT:
+    HV* hv;
+    int i;
+  PPCODE:
+    hv = newHV();
+    for (i = 0; i < STATS_NMETHODS; i++) {
+      stats_counter_t c;
+      const char* name = stats_method_name(i);
+      HV* mhv = newHV();
+      stats_get_counter(i, &c);
+      (void) hv_store(mhv, "calls",     5, newSVuv(c.calls), 0);
+      (void) hv_store(mhv, "successes", 9, newSVuv(c.successes), 0);
+      (void) hv_store(mhv, "seconds",   7, newSVnv(c.seconds), 0);
+      (void) hv_store(hv, name, strlen(name), newRV_noinc((SV*)mhv), 0);
+    }
+    XPUSHs(sv_2mortal(newRV_noinc((SV*)hv)));
+
+void
+reset_stats()
+  PPCODE:
+    stats_reset();
+
 void
 _GMP_init()
 
@@ -68,10 +111,22 @@ _GMP_miller_rabin(IN char* strn, ...)
   PREINIT:
     mpz_t n, a;
     char* strbase;
+    int i;
   CODE:
     validate_string_number("GMP_miller_rabin (n)", strn);
     strbase = (items == 1) ? "2" : SvPV_nolen(ST(1));  /* default base = 2 */
     validate_string_number("GMP_miller_rabin (base)", strbase);
+    for (i = 2; i < items; i++)
+      validate_string_number("GMP_miller_rabin (base)", SvPV_nolen(ST(i)));
+    /* Check every base before taking the shared context */
+    if (ix == 0) {
+      for (i = 1; i < items; i++) {
+        const char* sb = (i == 1) ? strbase : SvPV_nolen(ST(i));
+        while (sb[0] == '0' && sb[1] != 0)  sb++;
+        if (sb[1] == 0 && (sb[0] == '0' || sb[0] == '1'))
+          croak("Base %c is invalid", sb[0]);
+      }
+    }
     if (strn[1] == 0) {
       switch (strn[0]) {
         case '2': case '3': case '5': case '7': XSRETURN_IV(1); break;
@@ -82,7 +137,19 @@ _GMP_miller_rabin(IN char* strn, ...)
     mpz_init_set_str(n, strn, 10);
     mpz_init_set_str(a, strbase, 10);
     if (ix == 0) {
-      RETVAL = _GMP_miller_rabin(n, a);
+      if (items <= 2 || mpz_even_p(n)) {
+        RETVAL = _GMP_miller_rabin(n, a);
+      } else {
+        /* Several bases share the n-1 = d*2^s setup */
+        mr_ctx_t ctx;
+        mr_ctx_init(&ctx, n);
+        RETVAL = mr_ctx_test(&ctx, a);
+        for (i = 2; RETVAL && i < items; i++) {
+          mpz_set_str(a, SvPV_nolen(ST(i)), 10);
+          RETVAL = mr_ctx_test(&ctx, a);
+        }
+        mr_ctx_destroy(&ctx);
+      }
     } else {
       mpz_t nm1; mpz_init(nm1); mpz_sub_ui(nm1, n, 1);
       mpz_powm(a, a, nm1, n);
@@ -195,6 +262,7 @@ is_prime(IN char* strn)
     is_nminus1_prime = 4
     is_ecpp_prime = 5
     is_bpsw_prime = 6
+    is_nplus1_prime = 7
   PREINIT:
     mpz_t n;
     int ret;
@@ -208,8 +276,9 @@ is_prime(IN char* strn)
       case 3: ret = llr(n); break;
       case 4: ret = _GMP_primality_bls_nm1(n, 100, 0); break;
       case 5: ret = _GMP_ecpp(n, 0); break;
-      case 6:
-      default:ret = _GMP_BPSW(n); break;
+      case 6: ret = _GMP_BPSW(n); break;
+      case 7:
+      default:ret = _GMP_primality_bls_np1(n, 100, 0); break;
     }
     RETVAL = ret;
     mpz_clear(n);
@@ -240,6 +309,36 @@ _is_provable_prime(IN char* strn, IN int wantproof = 0)
     }
     mpz_clear(n);
 
+void
+_prove_with_factors(IN char* strn, IN int np1, ...)
+  PREINIT:
+    int i, nf, result;
+    mpz_t n, *f;
+    char* prooftext = 0;
+  PPCODE:
+    VALIDATE_AND_SET("_prove_with_factors", n, strn);
+    nf = items - 2;
+    New(0, f, nf+1, mpz_t);
+    for (i = 0; i < nf; i++) {
+      char* strf = SvPV_nolen(ST(2+i));
+      validate_string_number("_prove_with_factors", strf);
+      mpz_init_set_str(f[i], strf, 10);
+    }
+    if (!np1)
+      result = _GMP_primality_bls_nm1_known(n, f, nf, &prooftext);
+    else
+      result = _GMP_primality_bls_np1_known(n, f, nf, &prooftext);
+    for (i = 0; i < nf; i++)  mpz_clear(f[i]);
+    Safefree(f);
+    mpz_clear(n);
+    XPUSHs(sv_2mortal(newSViv( result )));
+    if (prooftext) {
+      XPUSHs(sv_2mortal(newSVpv(prooftext, 0)));
+      Safefree(prooftext);
+    } else {
+      XPUSHs(sv_2mortal(newSVpv("", 0)));
+    }
+
 int
 _validate_ecpp_curve(IN char* stra, IN char* strb, IN char* strn, IN char* strpx, IN char* strpy, IN char* strm, IN char* strq)
   PREINIT:
@@ -493,6 +592,38 @@ lucasu(IN IV P, IN IV Q, IN char* strk)
     mpz_clear(v); mpz_clear(u);
     mpz_clear(k);
 
+void
+lucasumod(IN IV P, IN IV Q, IN char* strn, ...)
+  ALIAS:
+    lucasvmod = 1
+  PREINIT:
+    lucas_ctx_t ctx;
+    mpz_t n, *k, *r;
+    int i, nk;
+  PPCODE:
+    nk = items - 3;
+    for (i = 0; i < nk; i++)
+      validate_string_number("lucasumod (k)", SvPV_nolen(ST(i+3)));
+    VALIDATE_AND_SET("lucasumod", n, strn);
+    lucas_ctx_init(&ctx, n, P, Q);
+    mpz_clear(n);
+    if (nk <= 0) { lucas_ctx_destroy(&ctx); XSRETURN_EMPTY; }
+    New(0, k, nk, mpz_t);
+    New(0, r, nk, mpz_t);
+    for (i = 0; i < nk; i++) {
+      mpz_init_set_str(k[i], SvPV_nolen(ST(i+3)), 10);
+      mpz_init(r[i]);
+    }
+    lucas_ctx_seq_multi(&ctx, (ix == 0) ? r : 0, (ix == 0) ? 0 : r, k, nk);
+    lucas_ctx_destroy(&ctx);
+    for (i = 0; i < nk; i++) {
+      XPUSH_MPZ(r[i]);
+      mpz_clear(r[i]);
+      mpz_clear(k[i]);
+    }
+    Safefree(r);
+    Safefree(k);
+
 int
 liouville(IN char* strn)
   PREINIT:
@@ -611,6 +742,14 @@ void partitions(IN UV n)
       Safefree(pent);
     }
 
+int
+_pidigits_fd(IN UV n, IN int fd)
+  CODE:
+    /* Pi(n) streamed to a file descriptor, without the string in memory */
+    RETVAL = pidigits_fd(n, fd);
+  OUTPUT:
+    RETVAL
+
 void
 stirling(IN UV n, IN UV m, IN UV type = 1)
   PREINIT:
@@ -710,6 +849,110 @@ sieve_primes(IN char* strlow, IN char* strhigh, IN UV k = 0)
     mpz_clear(low);
     mpz_clear(high);
 
+void
+sieve_prime_cluster(IN char* strlow, IN char* strhigh, ...)
+  ALIAS:
+    sieve_cunningham_chain = 1
+  PREINIT:
+    mpz_t low, high, t;
+    UV i, nforms, nlist, *mult, *list;
+    IV *add;
+  PPCODE:
+    VALIDATE_AND_SET("sieve_prime_cluster", low, strlow);
+    VALIDATE_AND_SET("sieve_prime_cluster", high, strhigh);
+    for (i = 2; i < (UV)items; i++)
+      validate_string_number("sieve_prime_cluster (offset)", SvPV_nolen(ST(i)));
+    if (ix == 0) {                       /* n, n+o1, n+o2, ... */
+      nforms = items - 1;
+      New(0, mult, nforms, UV);
+      New(0, add, nforms, IV);
+      mult[0] = 1;  add[0] = 0;
+      for (i = 1; i < nforms; i++) {
+        UV o = SvUV(ST(i+1));
+        if (o > (UV)IV_MAX)  croak("sieve_prime_cluster: offset too large");
+        mult[i] = 1;  add[i] = o;
+      }
+    } else {                             /* length, kind 1 (2p+1) or 2 (2p-1) */
+      UV kind = (items > 3) ? SvUV(ST(3)) : 1;
+      nforms = (items > 2) ? SvUV(ST(2)) : 2;
+      if (nforms < 1 || nforms >= BITS_PER_WORD-1)
+        croak("sieve_cunningham_chain: length must be 1 to %d", BITS_PER_WORD-2);
+      if (kind != 1 && kind != 2)
+        croak("sieve_cunningham_chain: kind must be 1 or 2");
+      New(0, mult, nforms, UV);
+      New(0, add, nforms, IV);
+      for (i = 0; i < nforms; i++) {
+        mult[i] = UVCONST(1) << i;
+        add[i] = (kind == 1) ? (IV)(mult[i]-1) : -(IV)(mult[i]-1);
+      }
+    }
+    list = sieve_cluster(low, high, nforms, mult, add, &nlist);
+    Safefree(add);
+    Safefree(mult);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_add_ui(t, low, list[i]);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(low);
+    mpz_clear(high);
+
+void
+sieve_polynomial(IN char* strlow, IN char* strhigh, ...)
+  PREINIT:
+    mpz_t low, high, t, *coef;
+    UV i, deg, nlist, *list;
+  PPCODE:
+    if (items < 3)
+      croak("Usage: sieve_polynomial(low, high, c_d, ..., c_1, c_0)");
+    VALIDATE_AND_SET("sieve_polynomial", low, strlow);
+    VALIDATE_AND_SET("sieve_polynomial", high, strhigh);
+    deg = items - 3;
+    New(0, coef, deg+1, mpz_t);
+    for (i = 0; i <= deg; i++) {         /* given highest degree first */
+      char* strc = SvPV_nolen(ST(2+deg-i));
+      validate_string_number("sieve_polynomial", (strc[0]=='-') ? strc+1 : strc);
+      mpz_init_set_str(coef[i], strc, 10);
+    }
+    list = sieve_polynomial(low, high, deg, coef, &nlist);
+    for (i = 0; i <= deg; i++)  mpz_clear(coef[i]);
+    Safefree(coef);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_add_ui(t, low, list[i]);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(low);
+    mpz_clear(high);
+
+void
+primes_in_ap(IN char* stra, IN char* strd, IN char* strlow, IN char* strhigh)
+  PREINIT:
+    mpz_t a, d, low, high, first, t;
+    UV i, nlist, *list;
+  PPCODE:
+    VALIDATE_AND_SET("primes_in_ap", a, stra);
+    VALIDATE_AND_SET("primes_in_ap", d, strd);
+    VALIDATE_AND_SET("primes_in_ap", low, strlow);
+    VALIDATE_AND_SET("primes_in_ap", high, strhigh);
+    mpz_init(first);
+    list = primes_in_ap(first, a, d, low, high, &nlist);
+    mpz_init(t);
+    for (i = 0; i < nlist; i++) {
+      mpz_set(t, d);
+      mpz_mul_ui(t, t, list[i]);
+      mpz_add(t, t, first);
+      XPUSH_MPZ(t);
+    }
+    mpz_clear(t);
+    if (list != 0) Safefree(list);
+    mpz_clear(first);
+    mpz_clear(a);  mpz_clear(d);  mpz_clear(low);  mpz_clear(high);
+
 void
 lucas_sequence(IN char* strn, IN IV P, IN IV Q, IN char* strk)
   PREINIT:
@@ -7,6 +7,7 @@
 
 #include "ptypes.h"
 #include "gmp_main.h"
+#include "bls75.h"
 #include "prime_iterator.h"
 #include "small_factor.h"
 #include "simpqs.h"
@@ -14,6 +15,7 @@
 #define _GMP_ECM_FACTOR(n, f, b1, ncurves) \
    _GMP_ecm_factor_projective(n, f, b1, 0, ncurves)
 #include "utility.h"
+#include "stats.h"
 
 /*
  * Lucas (1876): Given a completely factored n-1, if there exists an a s.t.
@@ -252,8 +254,8 @@ int _GMP_primality_pocklington(mpz_t n, int do_quick)
     if ( (mpz_cmp(A, sqrtn) > 0) && (mpz_cmp_ui(t, 1) == 0) )
       break;
     success = 0;
-    /* If the stack is empty, we have failed. */
-    if (msp == 0)
+    /* If the stack is empty or we're out of time, we have failed. */
+    if (msp == 0 || budget_expired())
       break;
     /* pop a component off the stack */
     mpz_set(m, mstack[--msp]); mpz_clear(mstack[msp]);
@@ -352,7 +354,203 @@ static int bls_theorem5_limit(mpz_t n, mpz_t A, mpz_t B,
   return (mpz_cmp(n, y) < 0) ? 1 : 0;
 }
 
-int _GMP_primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
+/* r[i] = x^(E/e[i]) mod n for i in [lo,hi), where E is the product of
+ * e[lo..hi).  Each level of the tree costs about one exponentiation by E. */
+static void _powm_all_but_one(mpz_t* r, mpz_t x, mpz_t* e, int lo, int hi, mpz_t n)
+{
+  int i, mid;
+  mpz_t y, E;
+  if (hi - lo == 1) { mpz_set(r[lo], x); return; }
+  mid = lo + (hi-lo)/2;
+  mpz_init(y);  mpz_init_set_ui(E, 1);
+  for (i = mid; i < hi; i++)  mpz_mul(E, E, e[i]);
+  mpz_powm(y, x, E, n);
+  _powm_all_but_one(r, y, e, lo, mid, n);
+  mpz_set_ui(E, 1);
+  for (i = lo; i < mid; i++)  mpz_mul(E, E, e[i]);
+  mpz_powm(y, x, E, n);
+  _powm_all_but_one(r, y, e, mid, hi, n);
+  mpz_clear(y);  mpz_clear(E);
+}
+
+/* Finish a BLS75 theorem 5 proof given the proven prime factors fstack
+ * of n-1 (2 first).  If success is not positive we just clean up.  The
+ * fstack entries are cleared.  Returns 2 if n is proven prime, 0 if it is
+ * composite, and 1 otherwise. */
+static int _bls_theorem5_proof(mpz_t n, mpz_t nm1, mpz_t* fstack, int fsp,
+                               int success, int effort, char** prooftextptr)
+{
+  mpz_t A, B, t, m, r, s;
+  mpz_t* mstack;
+  int msp = 0;
+
+  mpz_init(A);  mpz_init(B);  mpz_init(t);  mpz_init(m);  mpz_init(r);  mpz_init(s);
+  New(0, mstack, fsp+1, mpz_t);
+
+  /* Sort factors found from largest to smallest, but 2 must be at start. */
+  {
+    int i, j;
+    for (i = 2; i < fsp; i++)
+      for (j = i; j > 1 && mpz_cmp(fstack[j-1], fstack[j]) < 0; j--)
+        mpz_swap( fstack[j-1], fstack[j] );
+    for (i = 2; i < fsp; i++)   /* Remove any duplicate factors */
+      if (mpz_cmp(fstack[i], fstack[i-1]) == 0) {
+        for (j = i+1; j < fsp; j++)
+          mpz_set(fstack[j-1], fstack[j]);
+        fsp--;
+      }
+  }
+
+  /* Shrink to smallest set and verify conditions. */
+  if (success > 0) {
+    int i;
+    mpz_set_ui(A, 1);
+    mpz_set(B, nm1);
+    for (i = 0; i < fsp; i++) {
+      if (bls_theorem5_limit(n, A, B, t, m, r, s))
+        break;
+      do {
+        mpz_mul(A, A, fstack[i]);
+        mpz_divexact(B, B, fstack[i]);
+      } while (mpz_divisible_p(B, fstack[i]));
+    }
+    /* Delete any extra factors */
+    while (i < fsp)
+      mpz_clear(fstack[--fsp]);
+    /* Verify Q[0] = 2 */
+    if (mpz_cmp_ui(fstack[0], 2) != 0)
+      croak("BLS75 internal error: 2 not at start of fstack");
+    /* Verify conditions */
+    success = 0;
+    if (bls_theorem5_limit(n, A, B, t, m, r, s)) {
+      mpz_mul(t, r, r);
+      mpz_submul_ui(t, s, 8);   /* t = r^2 - 8s */
+      /* N is prime if and only if s=0 OR t not a perfect square */
+      success = (mpz_sgn(s) == 0 || !mpz_perfect_square_p(t))  ?  1  :  -1;
+    }
+  }
+
+  if (success > 0) {
+    int pcount, a, fermat2;
+    int const alimit = (effort <= 2) ? 200 : 10000;
+    mpz_t p, ap, *pe, *pr;
+
+    mpz_init(p);
+    mpz_init(ap);
+
+    /* Most factors take a = 2, so find every 2^((n-1)/f) with one product
+     * tree rather than a full exponentiation for each f.  With pe[i] the
+     * power of f[i] in A, pr[i] = 2^(B * A/pe[i]), then raise to pe[i]/f[i]. */
+    New(0, pe, fsp, mpz_t);
+    New(0, pr, fsp, mpz_t);
+    for (pcount = 0; pcount < fsp; pcount++) {
+      mpz_init(pr[pcount]);
+      mpz_init(pe[pcount]);
+      mpz_pow_ui(pe[pcount], fstack[pcount], mpz_remove(t, A, fstack[pcount]));
+    }
+    mpz_set_ui(ap, 2);
+    mpz_powm(p, ap, B, n);
+    mpz_powm(t, p, A, n);
+    fermat2 = (mpz_cmp_ui(t, 1) == 0);
+    if (fermat2) {
+      _powm_all_but_one(pr, p, pe, 0, fsp, n);
+      for (pcount = 0; pcount < fsp; pcount++) {
+        mpz_divexact(t, pe[pcount], fstack[pcount]);
+        mpz_powm(pr[pcount], pr[pcount], t, n);
+      }
+    }
+
+    for (pcount = 0; success && pcount < fsp; pcount++) {
+      PRIME_ITERATOR(iter);
+      if (fermat2) {
+        mpz_sub_ui(t, pr[pcount], 1);
+        mpz_gcd(t, t, n);
+        if (mpz_cmp_ui(t, 1) == 0) {
+          mpz_init_set_ui(mstack[msp++], 2);
+          prime_iterator_destroy(&iter);
+          continue;
+        }
+      }
+      mpz_set(p, fstack[pcount]);
+      mpz_divexact(B, nm1, p);
+      success = 0;
+      for (a = 2; !success && a <= alimit; a = prime_iterator_next(&iter)) {
+        mpz_set_ui(ap, a);
+        /* For f = 2 we need a^((n-1)/2) = -1, so (a|n) = -1.  This skips
+         * all a below k+2 for n = k!+1 or k#+1. */
+        if (mpz_cmp_ui(p, 2) == 0 && mpz_jacobi(ap, n) != -1)
+          continue;
+        /* Does gcd(a^((n-1)/f)-1,n) = 1 ? */
+        mpz_powm(m, ap, B, n);
+        mpz_sub_ui(t, m, 1);
+        mpz_gcd(t, t, n);
+        if (mpz_cmp_ui(t, 1) != 0)
+          continue;
+        /* Does a^(n-1) % n = 1 ? */
+        mpz_powm(t, m, p, n);
+        if (mpz_cmp_ui(t, 1) != 0)
+          continue;
+        success = 1;   /* We found an a for this p */
+        mpz_init_set(mstack[msp++], ap);
+      }
+      prime_iterator_destroy(&iter);
+    }
+    /* If we could not find 'a' values, then we should return 1 (maybe prime)
+     * since we did not perform an exhaustive search.  It would be quite
+     * unusual to find a prime that didn't have an 'a' in the first 10,000
+     * primes, but it could happen.  It's a "dubiously prime" :) */
+    for (pcount = 0; pcount < fsp; pcount++) {
+      mpz_clear(pr[pcount]);
+      mpz_clear(pe[pcount]);
+    }
+    Safefree(pr);
+    Safefree(pe);
+    mpz_clear(p);
+    mpz_clear(ap);
+  }
+  if (success > 0 && prooftextptr != 0) {
+    int i;
+    char *proofstr, *proofptr;
+    int curprooflen = (*prooftextptr == 0) ? 0 : strlen(*prooftextptr);
+    int myprooflen = (5 + mpz_sizeinbase(n, 10)) * (2 + fsp + msp) + 200;
+
+    if (fsp != msp) croak("Different f and a counts\n");
+    New(0, proofstr, myprooflen + curprooflen + 1, char);
+    proofptr = proofstr;
+    proofptr += gmp_sprintf(proofptr, "Type BLS5\nN  %Zd\n", n);
+    /* Q[0] is always 2 */
+    for (i = 1; i < fsp; i++)
+      proofptr += gmp_sprintf(proofptr, "Q[%d]  %Zd\n", i, fstack[i]);
+    /* A[i] only printed if not 2 */
+    for (i = 0; i < msp; i++)
+      if (mpz_cmp_ui(mstack[i], 2) != 0)
+        proofptr += gmp_sprintf(proofptr, "A[%d]  %Zd\n", i, mstack[i]);
+    proofptr += gmp_sprintf(proofptr, "----\n");
+    /* Set or prepend */
+    if (*prooftextptr) {
+      proofptr += gmp_sprintf(proofptr, "\n");
+      strcat(proofptr, *prooftextptr);
+      Safefree(*prooftextptr);
+    }
+    *prooftextptr = proofstr;
+  }
+  while (fsp-- > 0)
+    mpz_clear(fstack[fsp]);
+  while (msp-- > 0)
+    mpz_clear(mstack[msp]);
+  Safefree(mstack);
+  mpz_clear(A);
+  mpz_clear(B);
+  mpz_clear(t);
+  mpz_clear(m);
+  mpz_clear(r);
+  mpz_clear(s);
+  if (success < 0) return 0;
+  if (success > 0) return 2;
+  return 1;
+}
+
+static int _primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
 {
   mpz_t nm1, A, B, t, m, f, r, s;
   mpz_t mstack[PRIM_STACK_SIZE];
@@ -403,8 +601,8 @@ int _GMP_primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
       break;
 
     success = 0;
-    /* If the stack is empty, we have failed. */
-    if (msp == 0)
+    /* If the stack is empty or we're out of time, we have failed. */
+    if (msp == 0 || budget_expired())
       break;
     /* pop a component off the stack */
     mpz_set(m, mstack[--msp]); mpz_clear(mstack[msp]);
@@ -433,108 +631,254 @@ int _GMP_primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
     primality_handle_factor(m, _GMP_primality_bls_nm1, 0);
   }
 
-  /* clear mstack since we don't care about it.  Use to hold a values. */
   while (msp-- > 0)
     mpz_clear(mstack[msp]);
-  msp = 0;
+  mpz_clear(A);
+  mpz_clear(B);
+  mpz_clear(m);
+  mpz_clear(f);
+  mpz_clear(t);
+  mpz_clear(r);
+  mpz_clear(s);
 
-  /* Sort factors found from largest to smallest, but 2 must be at start. */
-  {
-    int i, j;
-    for (i = 2; i < fsp; i++)
-      for (j = i; j > 1 && mpz_cmp(fstack[j-1], fstack[j]) < 0; j--)
-        mpz_swap( fstack[j-1], fstack[j] );
-    for (i = 2; i < fsp; i++)   /* Remove any duplicate factors */
-      if (mpz_cmp(fstack[i], fstack[i-1]) == 0) {
-        for (j = i+1; j < fsp; j++)
-          mpz_set(fstack[j-1], fstack[j]);
-        fsp--;
-      }
+  success = _bls_theorem5_proof(n, nm1, fstack, fsp, success, effort, prooftextptr);
+  mpz_clear(nm1);
+  return success;
+}
+
+int _GMP_primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
+{
+  stats_timer_t st;
+  int result;
+  stats_begin(&st, STATS_BLS75, n, effort, 0, 0);
+  result = _primality_bls_nm1(n, effort, prooftextptr);
+  stats_end(&st, result != 1, 0);
+  return result;
+}
+
+
+/*****************************************************************************/
+/* N+1 proofs.
+ *
+ * BLS75 theorem 14 (Morrison):  let n+1 = F*R with F completely factored,
+ * and fix a D with (D|n) = -1.  If for each prime q of F there is a Lucas
+ * sequence with discriminant D where n divides U_(n+1) and
+ * gcd(U_((n+1)/q), n) = 1, then every prime p of n is +/-1 mod F.  With F
+ * holding the full power of each q this follows from the rank of
+ * apparition of p dividing both n+1 and p-(D|p).
+ *
+ * As in theorem 5 (compare theorems 17 and 19), if n < (F-1)^3 then a
+ * composite n is p1*p2 = (aF+1)(bF-1) with a,b >= 1, so R = sF + r with
+ * s = ab and r = b-a, and |r| < s < F-2.  Then r is R mod F or that minus
+ * F, and a is a root of a^2 + ra - s, so r^2 + 4s is a square.  If it
+ * isn't for either r, n is prime.
+ *
+ * Lucas sequences are done in Z_n[x]/(x^2-Px+Q), where x^k = U_k x - Q U_(k-1),
+ * so every U_((n+1)/q) comes from one product tree of powers as in the n-1
+ * case.  An element a + bx is held as a pair. */
+
+/* (a1 + b1 x)(a2 + b2 x), result in (a1,b1).  t and u are scratch. */
+static void _qmul(mpz_t a1, mpz_t b1, mpz_t a2, mpz_t b2, IV P, IV Q,
+                  mpz_t n, mpz_t t, mpz_t u)
+{
+  mpz_mul(t, b1, b2);             /* t = b1*b2 */
+  mpz_mul(u, a1, b2);
+  mpz_addmul(u, a2, b1);
+  if (P >= 0) mpz_addmul_ui(u, t, P);  else mpz_submul_ui(u, t, -P);
+  mpz_mul(a1, a1, a2);            /* a1 = a1a2 - Q b1b2, u = a1b2+a2b1+P b1b2 */
+  if (Q >= 0) mpz_submul_ui(a1, t, Q);  else mpz_addmul_ui(a1, t, -Q);
+  mpz_mod(a1, a1, n);
+  mpz_mod(b1, u, n);
+}
+
+/* (ra + rb x) = (a + b x)^e mod n */
+static void _qpowm(mpz_t ra, mpz_t rb, mpz_t a, mpz_t b, mpz_t e, IV P, IV Q,
+                   mpz_t n)
+{
+  mpz_t xa, xb, t, u;
+  UV i = mpz_sizeinbase(e, 2);
+  mpz_init_set(xa, a);  mpz_init_set(xb, b);  mpz_init(t);  mpz_init(u);
+  mpz_set_ui(ra, 1);
+  mpz_set_ui(rb, 0);
+  while (i-- > 0) {
+    _qmul(ra, rb, ra, rb, P, Q, n, t, u);
+    if (mpz_tstbit(e, i))
+      _qmul(ra, rb, xa, xb, P, Q, n, t, u);
   }
+  mpz_clear(xa);  mpz_clear(xb);  mpz_clear(t);  mpz_clear(u);
+}
 
-  /* Shrink to smallest set and verify conditions. */
+/* ra[i] + rb[i] x = (a + b x)^(E/e[i]) for i in [lo,hi), E the product of
+ * e[lo..hi).  Like _powm_all_but_one. */
+static void _qpowm_all_but_one(mpz_t* ra, mpz_t* rb, mpz_t a, mpz_t b,
+                               mpz_t* e, int lo, int hi, IV P, IV Q, mpz_t n)
+{
+  int i, mid;
+  mpz_t ya, yb, E;
+  if (hi - lo == 1) { mpz_set(ra[lo], a);  mpz_set(rb[lo], b);  return; }
+  mid = lo + (hi-lo)/2;
+  mpz_init(ya);  mpz_init(yb);  mpz_init_set_ui(E, 1);
+  for (i = mid; i < hi; i++)  mpz_mul(E, E, e[i]);
+  _qpowm(ya, yb, a, b, E, P, Q, n);
+  _qpowm_all_but_one(ra, rb, ya, yb, e, lo, mid, P, Q, n);
+  mpz_set_ui(E, 1);
+  for (i = lo; i < mid; i++)  mpz_mul(E, E, e[i]);
+  _qpowm(ya, yb, a, b, E, P, Q, n);
+  _qpowm_all_but_one(ra, rb, ya, yb, e, mid, hi, P, Q, n);
+  mpz_clear(ya);  mpz_clear(yb);  mpz_clear(E);
+}
+
+static int bls_np1_limit(mpz_t n, mpz_t F, mpz_t t)
+{
+  mpz_sub_ui(t, F, 1);
+  mpz_pow_ui(t, t, 3);
+  return (mpz_cmp(n, t) < 0) ? 1 : 0;
+}
+
+/* Finish an n+1 proof given the proven prime factors fstack of n+1.  Like
+ * _bls_theorem5_proof:  if success is not positive we just clean up, the
+ * fstack entries are cleared, and the certificate is prepended.  Returns
+ * 2 if n is proven prime, 0 if it is composite, and 1 otherwise. */
+static int _bls_np1_proof(mpz_t n, mpz_t np1, mpz_t* fstack, int fsp,
+                          int success, char** prooftextptr)
+{
+  mpz_t F, R, t, u, r, s, ea, eb;
+  mpz_t *pe, *ra, *rb;
+  IV P0 = 0, Q0, D = 0, *lp = 0;
+  int i, j;
+
+  mpz_init(F);  mpz_init(R);  mpz_init(t);  mpz_init(u);  mpz_init(r);  mpz_init(s);
+  mpz_init(ea);  mpz_init(eb);
+
+  /* Sort factors from largest to smallest, but 2 must be at start, and
+   * remove any duplicates. */
+  for (i = 2; i < fsp; i++)
+    for (j = i; j > 1 && mpz_cmp(fstack[j-1], fstack[j]) < 0; j--)
+      mpz_swap(fstack[j-1], fstack[j]);
+  for (i = 1, j = 1; i < fsp; i++)
+    if (mpz_cmp(fstack[i], fstack[j-1]) != 0)
+      mpz_swap(fstack[j++], fstack[i]);
+  while (fsp > j)
+    mpz_clear(fstack[--fsp]);
+  if (fsp > 0 && mpz_cmp_ui(fstack[0], 2) != 0)
+    croak("BLS75 internal error: 2 not at start of fstack");
+
+  /* Shrink to the fewest (largest) primes giving n < (F-1)^3 */
   if (success > 0) {
-    int i;
-    mpz_set_ui(A, 1);
-    mpz_set(B, nm1);
+    mpz_set_ui(F, 1);
     for (i = 0; i < fsp; i++) {
-      if (bls_theorem5_limit(n, A, B, t, m, r, s))
+      if (bls_np1_limit(n, F, t))
         break;
-      do {
-        mpz_mul(A, A, fstack[i]);
-        mpz_divexact(B, B, fstack[i]);
-      } while (mpz_divisible_p(B, fstack[i]));
+      mpz_remove(t, np1, fstack[i]);
+      mpz_divexact(t, np1, t);
+      mpz_mul(F, F, t);
     }
-    /* Delete any extra factors */
     while (i < fsp)
       mpz_clear(fstack[--fsp]);
-    /* Verify Q[0] = 2 */
-    if (mpz_cmp_ui(fstack[0], 2) != 0)
-      croak("BLS75 internal error: 2 not at start of fstack");
-    /* Verify conditions */
-    success = 0;
-    if (bls_theorem5_limit(n, A, B, t, m, r, s)) {
+    success = bls_np1_limit(n, F, t);
+  }
+
+  /* n = (aF+1)(bF-1) exactly when r^2+4s is a square for one of the r */
+  if (success > 0) {
+    mpz_divexact(R, np1, F);
+    mpz_tdiv_r(r, R, F);
+    for (i = 0; i < 2 && success > 0; i++) {
+      if (i == 1)  mpz_sub(r, r, F);
+      mpz_sub(s, R, r);
+      mpz_divexact(s, s, F);
+      if (mpz_sgn(s) <= 0)  continue;
       mpz_mul(t, r, r);
-      mpz_submul_ui(t, s, 8);   /* t = r^2 - 8s */
-      /* N is prime if and only if s=0 OR t not a perfect square */
-      success = (mpz_sgn(s) == 0 || !mpz_perfect_square_p(t))  ?  1  :  -1;
+      mpz_addmul_ui(t, s, 4);
+      if (mpz_perfect_square_p(t))
+        success = -1;
     }
   }
 
+  /* Find D = P0^2 - 4*Q0 with (D|n) = -1, as done for theorem 15 */
   if (success > 0) {
-    int pcount, a;
-    int const alimit = (effort <= 2) ? 200 : 10000;
-    mpz_t p, ap;
-
-    mpz_init(p);
-    mpz_init(ap);
+    for (Q0 = 2; Q0 < 1000; Q0++) {
+      P0 = (Q0 % 2) ? 2 : 1;
+      mpz_set_si(t, P0*P0 - 4*Q0);
+      if (mpz_jacobi(t, n) == -1)
+        break;
+    }
+    if (Q0 >= 1000)  success = 0;
+    D = P0*P0 - 4*Q0;
+    mpz_set_si(t, 2*Q0*D);
+    mpz_gcd(t, t, n);
+    if (mpz_cmp_ui(t, 1) != 0)  success = 0;
+  }
 
-    for (pcount = 0; success && pcount < fsp; pcount++) {
-      PRIME_ITERATOR(iter);
-      mpz_set(p, fstack[pcount]);
+  if (success > 0) {
+    New(0, lp, fsp, IV);
+    New(0, pe, fsp, mpz_t);
+    New(0, ra, fsp, mpz_t);
+    New(0, rb, fsp, mpz_t);
+    for (i = 0; i < fsp; i++) {
+      mpz_init(ra[i]);  mpz_init(rb[i]);  mpz_init(pe[i]);
+      mpz_pow_ui(pe[i], fstack[i], mpz_remove(t, F, fstack[i]));
+    }
+    /* x^R, then x^(n+1) must be an integer (U_(n+1) = 0 mod n) */
+    mpz_set_ui(t, 0);
+    mpz_set_ui(u, 1);
+    _qpowm(ea, eb, t, u, R, P0, Q0, n);
+    _qpowm(t, u, ea, eb, F, P0, Q0, n);
+    if (mpz_sgn(u) != 0)
+      success = -1;                    /* not a Lucas probable prime */
+    if (success > 0) {
+      _qpowm_all_but_one(ra, rb, ea, eb, pe, 0, fsp, P0, Q0, n);
+      for (i = 0; i < fsp; i++) {
+        mpz_divexact(t, pe[i], fstack[i]);
+        _qpowm(ra[i], rb[i], ra[i], rb[i], t, P0, Q0, n);
+      }
+    }
+    for (i = 0; success > 0 && i < fsp; i++) {
+      mpz_gcd(t, rb[i], n);
+      lp[i] = P0;
+      if (mpz_cmp_ui(t, 1) == 0)
+        continue;
+      /* Other sequences with the same D:  P = P0+2j, Q = Q0 + j*P0 + j^2 */
       success = 0;
-      for (a = 2; !success && a <= alimit; a = prime_iterator_next(&iter)) {
-        mpz_set_ui(ap, a);
-        /* Does a^(n-1) % n = 1 ? */
-        mpz_powm(t, ap, nm1, n);
+      for (j = 1; !success && j < 100; j++) {
+        IV P = P0 + 2*j,  Q = Q0 + j*P0 + j*j;
+        mpz_set_si(t, 2*Q);
+        mpz_gcd(t, t, n);
         if (mpz_cmp_ui(t, 1) != 0)
           continue;
-        /* Does gcd(a^((n-1)/f)-1,n) = 1 ? */
-        mpz_divexact(B, nm1, p);
-        mpz_powm(t, ap, B, n);
-        mpz_sub_ui(t, t, 1);
-        mpz_gcd(t, t, n);
+        mpz_divexact(s, np1, fstack[i]);
+        mpz_set_ui(t, 0);
+        mpz_set_ui(u, 1);
+        _qpowm(ea, eb, t, u, s, P, Q, n);
+        mpz_gcd(t, eb, n);
         if (mpz_cmp_ui(t, 1) != 0)
           continue;
-        success = 1;   /* We found an a for this p */
-        mpz_init_set(mstack[msp++], ap);
+        _qpowm(t, u, ea, eb, fstack[i], P, Q, n);
+        if (mpz_sgn(u) != 0) { success = -1; break; }
+        lp[i] = P;
+        success = 1;
       }
-      prime_iterator_destroy(&iter);
     }
-    /* If we could not find 'a' values, then we should return 1 (maybe prime)
-     * since we did not perform an exhaustive search.  It would be quite
-     * unusual to find a prime that didn't have an 'a' in the first 10,000
-     * primes, but it could happen.  It's a "dubiously prime" :) */
-    mpz_clear(p);
-    mpz_clear(ap);
+    for (i = 0; i < fsp; i++) {
+      mpz_clear(ra[i]);  mpz_clear(rb[i]);  mpz_clear(pe[i]);
+    }
+    Safefree(pe);  Safefree(ra);  Safefree(rb);
   }
+
   if (success > 0 && prooftextptr != 0) {
-    int i;
     char *proofstr, *proofptr;
     int curprooflen = (*prooftextptr == 0) ? 0 : strlen(*prooftextptr);
-    int myprooflen = (5 + mpz_sizeinbase(n, 10)) * (2 + fsp + msp) + 200;
+    int myprooflen = (5 + mpz_sizeinbase(n, 10)) * (2 + fsp) + 30 * fsp + 200;
 
-    if (fsp != msp) croak("Different f and a counts\n");
     New(0, proofstr, myprooflen + curprooflen + 1, char);
     proofptr = proofstr;
-    proofptr += gmp_sprintf(proofptr, "Type BLS5\nN  %Zd\n", n);
+    proofptr += gmp_sprintf(proofptr, "Type NP1\nN  %Zd\nD  %"IVdf"\n", n, D);
     /* Q[0] is always 2 */
     for (i = 1; i < fsp; i++)
       proofptr += gmp_sprintf(proofptr, "Q[%d]  %Zd\n", i, fstack[i]);
-    /* A[i] only printed if not 2 */
-    for (i = 0; i < msp; i++)
-      if (mpz_cmp_ui(mstack[i], 2) != 0)
-        proofptr += gmp_sprintf(proofptr, "A[%d]  %Zd\n", i, mstack[i]);
+    /* P[i] only printed if not the default for D */
+    for (i = 0; i < fsp; i++)
+      if (lp[i] != P0)
+        proofptr += gmp_sprintf(proofptr, "P[%d]  %"IVdf"\n", i, lp[i]);
     proofptr += gmp_sprintf(proofptr, "----\n");
     /* Set or prepend */
     if (*prooftextptr) {
@@ -544,23 +888,325 @@ int _GMP_primality_bls_nm1(mpz_t n, int effort, char** prooftextptr)
     }
     *prooftextptr = proofstr;
   }
+  if (lp != 0)  Safefree(lp);
   while (fsp-- > 0)
     mpz_clear(fstack[fsp]);
+  mpz_clear(F);  mpz_clear(R);  mpz_clear(t);  mpz_clear(u);  mpz_clear(r);  mpz_clear(s);
+  mpz_clear(ea);  mpz_clear(eb);
+  if (success < 0) return 0;
+  if (success > 0) return 2;
+  return 1;
+}
+
+static int _primality_bls_np1(mpz_t n, int effort, char** prooftextptr)
+{
+  mpz_t np1, A, B, t, m, f;
+  mpz_t mstack[PRIM_STACK_SIZE];
+  mpz_t fstack[PRIM_STACK_SIZE];
+  int msp = 0;
+  int fsp = 0;
+  int success = 1;
+  UV B1 = 2000;
+
+  /* We need to do this for BLS */
+  if (mpz_even_p(n)) return 0;
+
+  mpz_init(np1);
+  mpz_add_ui(np1, n, 1);
+  mpz_init_set_ui(A, 1);
+  mpz_init_set(B, np1);
+  mpz_init(m);
+  mpz_init(f);
+  mpz_init(t);
+
+  { /* Pull small factors out */
+    PRIME_ITERATOR(iter);
+    UV tf;
+    for (tf = 2; tf < B1; tf = prime_iterator_next(&iter)) {
+      if (mpz_cmp_ui(B, tf*tf) < 0) break;
+      if (mpz_divisible_ui_p(B, tf)) {
+        if (fsp >= PRIM_STACK_SIZE) { success = 0; break; }
+        mpz_init_set_ui(fstack[fsp++], tf);
+        do {
+          mpz_mul_ui(A, A, tf);
+          mpz_divexact_ui(B, B, tf);
+        } while (mpz_divisible_ui_p(B, tf));
+      }
+    }
+    prime_iterator_destroy(&iter);
+  }
+
+  if (success) {
+    mpz_set(f, B);
+    primality_handle_factor(f, _GMP_primality_bls_np1, 1);
+  }
+
+  while (success) {
+
+    if (bls_np1_limit(n, A, t))
+      break;
+
+    success = 0;
+    /* If the stack is empty or we're out of time, we have failed. */
+    if (msp == 0 || budget_expired())
+      break;
+    /* pop a component off the stack */
+    mpz_set(m, mstack[--msp]); mpz_clear(mstack[msp]);
+
+    success = try_factor(f, m, effort);
+
+    /* QS.  Uses lots of memory, but finds multiple factors quickly */
+    if (!success && effort >= 5 &&
+        mpz_sizeinbase(m,10) >= 30 && mpz_sizeinbase(m,10) <= 90) {
+      if (effort > 5 || (effort == 5 && mpz_sizeinbase(m,10) < 55) ) {
+        INNER_QS_FACTOR(m, _GMP_primality_bls_np1);
+      }
+    }
+
+    if (!success)
+      success = try_factor2(f, m, effort);
+
+    /* If we couldn't factor m and the stack is empty, we've failed. */
+    if ( (!success) && (msp == 0) )
+      break;
+    /* Put the two factors f and m/f into the stacks, smallest first */
+    mpz_divexact(m, m, f);
+    if (mpz_cmp(m, f) < 0)
+      mpz_swap(m, f);
+    primality_handle_factor(f, _GMP_primality_bls_np1, 0);
+    primality_handle_factor(m, _GMP_primality_bls_np1, 0);
+  }
+
   while (msp-- > 0)
     mpz_clear(mstack[msp]);
-  mpz_clear(nm1);
   mpz_clear(A);
   mpz_clear(B);
   mpz_clear(m);
   mpz_clear(f);
   mpz_clear(t);
-  mpz_clear(r);
-  mpz_clear(s);
-  if (success < 0) return 0;
-  if (success > 0) return 2;
+
+  success = _bls_np1_proof(n, np1, fstack, fsp, success, prooftextptr);
+  mpz_clear(np1);
+  return success;
+}
+
+int _GMP_primality_bls_np1(mpz_t n, int effort, char** prooftextptr)
+{
+  stats_timer_t st;
+  int result;
+  stats_begin(&st, STATS_BLS75, n, effort, 0, 0);
+  result = _primality_bls_np1(n, effort, prooftextptr);
+  stats_end(&st, result != 1, 0);
+  return result;
+}
+
+
+/*****************************************************************************/
+/* Proofs given prime factors of n-1 or n+1 that the caller knows, e.g.
+ * from the form of n:  k*p#+1, n!-1, a^m+1, and so on.  We skip factoring
+ * and go straight to the theorem checks. */
+
+/* Append q to fstack as a proven prime, adding its proof to *prooftextptr.
+ * Returns 0 if q could not be proven. */
+static int _push_proven(mpz_t q, mpz_t* fstack, int* fsp, char** prooftextptr)
+{
+  int res = _GMP_is_prob_prime(q);
+  if (res == 1) {
+    char* qtext = 0;
+    res = _GMP_is_provable_prime(q, (prooftextptr != 0) ? &qtext : 0);
+    if (res == 2 && qtext != 0) {
+      if (*prooftextptr == 0) {
+        *prooftextptr = qtext;
+      } else {
+        char* s;
+        New(0, s, strlen(*prooftextptr) + strlen(qtext) + 2, char);
+        strcpy(s, *prooftextptr);
+        strcat(s, "\n");
+        strcat(s, qtext);
+        Safefree(*prooftextptr);
+        Safefree(qtext);
+        *prooftextptr = s;
+      }
+    } else if (qtext != 0) {
+      Safefree(qtext);
+    }
+  }
+  if (res != 2) return 0;
+  mpz_init_set(fstack[(*fsp)++], q);
   return 1;
 }
 
+/* R = n-1 or n+1 on entry, the unfactored part on return.  Pushes the
+ * small primes and the given primes f[0..nf) dividing R onto fstack, which
+ * must have room for nf+KNOWN_TF_MAX entries.  Returns the count, or -1
+ * if a given factor could not be proven. */
+#define KNOWN_TF_LIMIT 2000
+#define KNOWN_TF_MAX    303       /* primes below 2000 */
+static int _known_factors(mpz_t R, mpz_t* f, int nf, mpz_t* fstack,
+                          char** prooftextptr)
+{
+  int i, fsp = 0;
+  PRIME_ITERATOR(iter);
+  UV tf;
+  for (tf = 2; tf < KNOWN_TF_LIMIT; tf = prime_iterator_next(&iter)) {
+    if (mpz_divisible_ui_p(R, tf)) {
+      mpz_init_set_ui(fstack[fsp++], tf);
+      do {
+        mpz_divexact_ui(R, R, tf);
+      } while (mpz_divisible_ui_p(R, tf));
+    }
+  }
+  prime_iterator_destroy(&iter);
+  for (i = 0; i < nf; i++) {
+    if (!mpz_divisible_p(R, f[i]))     /* a small prime or a repeat */
+      continue;
+    if (!_push_proven(f[i], fstack, &fsp, prooftextptr)) {
+      while (fsp-- > 0)  mpz_clear(fstack[fsp]);
+      return -1;
+    }
+    do {
+      mpz_divexact(R, R, f[i]);
+    } while (mpz_divisible_p(R, f[i]));
+  }
+  return fsp;
+}
+
+/* Check that each given factor is a prime dividing m. */
+static void _check_known(const char* name, const char* which, mpz_t m, mpz_t* f, int nf)
+{
+  int i;
+  for (i = 0; i < nf; i++) {
+    if (mpz_cmp_ui(f[i], 2) < 0 || !mpz_divisible_p(m, f[i]))
+      croak("%s: factor does not divide %s", name, which);
+    if (!_GMP_is_prob_prime(f[i]))
+      croak("%s: factor is not prime", name);
+  }
+}
+
+int _GMP_primality_bls_nm1_known(mpz_t n, mpz_t* f, int nf, char** prooftextptr)
+{
+  mpz_t nm1, R, A, t, y, r, s;
+  mpz_t* fstack;
+  int fsp, result = 1;
+  char* ftext = 0;
+
+  if (mpz_cmp_ui(n, 3) <= 0)  return (mpz_cmp_ui(n, 2) >= 0) ? 2 : 0;
+  if (mpz_even_p(n))  return 0;
+  MPUassert(prooftextptr == 0 || *prooftextptr == 0, "prooftext not empty");
+  mpz_init(nm1);
+  mpz_sub_ui(nm1, n, 1);
+  _check_known("prove_nminus1", "n-1", nm1, f, nf);
+  if (!_GMP_is_prob_prime(n)) { mpz_clear(nm1); return 0; }
+
+  mpz_init_set(R, nm1);
+  New(0, fstack, nf + KNOWN_TF_MAX + 1, mpz_t);
+  fsp = _known_factors(R, f, nf, fstack, (prooftextptr != 0) ? &ftext : 0);
+  if (fsp > 0) {
+    mpz_init(A);  mpz_init(t);  mpz_init(y);  mpz_init(r);  mpz_init(s);
+    mpz_divexact(A, nm1, R);
+    /* If not enough is known, see if the cofactor is a prime we can prove */
+    if (mpz_cmp_ui(R, 1) > 0 && !bls_theorem5_limit(n, A, R, t, y, r, s) &&
+        _push_proven(R, fstack, &fsp, (prooftextptr != 0) ? &ftext : 0)) {
+      mpz_set(A, nm1);
+      mpz_set_ui(R, 1);
+    }
+    result = bls_theorem5_limit(n, A, R, t, y, r, s);
+    mpz_clear(A);  mpz_clear(t);  mpz_clear(y);  mpz_clear(r);  mpz_clear(s);
+    result = _bls_theorem5_proof(n, nm1, fstack, fsp, result, 3,
+                                 (prooftextptr != 0) ? &ftext : 0);
+  }
+  if (result == 2 && prooftextptr != 0)  *prooftextptr = ftext;
+  else if (ftext != 0)                   Safefree(ftext);
+  Safefree(fstack);
+  mpz_clear(R);
+  mpz_clear(nm1);
+  return result;
+}
+
+int _GMP_primality_bls_np1_known(mpz_t n, mpz_t* f, int nf, char** prooftextptr)
+{
+  mpz_t np1, R, F, t;
+  mpz_t* fstack;
+  int i, j, fsp, result = 1;
+  char* ftext = 0;
+
+  if (mpz_cmp_ui(n, 3) <= 0)  return (mpz_cmp_ui(n, 2) >= 0) ? 2 : 0;
+  if (mpz_even_p(n))  return 0;
+  MPUassert(prooftextptr == 0 || *prooftextptr == 0, "prooftext not empty");
+  mpz_init(np1);
+  mpz_add_ui(np1, n, 1);
+  _check_known("prove_nplus1", "n+1", np1, f, nf);
+  if (!_GMP_is_prob_prime(n)) { mpz_clear(np1); return 0; }
+
+  mpz_init_set(R, np1);
+  mpz_init(F);
+  mpz_init(t);
+  New(0, fstack, nf + KNOWN_TF_MAX + 2, mpz_t);
+  fsp = _known_factors(R, f, nf, fstack, (prooftextptr != 0) ? &ftext : 0);
+
+  /* A prime cofactor might be large enough for theorem 15 */
+  if (fsp > 0 && mpz_cmp_ui(R, 1) > 0 && _GMP_is_prob_prime(R)) {
+    mpz_mul_ui(t, R, 2);
+    mpz_sub_ui(t, t, 1);
+    mpz_mul(t, t, t);
+    if (mpz_cmp(t, n) > 0 &&
+        _push_proven(R, fstack, &fsp, (prooftextptr != 0) ? &ftext : 0))
+      mpz_set_ui(R, 1);
+  }
+  /* Sort largest first after the 2 */
+  for (i = 2; i < fsp; i++)
+    for (j = i; j > 1 && mpz_cmp(fstack[j-1], fstack[j]) < 0; j--)
+      mpz_swap(fstack[j-1], fstack[j]);
+
+  if (fsp > 0) {
+    IV lp, lq;
+    mpz_ptr q = fstack[(fsp > 1) ? 1 : 0];
+    /* Theorem 15 with the largest prime q, if 2q-1 > sqrt(n) */
+    if (_GMP_primality_bls_15(n, q, &lp, &lq) == 2) {
+      result = 2;
+      if (prooftextptr != 0) {
+        char *proofstr, *proofptr;
+        int curprooflen = (ftext == 0) ? 0 : strlen(ftext);
+        int myprooflen = 20 + 2*(4 + mpz_sizeinbase(n, 10)) + 2*21;
+        New(0, proofstr, myprooflen + curprooflen + 1, char);
+        proofptr = proofstr;
+        proofptr += gmp_sprintf(proofptr, "Type BLS15\nN  %Zd\nQ  %Zd\nLP %"IVdf"\nLQ %"IVdf"\n", n, q, lp, lq);
+        if (ftext) {
+          proofptr += gmp_sprintf(proofptr, "\n");
+          strcat(proofptr, ftext);
+          Safefree(ftext);
+        }
+        ftext = proofstr;
+      }
+    } else {
+      /* The n+1 analogue of theorem 5, using a prime cofactor if needed */
+      mpz_set_ui(F, 1);
+      for (i = 0; i < fsp; i++) {
+        mpz_remove(t, np1, fstack[i]);
+        mpz_divexact(t, np1, t);
+        mpz_mul(F, F, t);
+      }
+      if (mpz_cmp_ui(R, 1) > 0 && !bls_np1_limit(n, F, t) &&
+          _GMP_is_prob_prime(R) &&
+          _push_proven(R, fstack, &fsp, (prooftextptr != 0) ? &ftext : 0))
+        mpz_set_ui(R, 1);
+      result = _bls_np1_proof(n, np1, fstack, fsp, 1,
+                              (prooftextptr != 0) ? &ftext : 0);
+      fsp = 0;
+    }
+  }
+  if (result == 2 && prooftextptr != 0)  *prooftextptr = ftext;
+  else if (ftext != 0)                   Safefree(ftext);
+  while (fsp-- > 0)
+    mpz_clear(fstack[fsp]);
+  Safefree(fstack);
+  mpz_clear(t);
+  mpz_clear(F);
+  mpz_clear(R);
+  mpz_clear(np1);
+  return result;
+}
+
 
 
 /* Given an n where we're factored n-1 down to p, check BLS theorem 3 */
@@ -712,6 +1358,8 @@ int _GMP_primality_bls_np1_split(mpz_t n, int effort, mpz_t q, IV* lp, IV* lq)
       success = 1;
       break;
     }
+    if (budget_expired())
+      break;
     success = try_factor(f, q, effort);
     if (!success)
       success = try_factor2(f, q, effort);
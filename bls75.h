@@ -26,5 +26,14 @@ extern int _GMP_primality_bls_np1_split(mpz_t n, int effort, mpz_t q, IV* lp, IV
 /* This does a complete recursive proof */
 /* BLS75 theorem 5/7 complete proof */
 extern int _GMP_primality_bls_nm1(mpz_t n, int effort, char ** prooftextptr);
+/* BLS75 theorem 14 with an n < F^3 bound, complete proof */
+extern int _GMP_primality_bls_np1(mpz_t n, int effort, char ** prooftextptr);
+
+/* Complete proofs given primes f[0..nf) dividing n-1 or n+1 (e.g. known
+ * from the form of n), so no factoring is done.  Croaks if a factor is not
+ * a prime divisor.  The n+1 proof uses theorem 15 if the largest prime is
+ * big enough, otherwise the same check as _GMP_primality_bls_np1. */
+extern int _GMP_primality_bls_nm1_known(mpz_t n, mpz_t* f, int nf, char ** prooftextptr);
+extern int _GMP_primality_bls_np1_known(mpz_t n, mpz_t* f, int nf, char ** prooftextptr);
 
 #endif
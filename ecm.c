@@ -8,6 +8,7 @@
 #include "ptypes.h"
 #include "ecm.h"
 #include "utility.h"
+#include "stats.h"
 #include "prime_iterator.h"
 
 #define USE_PRAC
@@ -107,13 +108,14 @@ int ec_affine_multiply(mpz_t a, mpz_t k, mpz_t n, struct ec_affine_point P, stru
 {
   int found = 0;
   struct ec_affine_point A, B, C;
-  mpz_t t, t2, t3, mult;
+  UV mark = scratch_mark(), bits = 2*mpz_sizeinbase(n, 2) + BITS_PER_WORD;
+  mpz_ptr t = scratch_mpz(bits), t2 = scratch_mpz(bits), t3 = scratch_mpz(bits);
+  mpz_ptr mult = scratch_mpz(bits);  /* holds intermediates, gcd at end */
 
   mpz_init(A.x); mpz_init(A.y);
   mpz_init(B.x); mpz_init(B.y);
   mpz_init(C.x); mpz_init(C.y);
-  mpz_init(t);   mpz_init(t2);   mpz_init(t3);
-  mpz_init_set_ui(mult, 1);  /* holds intermediates, gcd at end */
+  mpz_set_ui(mult, 1);
 
   mpz_set(A.x, P.x);  mpz_set(A.y, P.y);
   mpz_set_ui(B.x, 0); mpz_set_ui(B.y, 1);
@@ -151,8 +153,7 @@ int ec_affine_multiply(mpz_t a, mpz_t k, mpz_t n, struct ec_affine_point P, stru
   mpz_tdiv_r(R->x, B.x, n);
   mpz_tdiv_r(R->y, B.y, n);
 
-  mpz_clear(mult);
-  mpz_clear(t);   mpz_clear(t2);   mpz_clear(t3);
+  scratch_release(mark);
   mpz_clear(A.x); mpz_clear(A.y);
   mpz_clear(B.x); mpz_clear(B.y);
   mpz_clear(C.x); mpz_clear(C.y);
@@ -160,7 +161,7 @@ int ec_affine_multiply(mpz_t a, mpz_t k, mpz_t n, struct ec_affine_point P, stru
   return found;
 }
 
-int _GMP_ecm_factor_affine(mpz_t n, mpz_t f, UV B1, UV ncurves)
+static int _ecm_factor_affine(mpz_t n, mpz_t f, UV B1, UV ncurves)
 {
   mpz_t a, mk;
   struct ec_affine_point X, Y;
@@ -175,7 +176,7 @@ int _GMP_ecm_factor_affine(mpz_t n, mpz_t f, UV B1, UV ncurves)
 
   for (B = 100; B < B1*5; B *= 5) {
     if (B*5 > 2*B1) B = B1;
-    for (curve = 0; curve < ncurves; curve++) {
+    for (curve = 0; curve < ncurves && !budget_expired(); curve++) {
       PRIME_ITERATOR(iter);
       mpz_urandomm(a, *p_randstate, n);
       mpz_set_ui(X.x, 0); mpz_set_ui(X.y, 1);
@@ -210,6 +211,16 @@ int _GMP_ecm_factor_affine(mpz_t n, mpz_t f, UV B1, UV ncurves)
   return 0;
 }
 
+int _GMP_ecm_factor_affine(mpz_t n, mpz_t f, UV B1, UV ncurves)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_ECM, n, B1, 0, ncurves);
+  success = _ecm_factor_affine(n, f, B1, ncurves);
+  stats_end(&st, success, f);
+  return success;
+}
+
 
 /*******************************************************************/
 
@@ -546,7 +557,7 @@ static int ec_stage2(UV B1, UV B2, mpz_t x, mpz_t z, mpz_t f)
         }
         mpz_gcd(f, g, ecn);
         found = mpz_cmp_ui(f, 1);
-        if (found) break;
+        if (found || budget_expired()) break;
       }
     }
   } while (0);
@@ -565,7 +576,7 @@ static int ec_stage2(UV B1, UV B2, mpz_t x, mpz_t z, mpz_t f)
   return (found) ? 2 : 0;
 }
 
-int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
+static int _ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
 {
   mpz_t sigma, a, x, z;
   UV i, curve, q, k;
@@ -587,7 +598,7 @@ int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
 
   if (_verbose>2) gmp_printf("# ecm trying %Zd (B1=%lu B2=%lu ncurves=%lu)\n", n, (unsigned long)B1, (unsigned long)B2, (unsigned long)ncurves);
 
-  for (curve = 0; curve < ncurves; curve++) {
+  for (curve = 0; curve < ncurves && !budget_expired(); curve++) {
     PRIME_ITERATOR(iter);
     do {
       mpz_urandomm(sigma, *p_randstate, n);
@@ -650,7 +661,7 @@ int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
       mpz_mulmod(sigma, sigma, x, ecn, w);
       if (i++ % 32 == 0) {
         mpz_gcd(f, sigma, ecn);
-        if (mpz_cmp_ui(f, 1))  break;
+        if (mpz_cmp_ui(f, 1) || budget_expired())  break;
       }
     }
     prime_iterator_destroy(&iter);
@@ -664,7 +675,7 @@ int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
     if (found) { if (!mpz_cmp(f, n)) { found = 0; continue; } break; }
 
     /* Stage 2 */
-    if (!found && B2 > B1)
+    if (!found && B2 > B1 && !budget_expired())
       found = ec_stage2(B1, B2, x, z, f);
 
     if (found) { if (!mpz_cmp(f, n)) { found = 0; continue; } break; }
@@ -684,3 +695,13 @@ int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
 
   return found;
 }
+
+int _GMP_ecm_factor_projective(mpz_t n, mpz_t f, UV B1, UV B2, UV ncurves)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_ECM, n, B1, B2, ncurves);
+  success = _ecm_factor_projective(n, f, B1, B2, ncurves);
+  stats_end(&st, success, f);
+  return success;
+}
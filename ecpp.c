@@ -67,6 +67,7 @@
 #include "gmp_main.h"  /* is_prob_prime, pminus1_factor, miller_rabin_random */
 #include "ecm.h"
 #include "utility.h"
+#include "stats.h"
 #include "prime_iterator.h"
 #include "bls75.h"
 
@@ -582,6 +583,118 @@ static void choose_m(mpz_t* mlist, long D, mpz_t u, mpz_t v, mpz_t N,
 
 
 
+/* Discriminant ordering.  poly_class_nums sorts the D values by class
+ * polynomial degree, and the backtracking (maxH) depends on that, so within
+ * each degree we try first the D most likely to give a curve order m with a
+ * usable q.  That is helped by m having a large smooth part.  With CM by D,
+ * a prime l divides m about 2/(l-1) of the time if l splits in Q(sqrt(D)),
+ * 1/(l-1) if it ramifies, and 1/(l^2-1) if it is inert, against 1/(l-1)
+ * for a random integer.  The expected extra log of the small part of m
+ * gives each D a prior, scaled by the number of m values (6 for D=-3, 4 for
+ * D=-4, else 2).  At a fixed degree (class number) the smallest |D| tend
+ * to have the most split primes, so this mostly agrees with the table
+ * order, but not everywhere.  Hits and tries for each D during this proof
+ * then adjust the prior, and the list is re-ranked for each level and
+ * stage.  Children re-rank while a parent is part way through its list,
+ * so each pass works from its own copy. */
+typedef struct {
+  int*    dilist;     /* poly indices sorted by degree, 0 terminated */
+  int     ndi;
+  int*    degree;     /* by poly index:  class poly degree */
+  double* prior;      /* by poly index:  relative yield */
+  double* est;        /* by poly index:  current yield estimate */
+  UV*     tries;      /* m values factored this proof */
+  UV*     hits;       /* and how many gave a usable q */
+  char*   skip;       /* D values with bad class polys */
+  UV      ntries, nhits;
+} dorder_t;
+
+#define DORDER_SCALE  0.25  /* prior = exp(SCALE * expected extra log) */
+#define DORDER_PSEUDO 20    /* tries the prior is worth */
+static const unsigned char _dorder_primes[] =
+  {2,3,5,7,11,13,17,19,23,29,31,37,41,43,47};
+
+static void dorder_init(dorder_t* dord)
+{
+  int i, j, D;
+  mpz_t t;
+
+  dord->dilist = poly_class_nums();
+  for (dord->ndi = 0; dord->dilist[dord->ndi] != 0; dord->ndi++)
+    ;
+  New(0, dord->degree, dord->ndi+1, int);
+  New(0, dord->prior, dord->ndi+1, double);
+  New(0, dord->est, dord->ndi+1, double);
+  Newz(0, dord->tries, dord->ndi+1, UV);
+  Newz(0, dord->hits, dord->ndi+1, UV);
+  Newz(0, dord->skip, dord->ndi+1, char);
+  dord->ntries = dord->nhits = 0;
+  mpz_init(t);
+  for (i = 1; i <= dord->ndi; i++) {
+    double extra = 0.0;
+    dord->degree[i] = poly_class_poly_num(i, &D, NULL, NULL);
+    if (dord->degree[i] == 0)  croak("Unknown class poly %d\n", i);
+    for (j = 0; j < (int)sizeof(_dorder_primes); j++) {
+      double e, fl = _dorder_primes[j];
+      int k;
+      mpz_set_ui(t, _dorder_primes[j]);
+      k = mpz_si_kronecker(D, t);
+      if      (k == 1)  e = 2*fl / ((fl-1)*(fl-1));
+      else if (k == 0)  e =   fl / ((fl-1)*(fl-1));
+      else              e = 2*fl*fl / ((fl*fl-1)*(fl*fl-1));
+      extra += (e - 1/(fl-1)) * log(fl);
+    }
+    dord->prior[i] = exp(DORDER_SCALE * extra)
+                   * ((D == -3) ? 3 : (D == -4) ? 2 : 1);
+  }
+  mpz_clear(t);
+}
+
+static void dorder_destroy(dorder_t* dord)
+{
+  Safefree(dord->dilist);
+  Safefree(dord->degree);
+  Safefree(dord->prior);
+  Safefree(dord->est);
+  Safefree(dord->tries);
+  Safefree(dord->hits);
+  Safefree(dord->skip);
+}
+
+/* Fill list (ndi+1 entries) with the usable poly indices, each degree
+ * sorted by estimated yield. */
+static void dorder_rank(dorder_t* dord, int* list)
+{
+  int i, j, start, n = 0;
+  double base, *est = dord->est;
+
+  /* Hit rate per m value overall, so the prior is on the same scale */
+  base = (dord->nhits + 1.0) / (dord->ntries + 10.0);
+  for (i = 0; i < dord->ndi; i++) {
+    int pi = dord->dilist[i];
+    if (dord->skip[pi])  continue;
+    est[pi] = (dord->hits[pi] + DORDER_PSEUDO * base * dord->prior[pi])
+            / (dord->tries[pi] + DORDER_PSEUDO);
+    list[n++] = pi;
+  }
+  list[n] = 0;
+  /* Insertion sort each run of equal degree, best first, keeping order */
+  for (start = 0; start < n; start = i) {
+    for (i = start+1; i < n && dord->degree[list[i]] == dord->degree[list[start]]; i++) {
+      int pi = list[i];
+      for (j = i; j > start && est[list[j-1]] < est[pi]; j--)
+        list[j] = list[j-1];
+      list[j] = pi;
+    }
+  }
+}
+
+static void dorder_count(dorder_t* dord, int pindex, int hit)
+{
+  dord->tries[pindex]++;  dord->ntries++;
+  if (hit) { dord->hits[pindex]++;  dord->nhits++; }
+}
+
 /* This is the "factor all strategy" FAS version, which ends up being a lot
  * simpler than the FPS code.
  *
@@ -599,7 +712,7 @@ static void choose_m(mpz_t* mlist, long D, mpz_t u, mpz_t v, mpz_t N,
   }
 
 /* Recursive routine to prove via ECPP */
-static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz_t* sfacs, int* nsfacs, char** prooftextptr)
+static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, dorder_t* dord, mpz_t* sfacs, int* nsfacs, char** prooftextptr)
 {
   mpz_t a, b, u, v, m, q, minfactor, sqrtn, mD, t, t2;
   mpz_t mlist[6];
@@ -607,6 +720,8 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
   UV nm1a;
   IV np1lp, np1lq;
   struct ec_affine_point P;
+  sqrtmod_ctx_t sqrtctx;
+  int* dilist;
   int k, dindex, pindex, nidigits, facresult, curveresult, downresult, stage, D;
   int verbose = get_verbose_level();
 
@@ -639,6 +754,9 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
     mpz_init(mlist[k]);
     mpz_init(qlist[k]);
   }
+  /* Square roots of the primes in the discriminants, shared by all D */
+  sqrtmod_ctx_init(&sqrtctx, Ni);
+  New(0, dilist, dord->ndi+1, int);
 
   /* Any factors q found must be strictly > minfactor.
    * See Atkin and Morain, 1992, section 6.4 */
@@ -652,11 +770,16 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
   if (i == 0 && facstage > 1)  stage = facstage;
   for ( ; stage <= facstage; stage++) {
     int next_stage = (stage > 1) ? stage : 1;
+    dorder_rank(dord, dilist);
     for (dindex = -1; dindex < 0 || dilist[dindex] != 0; dindex++) {
       int poly_type;  /* just for debugging/verbose */
       int poly_degree;
       int allq = (nidigits < 400);  /* Do all q values together, or not */
 
+      if (budget_expired()) {       /* Out of time, leave it unproven */
+        downresult = 1;
+        goto end_down;
+      }
       if (dindex == -1) {   /* n-1 and n+1 tests */
         int nm1_success = 0;
         int np1_success = 0;
@@ -678,7 +801,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
         else if (np1_success > 0) {  ptype = "n+1";  mpz_set(q, v);  D = -1; }
         else                      continue;
         if (verbose) { printf(" %s\n", ptype); fflush(stdout); }
-        downresult = ecpp_down(i+1, q, next_stage, pmaxH, dilist, sfacs, nsfacs, prooftextptr);
+        downresult = ecpp_down(i+1, q, next_stage, pmaxH, dord, sfacs, nsfacs, prooftextptr);
         if (downresult == 0) goto end_down;   /* composite */
         if (downresult == 1) {   /* nothing found at this stage */
           VERBOSE_PRINT_N(i, nidigits, *pmaxH, facstage);
@@ -720,7 +843,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
       /* (D/N) must be 1, and we have to have a u,v solution */
       if (mpz_jacobi(mD, Ni) != 1)
         continue;
-      if ( ! modified_cornacchia(u, v, mD, Ni) )
+      if ( ! modified_cornacchia_ctx(u, v, D, &sqrtctx) )
         continue;
 
       if (verbose > 1)
@@ -738,6 +861,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
           mpz_set_ui(qlist[k], 0);
           if (mpz_sgn(mlist[k])) {
             facresult = check_for_factor(qlist[k], mlist[k], minfactor, t, stage, sfacs, nsfacs, poly_degree);
+            dorder_count(dord, pindex, facresult > 0);
             /* -1 = couldn't find, 0 = no big factors, 1 = found */
             if (facresult <= 0)
               mpz_set_ui(qlist[k], 0);
@@ -766,6 +890,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
           if (mpz_sgn(mlist[k]) == 0) continue;
           mpz_set(m, mlist[k]);
           facresult = check_for_factor(q, m, minfactor, t, stage, sfacs, nsfacs, poly_degree);
+          dorder_count(dord, pindex, facresult > 0);
           if (facresult <= 0) continue;
         }
 
@@ -779,7 +904,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
           maxH--;
         }
         /* Great, now go down. */
-        downresult = ecpp_down(i+1, q, next_stage, &maxH, dilist, sfacs, nsfacs, prooftextptr);
+        downresult = ecpp_down(i+1, q, next_stage, &maxH, dord, sfacs, nsfacs, prooftextptr);
         /* Nothing found, look at more polys in the future */
         if (downresult == 1 && *pmaxH > 0)  *pmaxH = maxH;
 
@@ -805,6 +930,7 @@ static int ecpp_down(int i, mpz_t Ni, int facstage, int *pmaxH, int* dilist, mpz
           /* Something is wrong.  Very likely the class poly coefficients are
              incorrect.  We've wasted lots of time, and need to try again. */
           dilist[dindex] = -2; /* skip this D value from now on */
+          dord->skip[pindex] = 1;
           if (verbose) gmp_printf("\n  Invalidated D = %d with N = %Zd\n", D, Ni);
           downresult = 1;
           continue;
@@ -891,14 +1017,16 @@ end_down:
     mpz_clear(mlist[k]);
     mpz_clear(qlist[k]);
   }
+  sqrtmod_ctx_destroy(&sqrtctx);
+  Safefree(dilist);
 
   return downresult;
 }
 
 /* returns 2 if N is proven prime, 1 if probably prime, 0 if composite */
-int _GMP_ecpp(mpz_t N, char** prooftextptr)
+static int _ecpp(mpz_t N, char** prooftextptr)
 {
-  int* dilist;
+  dorder_t dord;
   mpz_t* sfacs;
   int i, fstage, result, nsfacs;
   UV nsize = mpz_sizeinbase(N,2);
@@ -915,18 +1043,18 @@ int _GMP_ecpp(mpz_t N, char** prooftextptr)
     *prooftextptr = 0;
 
   New(0, sfacs, MAX_SFACS, mpz_t);
-  dilist = poly_class_nums();
+  dorder_init(&dord);
   nsfacs = 0;
   result = 1;
   for (fstage = 1; fstage < 20; fstage++) {
     int maxH = 0;
     if (fstage == 3 && get_verbose_level())
       gmp_printf("Working hard on: %Zd\n", N);
-    result = ecpp_down(0, N, fstage, &maxH, dilist, sfacs, &nsfacs, prooftextptr);
-    if (result != 1)
+    result = ecpp_down(0, N, fstage, &maxH, &dord, sfacs, &nsfacs, prooftextptr);
+    if (result != 1 || budget_expired())
       break;
   }
-  Safefree(dilist);
+  dorder_destroy(&dord);
   for (i = 0; i < nsfacs; i++)
     mpz_clear(sfacs[i]);
   Safefree(sfacs);
@@ -934,6 +1062,16 @@ int _GMP_ecpp(mpz_t N, char** prooftextptr)
   return result;
 }
 
+int _GMP_ecpp(mpz_t N, char** prooftextptr)
+{
+  stats_timer_t st;
+  int result;
+  stats_begin(&st, STATS_ECPP, N, 0, 0, 0);
+  result = _ecpp(N, prooftextptr);
+  stats_end(&st, result != 1, 0);
+  return result;
+}
+
 
 #ifdef STANDALONE_ECPP
 static void dieusage(char* prog) {
@@ -43,7 +43,7 @@
 
 #define MAX_LINE_LEN 60000
 #define MAX_STEPS    20000
-#define MAX_QARRAY   100
+#define MAX_QARRAY   1000
 #define BAD_LINES_ALLOWED  5    /* Similar to WraithX's verifier */
 
 typedef unsigned long UV;
@@ -1172,6 +1172,75 @@ void verify_bls5(int num_qs) {
   }
 }
 
+/* N+1 version of BLS5 using N, D (in LP), QARRAY, and AARRAY holding the
+ * Lucas P for each Q (0 for the default).  From BLS75 theorem 14 every
+ * prime factor of N is +/-1 mod F, so if N < (F-1)^3 a composite N is
+ * (aF+1)(bF-1) with R = abF + (b-a) and |b-a| < F, making r^2+4s a square
+ * for R = sF+r with r = R mod F or that minus F.
+ */
+void verify_np1(int num_qs) {
+  int i, j;
+  IV D, P0, P, LQi;
+  mpz_t F, R, s, r, U, V, Qk;
+
+  if (mpz_cmp_ui(N, 2) <= 0)   quit_invalid("NP1", "N > 2");
+  if (mpz_even_p(N))           quit_invalid("NP1", "N odd");
+  D = mpz_get_si(LP);
+  if (mpz_cmp_si(LP, D) != 0 || D > 1000000 || D < -1000000)
+                               quit_error("NP1 D out of range", "");
+  if (((D % 4) + 4) % 4 > 1)   quit_invalid("NP1", "D = 0 or 1 mod 4");
+  if (mpz_jacobi(LP, N) != -1) quit_invalid("NP1", "jacobi(D,N) = -1");
+  P0 = (D & 1) ? 1 : 2;
+  mpz_add_ui(T2, N, 1);
+  mpz_init_set_ui(F, 1);
+  mpz_init_set(R, T2);
+  mpz_init(s);  mpz_init(r);  mpz_init(U);  mpz_init(V);  mpz_init(Qk);
+  for (i = 0; i < num_qs; i++) {
+    if (mpz_cmp_ui(QARRAY[i], 1 ) <= 0)  quit_invalid("NP1", "Q > 1");
+    if (mpz_cmp(   QARRAY[i], N ) >= 0)  quit_invalid("NP1", "Q < N");
+    if (!mpz_divisible_p(T2, QARRAY[i])) quit_invalid("NP1", "Q divides N+1");
+    while (mpz_divisible_p(R, QARRAY[i])) {
+      mpz_mul(F, F, QARRAY[i]);
+      mpz_divexact(R, R, QARRAY[i]);
+    }
+  }
+  mpz_sub_ui(T1, F, 1);
+  mpz_pow_ui(T1, T1, 3);
+  if (mpz_cmp(N, T1) >= 0)     quit_invalid("NP1", "N < (F-1)^3");
+  mpz_tdiv_r(r, R, F);
+  for (j = 0; j < 2; j++) {
+    if (j == 1)  mpz_sub(r, r, F);
+    mpz_sub(s, R, r);
+    mpz_divexact(s, s, F);
+    if (mpz_sgn(s) <= 0)  continue;
+    mpz_mul(T1, r, r);
+    mpz_addmul_ui(T1, s, 4);
+    if (mpz_perfect_square_p(T1))  quit_invalid("NP1", "r^2+4s not a perfect square");
+  }
+  for (i = 0; i < num_qs; i++) {
+    if (mpz_sgn(AARRAY[i]) == 0) {
+      P = P0;
+    } else {
+      P = mpz_get_si(AARRAY[i]);
+      if (mpz_cmp_si(AARRAY[i], P) != 0 || P <= 0 || P > 1000000)
+                               quit_error("NP1 P out of range", "");
+    }
+    if ((P & 1) != (D & 1))    quit_invalid("NP1", "P = D mod 2");
+    LQi = (P*P - D) / 4;
+    mpz_set_si(T1, 2*LQi);
+    mpz_gcd(T1, T1, N);
+    if (mpz_cmp_ui(T1, 1) != 0)  quit_invalid("NP1", "gcd(N, 2Q) = 1");
+    lucas_seq(U, V, N, P, LQi, T2, Qk, T1);
+    if (mpz_sgn(U) != 0)       quit_invalid("NP1", "U_{N+1} mod N = 0");
+    mpz_divexact(s, T2, QARRAY[i]);
+    lucas_seq(U, V, N, P, LQi, s, Qk, T1);
+    mpz_gcd(T1, U, N);
+    if (mpz_cmp_ui(T1, 1) != 0)  quit_invalid("NP1", "gcd(U_{(N+1)/Q[i]}, N) = 1");
+  }
+  mpz_clear(F); mpz_clear(R); mpz_clear(s); mpz_clear(r);
+  mpz_clear(U); mpz_clear(V); mpz_clear(Qk);
+}
+
 /* Most basic N-1 using N, QARRAY, A
  *
  * D.H. Lehmer, "Tests for Primality by the Converse of Fermat's Theorem"
@@ -1572,7 +1641,7 @@ void process_file(const char* filename)
             } else if (sscanf(_line, "N %s", _vstr) == 1) {
               mpz_set_str(N, _vstr, _base);
             } else if (sscanf(_line, "Q[%d] %s", &i, _vstr) == 2) {
-              if (i != index) quit_error("BLS5", "Invalid Q index");
+              if (i != index || i >= MAX_QARRAY) quit_error("BLS5", "Invalid Q index");
               mpz_set_str(QARRAY[i], _vstr, _base);
               index++;
             } else if (sscanf(_line, "A[%d] %s", &i, _vstr) == 2) {
@@ -1583,6 +1652,35 @@ void process_file(const char* filename)
           verify_bls5(index);
           for (i = 0; i < index; i++)
             add_chain(N, QARRAY[i]);
+        } else if (strcmp(type, "NP1") == 0) {
+          int i, index;
+          for (index = 0; index < MAX_QARRAY; index++) {
+            mpz_set_ui(QARRAY[index], 0);
+            mpz_set_ui(AARRAY[index], 0);
+          }
+          mpz_set_ui(QARRAY[0], 2);
+          mpz_set_ui(LP, 0);
+          index = 1;
+          while (1) {
+            get_line(0);
+            if (_line[0] == '-') {
+              break;
+            } else if (sscanf(_line, "N %s", _vstr) == 1) {
+              mpz_set_str(N, _vstr, _base);
+            } else if (sscanf(_line, "D %s", _vstr) == 1) {
+              mpz_set_str(LP, _vstr, _base);
+            } else if (sscanf(_line, "Q[%d] %s", &i, _vstr) == 2) {
+              if (i != index || i >= MAX_QARRAY) quit_error("NP1", "Invalid Q index");
+              mpz_set_str(QARRAY[i], _vstr, _base);
+              index++;
+            } else if (sscanf(_line, "P[%d] %s", &i, _vstr) == 2) {
+              if (i < 0 || i >= index) quit_error("NP1", "Invalid P index");
+              mpz_set_str(AARRAY[i], _vstr, _base);
+            }
+          }
+          verify_np1(index);
+          for (i = 0; i < index; i++)
+            add_chain(N, QARRAY[i]);
         } else if (strcmp(type, "LUCAS") == 0) {
           int i, index;
           for (index = 0; index < MAX_QARRAY; index++)
@@ -1593,7 +1691,7 @@ void process_file(const char* filename)
             if        (sscanf(_line, "N %s", _vstr) == 1) {
               mpz_set_str(N, _vstr, _base);
             } else if (sscanf(_line, "Q[%d] %s", &i, _vstr) == 2) {
-              if (i != index) quit_error("Lucas", "Invalid Q index");
+              if (i != index || i >= MAX_QARRAY) quit_error("Lucas", "Invalid Q index");
               mpz_set_str(QARRAY[i], _vstr, _base);
               index++;
             } else if (sscanf(_line, "A %s", _vstr) == 1) {
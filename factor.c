@@ -150,6 +150,10 @@ int factor(mpz_t input_n, mpz_t* pfactors[], int* pexponents[])
       int o = get_verbose_level();
       UV nbits, B1 = 5000;
 
+      /* Out of time: n and anything on the stack go in unfactored */
+      if (budget_expired())
+        break;
+
       /*
        * This set of operations is meant to provide good performance for
        * "random" numbers as input.  Hence we stack lots of effort up front
@@ -334,7 +338,7 @@ int factor(mpz_t input_n, mpz_t* pfactors[], int* pexponents[])
         }
       }
     }
-    /* n is now prime or 1 */
+    /* n is now prime or 1 (or composite if we ran out of time) */
     if (mpz_cmp_ui(n, 1) > 0) {
       ADD_FACTOR(n);
       mpz_set_ui(n, 1);
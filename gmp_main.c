@@ -7,11 +7,26 @@
 #include <gmp.h>
 
 #include "ptypes.h"
+#ifdef STANDALONE
+  #include <unistd.h>   /* write */
+#endif
+#ifndef _WIN32
+  #include <unistd.h>   /* fork, pipe: racing provers */
+  #include <errno.h>
+  #include <poll.h>
+  #include <signal.h>
+  #include <sys/wait.h>
+  #define USE_PROVE_RACE
+#endif
+#ifdef USE_PTHREADS
+  #include <pthread.h>  /* next_prime's parallel BPSW tests */
+#endif
 #include "gmp_main.h"
 #include "prime_iterator.h"
 #include "bls75.h"
 #include "ecpp.h"
 #include "utility.h"
+#include "stats.h"
 #include "factor.h"
 
 #define AKS_VARIANT_V6          1    /* The V6 paper with Lenstra impr */
@@ -23,6 +38,7 @@
 static mpz_t _bgcd;
 static mpz_t _bgcd2;
 static mpz_t _bgcd3;
+static mpz_t _psi13;
 #define BGCD_PRIMES       168
 #define BGCD_LASTPRIME    997
 #define BGCD_NEXTPRIME   1009
@@ -47,6 +63,9 @@ void _GMP_init(void)
   _GMP_pn_primorial(_bgcd, BGCD_PRIMES);   /* mpz_primorial_ui(_bgcd, 1000) */
   mpz_init_set_ui(_bgcd2, 0);
   mpz_init_set_ui(_bgcd3, 0);
+  /* Sorenson and Webster (2015): the least strong pseudoprime to all of
+   * the first 13 prime bases. */
+  mpz_init_set_str(_psi13, "3317044064679887385961981", 10);
   _init_factor();
 }
 
@@ -57,7 +76,9 @@ void _GMP_destroy(void)
   mpz_clear(_bgcd);
   mpz_clear(_bgcd2);
   mpz_clear(_bgcd3);
+  mpz_clear(_psi13);
   destroy_ecpp_gcds();
+  scratch_free();
 }
 
 
@@ -71,25 +92,88 @@ static const unsigned char wheel_retreat[30] =
   {1,2,1,2,3,4,5,6,1,2,3,4,1,2,1,2,3,4,1,2,1,2,3,4,1,2,3,4,5,6};
 
 
+/* Miller-Rabin with n-1 = d*2^s and the temporaries set up once per n,
+ * so any number of bases can be run against the same n.  n must be odd
+ * and greater than 3. */
+void mr_ctx_init(mr_ctx_t* ctx, mpz_t n)
+{
+  UV bits = mpz_sizeinbase(n, 2);
+  ctx->mark = scratch_mark();
+  ctx->n = scratch_mpz(bits);
+  ctx->nminus1 = scratch_mpz(bits);
+  ctx->d = scratch_mpz(bits);
+  ctx->x = scratch_mpz(2*bits);
+  mpz_set(ctx->n, n);
+  mpz_sub_ui(ctx->nminus1, n, 1);
+  ctx->s = mpz_scan1(ctx->nminus1, 0);
+  mpz_tdiv_q_2exp(ctx->d, ctx->nminus1, ctx->s);
+}
+
+void mr_ctx_destroy(mr_ctx_t* ctx)
+{
+  scratch_release(ctx->mark);
+}
+
+int mr_ctx_test(mr_ctx_t* ctx, mpz_t a)
+{
+  mpz_ptr x = ctx->x, n = ctx->n, nminus1 = ctx->nminus1;
+  UV r;
+
+  if (mpz_cmp_ui(a, 1) <= 0)
+    croak("Base %ld is invalid", mpz_get_si(a));
+  /* Handle large and small bases. */
+  if (mpz_cmp(a, n) >= 0)  mpz_mod(x, a, n);
+  else                     mpz_set(x, a);
+  if ( (mpz_cmp_ui(x, 1) <= 0) || (mpz_cmp(x, nminus1) >= 0) )
+    return 1;
+
+  mpz_powm(x, x, ctx->d, n);
+  if (!mpz_cmp_ui(x, 1) || !mpz_cmp(x, nminus1))
+    return 1;
+  for (r = 1; r < ctx->s; r++) {
+    mpz_mul(x, x, x);
+    mpz_mod(x, x, n);
+    if (!mpz_cmp_ui(x, 1))
+      return 0;
+    if (!mpz_cmp(x, nminus1))
+      return 1;
+  }
+  return 0;
+}
+
+int mr_ctx_test_ui(mr_ctx_t* ctx, UV base)
+{
+  int rval;
+  UV mark = scratch_mark();
+  mpz_ptr a = scratch_mpz(BITS_PER_WORD);
+  mpz_set_ui(a, base);
+  rval = mr_ctx_test(ctx, a);
+  scratch_release(mark);
+  return rval;
+}
+
 static INLINE int _GMP_miller_rabin_ui(mpz_t n, UV base)
 {
   int rval;
-  mpz_t a;
-  mpz_init_set_ui(a, base);
+  UV mark = scratch_mark();
+  mpz_ptr a = scratch_mpz(BITS_PER_WORD);
+  mpz_set_ui(a, base);
   rval = _GMP_miller_rabin(n, a);
-  mpz_clear(a);
+  scratch_release(mark);
   return rval;
 }
 
 int _GMP_miller_rabin_random(mpz_t n, UV numbases, char* seedstr)
 {
   gmp_randstate_t* p_randstate = get_randstate();
+  mr_ctx_t ctx;
   mpz_t t, base;
   UV i;
 
   if (numbases == 0)  return 1;
   if (mpz_cmp_ui(n, 100) < 0)     /* tiny n */
     return (_GMP_is_prob_prime(n) > 0);
+  if (mpz_even_p(n))  return 0;
 
   mpz_init(base);  mpz_init(t);
 
@@ -98,21 +182,22 @@ int _GMP_miller_rabin_random(mpz_t n, UV numbases, char* seedstr)
     gmp_randseed(*p_randstate, t);
   }
 
+  mr_ctx_init(&ctx, n);
   mpz_sub_ui(t, n, 3);
   for (i = 0; i < numbases; i++) {
     mpz_urandomm(base, *p_randstate, t);  /* base = 0 .. (n-3)-1 */
     mpz_add_ui(base, base, 2);            /* base = 2 .. n-2     */
-    if (_GMP_miller_rabin(n, base) == 0)
+    if (mr_ctx_test(&ctx, base) == 0)
       break;
   }
+  mr_ctx_destroy(&ctx);
   mpz_clear(base);  mpz_clear(t);
   return (i >= numbases);
 }
 
 int _GMP_miller_rabin(mpz_t n, mpz_t a)
 {
-  mpz_t nminus1, d, x;
-  UV s, r;
+  mr_ctx_t ctx;
   int rval;
 
   {
@@ -123,137 +208,329 @@ int _GMP_miller_rabin(mpz_t n, mpz_t a)
   }
   if (mpz_cmp_ui(a, 1) <= 0)
     croak("Base %ld is invalid", mpz_get_si(a));
-  mpz_init_set(nminus1, n);
-  mpz_sub_ui(nminus1, nminus1, 1);
-  mpz_init_set(x, a);
-
-  /* Handle large and small bases.  Use x so we don't modify their input a. */
-  if (mpz_cmp(x, n) >= 0)
-    mpz_mod(x, x, n);
-  if ( (mpz_cmp_ui(x, 1) <= 0) || (mpz_cmp(x, nminus1) >= 0) ) {
-    mpz_clear(nminus1);
-    mpz_clear(x);
+  if (mpz_cmp_ui(n, 3) == 0)
     return 1;
-  }
-
-  mpz_init_set(d, nminus1);
-  s = mpz_scan1(d, 0);
-  mpz_tdiv_q_2exp(d, d, s);
-
-  mpz_powm(x, x, d, n);
-  mpz_clear(d); /* done with a and d */
-  rval = 0;
-  if (!mpz_cmp_ui(x, 1) || !mpz_cmp(x, nminus1)) {
-    rval = 1;
-  } else {
-    for (r = 1; r < s; r++) {
-      mpz_powm_ui(x, x, 2, n);
-      if (!mpz_cmp_ui(x, 1)) {
-        break;
-      }
-      if (!mpz_cmp(x, nminus1)) {
-        rval = 1;
-        break;
-      }
-    }
-  }
-  mpz_clear(nminus1); mpz_clear(x);
+  mr_ctx_init(&ctx, n);
+  rval = mr_ctx_test(&ctx, a);
+  mr_ctx_destroy(&ctx);
   return rval;
 }
 
-/* Returns Lucas sequence  U_k mod n and V_k mod n  defined by P,Q */
-void _GMP_lucas_seq(mpz_t U, mpz_t V, mpz_t n, IV P, IV Q, mpz_t k,
-                    mpz_t Qk, mpz_t t)
+/*****************************************************************************/
+/* Lucas sequences mod n with a context for a fixed (P, Q, n).
+ *
+ * Constants that depend only on (P,Q,n) are set up once, and the ladder
+ * states are kept so a batch of k values sorted by their bit strings can
+ * share the common top of the ladder.  With |Q| = 1 we never square Q^k.
+ */
+
+#define LUCAS_CTX_VLADDER  0    /* Q = 1, P^2-4 invertible: V_k,V_k+1 chain */
+#define LUCAS_CTX_GENERAL  1    /* odd n: U_k,V_k,Q^k chain */
+#define LUCAS_CTX_EVEN     2    /* even n: division-free chain */
+
+#define MPZ_SUB_SI(r, a, s) \
+  do { if ((s) >= 0) mpz_sub_ui(r, a, (s)); else mpz_add_ui(r, a, -(s)); } while (0)
+
+void lucas_ctx_init(lucas_ctx_t* ctx, mpz_t n, IV P, IV Q)
 {
-  UV b = mpz_sizeinbase(k, 2);
   IV D = P*P - 4*Q;
 
   if (mpz_cmp_ui(n, 2) < 0) croak("Lucas sequence modulus n must be > 1");
-  MPUassert( mpz_cmp_ui(k, 0) >= 0, "lucas_seq: k is negative" );
   MPUassert( mpz_cmp_si(n,(P>=0) ? P : -P) > 0, "lucas_seq: P is out of range");
   MPUassert( mpz_cmp_si(n,(Q>=0) ? Q : -Q) > 0, "lucas_seq: Q is out of range");
   MPUassert( D != 0, "lucas_seq: D is zero" );
 
-  if (mpz_cmp_ui(k, 0) <= 0) {
-    mpz_set_ui(U, 0);
-    mpz_set_ui(V, 2);
+  ctx->mark = scratch_mark();
+  ctx->n = scratch_mpz(mpz_sizeinbase(n, 2));
+  ctx->inv = scratch_mpz(mpz_sizeinbase(n, 2));
+  ctx->t = scratch_mpz(2*mpz_sizeinbase(n, 2) + BITS_PER_WORD);
+  mpz_set(ctx->n, n);
+  ctx->P = P;  ctx->Q = Q;  ctx->D = D;
+  ctx->nstates = 0;
+  ctx->stU = ctx->stV = ctx->stQ = 0;
+
+  mpz_set_si(ctx->inv, D);
+  if (Q == 1 && mpz_invert(ctx->inv, ctx->inv, n))
+    ctx->method = LUCAS_CTX_VLADDER;
+  else
+    ctx->method = mpz_odd_p(n) ? LUCAS_CTX_GENERAL : LUCAS_CTX_EVEN;
+}
+
+void lucas_ctx_destroy(lucas_ctx_t* ctx)
+{
+  UV i;
+  for (i = 0; i < ctx->nstates; i++) {
+    mpz_clear(ctx->stU[i]);  mpz_clear(ctx->stV[i]);  mpz_clear(ctx->stQ[i]);
+  }
+  if (ctx->nstates > 0) {
+    Safefree(ctx->stU);  Safefree(ctx->stV);  Safefree(ctx->stQ);
+  }
+  scratch_release(ctx->mark);
+}
+
+static void _lucas_ctx_states(lucas_ctx_t* ctx, UV nstates)
+{
+  UV i;
+  if (nstates <= ctx->nstates) return;
+  if (ctx->nstates == 0) {
+    New(0, ctx->stU, nstates, mpz_t);
+    New(0, ctx->stV, nstates, mpz_t);
+    New(0, ctx->stQ, nstates, mpz_t);
+  } else {
+    Renew(ctx->stU, nstates, mpz_t);
+    Renew(ctx->stV, nstates, mpz_t);
+    Renew(ctx->stQ, nstates, mpz_t);
+  }
+  for (i = ctx->nstates; i < nstates; i++) {
+    mpz_init(ctx->stU[i]);  mpz_init(ctx->stV[i]);  mpz_init(ctx->stQ[i]);
+  }
+  ctx->nstates = nstates;
+}
+
+/* State for m = 1 */
+static void _lucas_ctx_start(lucas_ctx_t* ctx, mpz_t U, mpz_t V, mpz_t Qm)
+{
+  IV P = ctx->P;
+  if (ctx->method == LUCAS_CTX_VLADDER) {
+    mpz_set_si(V, P);                  /* V holds V_m, U holds V_{m+1} */
+    mpz_set_si(U, P*P-2);
+    mpz_set_ui(Qm, 1);
+  } else {
+    mpz_set_ui(U, 1);
+    mpz_set_si(V, P);
+    mpz_set_si(Qm, ctx->Q);
+  }
+  mpz_mod(U, U, ctx->n);
+  mpz_mod(V, V, ctx->n);
+  mpz_mod(Qm, Qm, ctx->n);
+}
+
+/* Move from state m (U,V,Qm) to state 2m+bit (dU,dV,dQm).  Not for even n. */
+static void _lucas_ctx_step(lucas_ctx_t* ctx, mpz_t dU, mpz_t dV, mpz_t dQm,
+                            mpz_t U, mpz_t V, mpz_t Qm, int bit)
+{
+  IV P = ctx->P, Q = ctx->Q;
+  mpz_ptr n = ctx->n, t = ctx->t;
+
+  if (ctx->method == LUCAS_CTX_VLADDER) {
+    if (bit) {
+      mpz_mul(dV, V, U);  MPZ_SUB_SI(dV, dV, P);  mpz_mod(dV, dV, n);
+      mpz_mul(dU, U, U);  mpz_sub_ui(dU, dU, 2);  mpz_mod(dU, dU, n);
+    } else {
+      mpz_mul(dU, V, U);  MPZ_SUB_SI(dU, dU, P);  mpz_mod(dU, dU, n);
+      mpz_mul(dV, V, V);  mpz_sub_ui(dV, dV, 2);  mpz_mod(dV, dV, n);
+    }
+    mpz_set_ui(dQm, 1);                /* Q = 1 */
     return;
   }
-  mpz_set_ui(U, 1);
-  mpz_set_si(V, P);
-  mpz_set_si(Qk, Q);
-
-  if (Q == 1) {
-    /* Use the fast V method if possible.  Much faster with small n. */
-    mpz_set_si(t, P*P-4);
-    if (P > 2 && mpz_invert(t, t, n)) {
-      /* Compute V_k and V_{k+1}, then computer U_k from them. */
-      mpz_set_si(V, P);
-      mpz_set_si(U, P*P-2);
-      while (b > 1) {
-        b--;
-        if (mpz_tstbit(k, b-1)) {
-          mpz_mul(V, V, U);  mpz_sub_ui(V, V, P);  mpz_mod(V, V, n);
-          mpz_mul(U, U, U);  mpz_sub_ui(U, U, 2);  mpz_mod(U, U, n);
-        } else {
-          mpz_mul(U, V, U);  mpz_sub_ui(U, U, P);  mpz_mod(U, U, n);
-          mpz_mul(V, V, V);  mpz_sub_ui(V, V, 2);  mpz_mod(V, V, n);
-        }
-      }
-      mpz_mul_ui(U, U, 2);
-      mpz_submul_ui(U, V, P);
-      mpz_mul(U, U, t);
+  mpz_mul(dU, U, V);  mpz_mod(dU, dU, n);          /* U2m = Um * Vm */
+  mpz_mul(dV, V, V);  mpz_submul_ui(dV, Qm, 2);
+  mpz_mod(dV, dV, n);                              /* V2m = Vm^2 - 2 Q^m */
+  if (Q == 1 || Q == -1)  mpz_set_ui(dQm, 1);
+  else                    mpz_mul(dQm, Qm, Qm);
+  if (bit) {
+    mpz_mul_si(t, dU, ctx->D);
+                                    /* U:  U2m+1 = (P*U2m + V2m)/2 */
+    mpz_mul_si(dU, dU, P);
+    mpz_add(dU, dU, dV);
+    if (mpz_odd_p(dU)) mpz_add(dU, dU, n);
+    mpz_fdiv_q_2exp(dU, dU, 1);
+                                    /* V:  V2m+1 = (D*U2m + P*V2m)/2 */
+    mpz_mul_si(dV, dV, P);
+    mpz_add(dV, dV, t);
+    if (mpz_odd_p(dV)) mpz_add(dV, dV, n);
+    mpz_fdiv_q_2exp(dV, dV, 1);
+
+    if      (Q == -1)  mpz_sub(dQm, n, dQm);
+    else if (Q != 1)   mpz_mul_si(dQm, dQm, Q);
+  }
+  if (Q != 1 && Q != -1)  mpz_mod(dQm, dQm, n);
+}
+
+/* Turn the final ladder state into U_k and V_k */
+static void _lucas_ctx_finish(lucas_ctx_t* ctx, mpz_t U, mpz_t V, mpz_t sU, mpz_t sV)
+{
+  if (ctx->method == LUCAS_CTX_VLADDER) {
+    if (U) {                          /* U_k = (2V_{k+1} - P V_k) / D */
+      mpz_mul_ui(ctx->t, sU, 2);
+      if (ctx->P >= 0) mpz_submul_ui(ctx->t, sV, ctx->P);
+      else             mpz_addmul_ui(ctx->t, sV, -ctx->P);
+      mpz_mul(ctx->t, ctx->t, ctx->inv);
+      mpz_mod(U, ctx->t, ctx->n);
+    }
+    if (V) mpz_set(V, sV);
+  } else {                          /* The chain leaves these unreduced */
+    if (U) mpz_mod(U, sU, ctx->n);
+    if (V) mpz_mod(V, sV, ctx->n);
+  }
+}
+
+/* Even n, so no halving.  The chain from lucasuv, reduced mod n. */
+static void _lucas_ctx_even(lucas_ctx_t* ctx, mpz_t U, mpz_t V, mpz_t Qk, mpz_t k)
+{
+  mpz_t Uh, Vl, Vh, Ql, Qh;
+  mpz_ptr n = ctx->n, t = ctx->t;
+  IV P = ctx->P, Q = ctx->Q;
+  int j, s = mpz_scan1(k, 0), nb = mpz_sizeinbase(k, 2);
+
+  mpz_init_set_ui(Uh, 1);  mpz_init_set_ui(Vl, 2);  mpz_init_set_si(Vh, P);
+  mpz_init_set_ui(Ql, 1);  mpz_init_set_ui(Qh, 1);
+  for (j = nb-1; j > s; j--) {
+    mpz_mul(Ql, Ql, Qh);  mpz_mod(Ql, Ql, n);
+    if (mpz_tstbit(k, j)) {
+      mpz_mul_si(Qh, Ql, Q);
+      mpz_mul(Uh, Uh, Vh);  mpz_mod(Uh, Uh, n);
+      mpz_mul_si(t, Ql, P);  mpz_mul(Vl, Vl, Vh);  mpz_sub(Vl, Vl, t);
+      mpz_mod(Vl, Vl, n);
+      mpz_mul(Vh, Vh, Vh);  mpz_submul_ui(Vh, Qh, 2);  mpz_mod(Vh, Vh, n);
     } else {
-      /* Fast computation of U_k and V_k, specific to Q = 1 */
-      while (b > 1) {
-        mpz_mulmod(U, U, V, n, t);     /* U2k = Uk * Vk */
-        mpz_mul(V, V, V);
-        mpz_sub_ui(V, V, 2);
-        mpz_mod(V, V, n);               /* V2k = Vk^2 - 2 Q^k */
-        b--;
-        if (mpz_tstbit(k, b-1)) {
-          mpz_mul_si(t, U, D);
-                                      /* U:  U2k+1 = (P*U2k + V2k)/2 */
-          mpz_mul_si(U, U, P);
-          mpz_add(U, U, V);
-          if (mpz_odd_p(U)) mpz_add(U, U, n);
-          mpz_fdiv_q_2exp(U, U, 1);
-                                      /* V:  V2k+1 = (D*U2k + P*V2k)/2 */
-          mpz_mul_si(V, V, P);
-          mpz_add(V, V, t);
-          if (mpz_odd_p(V)) mpz_add(V, V, n);
-          mpz_fdiv_q_2exp(V, V, 1);
-        }
-      }
+      mpz_set(Qh, Ql);
+      mpz_mul(Uh, Uh, Vl);  mpz_sub(Uh, Uh, Ql);  mpz_mod(Uh, Uh, n);
+      mpz_mul_si(t, Ql, P);  mpz_mul(Vh, Vh, Vl);  mpz_sub(Vh, Vh, t);
+      mpz_mod(Vh, Vh, n);
+      mpz_mul(Vl, Vl, Vl);  mpz_submul_ui(Vl, Ql, 2);  mpz_mod(Vl, Vl, n);
     }
-  } else {
-    while (b > 1) {
-      mpz_mulmod(U, U, V, n, t);     /* U2k = Uk * Vk */
-      mpz_mul(V, V, V);
-      mpz_submul_ui(V, Qk, 2);
-      mpz_mod(V, V, n);               /* V2k = Vk^2 - 2 Q^k */
-      mpz_mul(Qk, Qk, Qk);            /* Q2k = Qk^2 */
-      b--;
-      if (mpz_tstbit(k, b-1)) {
-        mpz_mul_si(t, U, D);
-                                    /* U:  U2k+1 = (P*U2k + V2k)/2 */
-        mpz_mul_si(U, U, P);
-        mpz_add(U, U, V);
-        if (mpz_odd_p(U)) mpz_add(U, U, n);
-        mpz_fdiv_q_2exp(U, U, 1);
-                                    /* V:  V2k+1 = (D*U2k + P*V2k)/2 */
-        mpz_mul_si(V, V, P);
-        mpz_add(V, V, t);
-        if (mpz_odd_p(V)) mpz_add(V, V, n);
-        mpz_fdiv_q_2exp(V, V, 1);
-
-        mpz_mul_si(Qk, Qk, Q);
-      }
-      mpz_mod(Qk, Qk, n);
+  }
+  mpz_mul(Ql, Ql, Qh);  mpz_mod(Ql, Ql, n);
+  mpz_mul_si(Qh, Ql, Q);
+  mpz_mul(Uh, Uh, Vl);  mpz_sub(Uh, Uh, Ql);  mpz_mod(Uh, Uh, n);
+  mpz_mul_si(t, Ql, P);  mpz_mul(Vl, Vl, Vh);  mpz_sub(Vl, Vl, t);
+  mpz_mod(Vl, Vl, n);
+  mpz_mul(Ql, Ql, Qh);  mpz_mod(Ql, Ql, n);
+  for (j = 0; j < s; j++) {
+    mpz_mul(Uh, Uh, Vl);  mpz_mod(Uh, Uh, n);
+    mpz_mul(Vl, Vl, Vl);  mpz_submul_ui(Vl, Ql, 2);  mpz_mod(Vl, Vl, n);
+    mpz_mul(Ql, Ql, Ql);  mpz_mod(Ql, Ql, n);
+  }
+  if (U)  mpz_set(U, Uh);
+  if (V)  mpz_set(V, Vl);
+  if (Qk) mpz_set(Qk, Ql);
+  mpz_clear(Uh);  mpz_clear(Vl);  mpz_clear(Vh);  mpz_clear(Ql);  mpz_clear(Qh);
+}
+
+void lucas_ctx_seq(lucas_ctx_t* ctx, mpz_t U, mpz_t V, mpz_t Qk, mpz_t k)
+{
+  UV b;
+  int cur = 0;
+
+  MPUassert( mpz_sgn(k) >= 0, "lucas_seq: k is negative" );
+  if (mpz_sgn(k) == 0) {
+    if (U)  mpz_set_ui(U, 0);
+    if (V)  mpz_set_ui(V, 2);
+    if (V)  mpz_mod(V, V, ctx->n);
+    if (Qk) mpz_set_ui(Qk, 1);
+    return;
+  }
+  if (ctx->method == LUCAS_CTX_EVEN) {
+    _lucas_ctx_even(ctx, U, V, Qk, k);
+    return;
+  }
+  {
+    UV mark = scratch_mark(), bits = 2*mpz_sizeinbase(ctx->n, 2) + BITS_PER_WORD;
+    mpz_ptr sU[2], sV[2], sQ[2];
+    for (b = 0; b < 2; b++) {
+      sU[b] = scratch_mpz(bits);  sV[b] = scratch_mpz(bits);  sQ[b] = scratch_mpz(bits);
     }
+    _lucas_ctx_start(ctx, sU[0], sV[0], sQ[0]);
+    for (b = mpz_sizeinbase(k, 2); b > 1; b--) {
+      _lucas_ctx_step(ctx, sU[1-cur], sV[1-cur], sQ[1-cur],
+                      sU[cur], sV[cur], sQ[cur], mpz_tstbit(k, b-2));
+      cur = 1-cur;
+    }
+    _lucas_ctx_finish(ctx, U, V, sU[cur], sV[cur]);
+    if (Qk) mpz_set(Qk, sQ[cur]);
+    scratch_release(mark);
   }
-  mpz_mod(U, U, n);
-  mpz_mod(V, V, n);
+}
+
+typedef struct {
+  mpz_t key;     /* k shifted left so all keys have the same length */
+  UV    bits;
+  UV    idx;
+} lucas_kentry_t;
+
+static int _lucas_kentry_cmp(const void* a, const void* b)
+{
+  const lucas_kentry_t *ka = (const lucas_kentry_t*)a,
+                       *kb = (const lucas_kentry_t*)b;
+  int c = mpz_cmp(ka->key, kb->key);
+  if (c != 0) return c;
+  return (ka->bits < kb->bits) ? -1 : (ka->bits > kb->bits);
+}
+
+void lucas_ctx_seq_multi(lucas_ctx_t* ctx, mpz_t* U, mpz_t* V, mpz_t* k, UV nk)
+{
+  lucas_kentry_t *e;
+  mpz_t x;
+  UV i, j, maxbits = 1, prevbits = 0;
+
+  if (ctx->method == LUCAS_CTX_EVEN) {
+    for (i = 0; i < nk; i++)
+      lucas_ctx_seq(ctx, U ? U[i] : 0, V ? V[i] : 0, 0, k[i]);
+    return;
+  }
+
+  /* Sort the k values by bit string from the top, so neighbors share the
+   * longest possible prefix of the ladder. */
+  for (i = 0; i < nk; i++) {
+    MPUassert( mpz_sgn(k[i]) >= 0, "lucas_seq: k is negative" );
+    if (mpz_sizeinbase(k[i], 2) > maxbits)
+      maxbits = mpz_sizeinbase(k[i], 2);
+  }
+  New(0, e, nk, lucas_kentry_t);
+  for (i = 0; i < nk; i++) {
+    e[i].bits = mpz_sgn(k[i]) ? mpz_sizeinbase(k[i], 2) : 0;
+    e[i].idx = i;
+    mpz_init(e[i].key);
+    mpz_mul_2exp(e[i].key, k[i], maxbits - e[i].bits);
+  }
+  qsort(e, nk, sizeof(lucas_kentry_t), _lucas_kentry_cmp);
+  _lucas_ctx_states(ctx, maxbits);
+
+  mpz_init(x);
+  for (i = 0; i < nk; i++) {
+    UV bits = e[i].bits, common = 0;
+    mpz_ptr kv = k[e[i].idx];
+    if (bits == 0) {
+      if (U) mpz_set_ui(U[e[i].idx], 0);
+      if (V) mpz_set_ui(V[e[i].idx], 2);
+      if (V) mpz_mod(V[e[i].idx], V[e[i].idx], ctx->n);
+      continue;
+    }
+    /* Number of leading ladder states shared with the previous k */
+    if (prevbits > 0) {
+      mpz_xor(x, e[i].key, e[i-1].key);
+      common = (mpz_sgn(x) == 0) ? maxbits : maxbits - mpz_sizeinbase(x, 2);
+      if (common > bits)     common = bits;
+      if (common > prevbits) common = prevbits;
+    }
+    if (common == 0) {
+      _lucas_ctx_start(ctx, ctx->stU[0], ctx->stV[0], ctx->stQ[0]);
+      common = 1;
+    }
+    for (j = common; j < bits; j++)
+      _lucas_ctx_step(ctx, ctx->stU[j], ctx->stV[j], ctx->stQ[j],
+                      ctx->stU[j-1], ctx->stV[j-1], ctx->stQ[j-1],
+                      mpz_tstbit(kv, bits-1-j));
+    _lucas_ctx_finish(ctx, U ? U[e[i].idx] : 0, V ? V[e[i].idx] : 0,
+                      ctx->stU[bits-1], ctx->stV[bits-1]);
+    prevbits = bits;
+  }
+  mpz_clear(x);
+  for (i = 0; i < nk; i++)
+    mpz_clear(e[i].key);
+  Safefree(e);
+}
+
+/* Returns Lucas sequence  U_k mod n and V_k mod n  defined by P,Q */
+void _GMP_lucas_seq(mpz_t U, mpz_t V, mpz_t n, IV P, IV Q, mpz_t k,
+                    mpz_t Qk, mpz_t t)
+{
+  lucas_ctx_t ctx;
+  (void) t;
+  lucas_ctx_init(&ctx, n, P, Q);
+  lucas_ctx_seq(&ctx, U, V, Qk, k);
+  lucas_ctx_destroy(&ctx);
 }
 
 void lucasuv(mpz_t Uh, mpz_t Vl, IV P, IV Q, mpz_t k)
@@ -509,9 +786,9 @@ static int lucas_extrastrong_params(IV* P, IV* Q, mpz_t n, mpz_t t, UV inc)
  */
 int _GMP_is_lucas_pseudoprime(mpz_t n, int strength)
 {
-  mpz_t d, U, V, Qk, t;
+  mpz_ptr d, U, V, Qk, t;
   IV P, Q;
-  UV s = 0;
+  UV s = 0, mark, bits;
   int rval;
   int _verbose = get_verbose_level();
 
@@ -522,18 +799,20 @@ int _GMP_is_lucas_pseudoprime(mpz_t n, int strength)
     if (mpz_even_p(n)) return 0;  /* multiple of 2 is composite */
   }
 
-  mpz_init(t);
+  mark = scratch_mark();
+  bits = 2*mpz_sizeinbase(n, 2) + BITS_PER_WORD;
+  t = scratch_mpz(bits);
   rval = (strength < 2) ? lucas_selfridge_params(&P, &Q, n, t)
                         : lucas_extrastrong_params(&P, &Q, n, t, 1);
   if (!rval) {
-    mpz_clear(t);
+    scratch_release(mark);
     return 0;
   }
   if (_verbose>3) gmp_printf("N: %Zd  D: %ld  P: %lu  Q: %ld\n", n, P*P-4*Q, P, Q);
 
-  mpz_init(U);  mpz_init(V);  mpz_init(Qk);
-  mpz_init_set(d, n);
-  mpz_add_ui(d, d, 1);
+  U = scratch_mpz(bits);  V = scratch_mpz(bits);  Qk = scratch_mpz(bits);
+  d = scratch_mpz(bits);
+  mpz_add_ui(d, n, 1);
 
   if (strength > 0) {
     s = mpz_scan1(d, 0);
@@ -541,7 +820,6 @@ int _GMP_is_lucas_pseudoprime(mpz_t n, int strength)
   }
 
   _GMP_lucas_seq(U, V, n, P, Q, d, Qk, t);
-  mpz_clear(d);
 
   rval = 0;
   if (strength == 0) {
@@ -583,7 +861,7 @@ int _GMP_is_lucas_pseudoprime(mpz_t n, int strength)
       }
     }
   }
-  mpz_clear(Qk); mpz_clear(V); mpz_clear(U); mpz_clear(t);
+  scratch_release(mark);
   return rval;
 }
 
@@ -598,8 +876,8 @@ int _GMP_is_lucas_pseudoprime(mpz_t n, int strength)
  */
 int _GMP_is_almost_extra_strong_lucas_pseudoprime(mpz_t n, UV increment)
 {
-  mpz_t d, V, W, t;
-  UV P, s;
+  mpz_ptr d, V, W, t;
+  UV P, s, mark, bits;
   int rval;
 
   {
@@ -609,17 +887,21 @@ int _GMP_is_almost_extra_strong_lucas_pseudoprime(mpz_t n, UV increment)
     if (mpz_even_p(n)) return 0;  /* multiple of 2 is composite */
   }
 
-  mpz_init(t);
+  mark = scratch_mark();
+  bits = 2*mpz_sizeinbase(n, 2) + BITS_PER_WORD;
+  t = scratch_mpz(bits);
   {
     IV PP;
     if (! lucas_extrastrong_params(&PP, 0, n, t, increment) ) {
-      mpz_clear(t);
+      scratch_release(mark);
       return 0;
     }
     P = (UV) PP;
   }
 
-  mpz_init(d);
+  d = scratch_mpz(bits);
+  V = scratch_mpz(bits);
+  W = scratch_mpz(bits);
   mpz_add_ui(d, n, 1);
 
   s = mpz_scan1(d, 0);
@@ -628,8 +910,8 @@ int _GMP_is_almost_extra_strong_lucas_pseudoprime(mpz_t n, UV increment)
   /* Calculate V_d */
   {
     UV b = mpz_sizeinbase(d, 2);
-    mpz_init_set_ui(V, P);
-    mpz_init_set_ui(W, P*P-2);   /* V = V_{k}, W = V_{k+1} */
+    mpz_set_ui(V, P);
+    mpz_set_ui(W, P*P-2);        /* V = V_{k}, W = V_{k+1} */
 
     while (b > 1) {
       b--;
@@ -649,9 +931,7 @@ int _GMP_is_almost_extra_strong_lucas_pseudoprime(mpz_t n, UV increment)
       mpz_mod(V, V, n);
       mpz_mod(W, W, n);
     }
-    mpz_clear(W);
   }
-  mpz_clear(d);
 
   rval = 0;
   mpz_sub_ui(t, n, 2);
@@ -671,57 +951,56 @@ int _GMP_is_almost_extra_strong_lucas_pseudoprime(mpz_t n, UV increment)
       }
     }
   }
-  mpz_clear(V); mpz_clear(t);
+  scratch_release(mark);
   return rval;
 }
 
-static void mat_mulmod_3x3(mpz_t* a, mpz_t* b, mpz_t n, mpz_t* t, mpz_t t2) {
-  int i, row, col;
-  for (row = 0; row < 3; row++) {
-    for (col = 0; col < 3; col++) {
-      mpz_mul(t[3*row+col], a[3*row+0], b[0+col]);
-      mpz_mul(t2, a[3*row+1], b[3+col]);
-      mpz_add(t[3*row+col], t[3*row+col], t2);
-      mpz_mul(t2, a[3*row+2], b[6+col]);
-      mpz_add(t[3*row+col], t[3*row+col], t2);
-    }
-  }
-  for (i = 0; i < 9; i++) mpz_mod(a[i], t[i], n);
-}
-static void mat_powmod_3x3(mpz_t* m, mpz_t kin, mpz_t n) {
-  mpz_t k, t2, t[9], res[9];
-  int i;
-  mpz_init_set(k, kin);
-  mpz_init(t2);
-  for (i = 0; i < 9; i++) { mpz_init(t[i]); mpz_init(res[i]); }
-  mpz_set_ui(res[0],1);  mpz_set_ui(res[4],1);  mpz_set_ui(res[8],1);
-  while (mpz_sgn(k)) {
-    if (mpz_odd_p(k))  mat_mulmod_3x3(res, m, n, t, t2);
-    mpz_fdiv_q_2exp(k, k, 1);
-    if (mpz_sgn(k))    mat_mulmod_3x3(m, m, n, t, t2);
-  }
-  for (i = 0; i < 9; i++)
-    { mpz_set(m[i],res[i]);  mpz_clear(res[i]);  mpz_clear(t[i]); }
-  mpz_clear(t2);
-  mpz_clear(k);
-}
+/* Perrin test.  A(n) is the trace of x^n in Z[x]/(x^3-x-1), and the trace
+ * of c0 + c1*x + c2*x^2 is 3c0 + 2c2.  Squaring in that ring is 3 squares,
+ * 3 multiplies, and 3 reductions.  Multiplying by x is free.  The 3x3
+ * matrix power took 27 multiplies and 9 reductions for each square, and
+ * the same again for each set bit.
+ */
 int is_perrin_pseudoprime(mpz_t n)
 {
-  int P[9] = {0,1,0, 0,0,1, 1,1,0};
-  mpz_t m[9];
-  int i, rval;
+  mpz_t c0, c1, c2, s0, s1, s2, t;
+  UV bit;
+  int rval;
   {
     int cmpr = mpz_cmp_ui(n, 2);
     if (cmpr == 0)     return 1;  /* 2 is prime */
     if (cmpr < 0)      return 0;  /* below 2 is composite */
   }
-  for (i = 0; i < 9; i++) mpz_init_set_ui(m[i], P[i]);
-  mat_powmod_3x3(m, n, n);
-  mpz_add(m[1], m[0], m[4]);
-  mpz_add(m[2], m[1], m[8]);
-  mpz_mod(m[0], m[2], n);
-  rval = mpz_sgn(m[0]) ? 0 : 1;
-  for (i = 0; i < 9; i++) mpz_clear(m[i]);
+  mpz_init_set_ui(c0, 0);  mpz_init_set_ui(c1, 1);  mpz_init_set_ui(c2, 0);
+  mpz_init(s0);  mpz_init(s1);  mpz_init(s2);  mpz_init(t);
+
+  for (bit = mpz_sizeinbase(n, 2)-1; bit-- > 0; ) {
+    /* x^3 = x+1, x^4 = x^2+x:
+     *   c0' = c0^2 + 2c1c2
+     *   c1' = 2c0c1 + 2c1c2 + c2^2
+     *   c2' = c1^2 + 2c0c2 + c2^2          */
+    mpz_mul(s2, c2, c2);
+    mpz_mul(t, c1, c2);   mpz_mul_2exp(t, t, 1);
+    mpz_mul(s0, c0, c0);  mpz_add(s0, s0, t);
+    mpz_add(t, t, s2);
+    mpz_mul(s1, c0, c1);  mpz_mul_2exp(s1, s1, 1);  mpz_add(s1, s1, t);
+    mpz_mul(c0, c0, c2);  mpz_mul_2exp(c0, c0, 1);  mpz_add(s2, s2, c0);
+    mpz_mul(t, c1, c1);   mpz_add(s2, s2, t);
+    mpz_mod(c0, s0, n);
+    mpz_mod(c1, s1, n);
+    mpz_mod(c2, s2, n);
+    if (mpz_tstbit(n, bit)) {
+      /* x * (c0 + c1x + c2x^2) = c2 + (c0+c2)x + c1x^2 */
+      mpz_add(t, c0, c2);
+      mpz_swap(c0, c2);  mpz_swap(c2, c1);  mpz_swap(c1, t);
+      if (mpz_cmp(c1, n) >= 0) mpz_sub(c1, c1, n);
+    }
+  }
+  mpz_mul_ui(t, c0, 3);                 /* A(n) = 3c0 + 2c2 */
+  mpz_addmul_ui(t, c2, 2);
+  rval = mpz_divisible_p(t, n);
+  mpz_clear(c0); mpz_clear(c1); mpz_clear(c2);
+  mpz_clear(s0); mpz_clear(s1); mpz_clear(s2); mpz_clear(t);
   return rval;
 }
 
@@ -1059,17 +1338,17 @@ static int primality_pretest(mpz_t n)
 
   {
     UV log2n = mpz_sizeinbase(n,2);
-    mpz_t t;
-    mpz_init(t);
+    UV mark = scratch_mark();
+    mpz_ptr t = scratch_mpz(log2n);
 
     /* Do a GCD with all primes < 1009 */
     mpz_gcd(t, n, _bgcd);
     if (mpz_cmp_ui(t, 1))
-      { mpz_clear(t); return 0; }
+      { scratch_release(mark); return 0; }
 
     /* No divisors under 1009 */
     if (mpz_cmp_ui(n, BGCD_NEXTPRIME*BGCD_NEXTPRIME) < 0)
-      { mpz_clear(t); return 2; }
+      { scratch_release(mark); return 2; }
 
     /* If we're reasonably large, do a gcd with more primes */
     if (log2n > 700) {
@@ -1079,7 +1358,7 @@ static int primality_pretest(mpz_t n)
       }
       mpz_gcd(t, n, _bgcd3);
       if (mpz_cmp_ui(t, 1))
-        { mpz_clear(t); return 0; }
+        { scratch_release(mark); return 0; }
     } else if (log2n > 300) {
       if (mpz_sgn(_bgcd2) == 0) {
         _GMP_pn_primorial(_bgcd2, BGCD2_PRIMES);
@@ -1087,9 +1366,9 @@ static int primality_pretest(mpz_t n)
       }
       mpz_gcd(t, n, _bgcd2);
       if (mpz_cmp_ui(t, 1))
-        { mpz_clear(t); return 0; }
+        { scratch_release(mark); return 0; }
     }
-    mpz_clear(t);
+    scratch_release(mark);
     /* Do more trial division if we think we should.
      * According to Menezes (section 4.45) as well as Park (ISPEC 2005),
      * we want to select a trial limit B such that B = E/D where E is the
@@ -1133,6 +1412,25 @@ int _GMP_BPSW(mpz_t n)
   return 1;
 }
 
+/* Below psi_13 (about 2^81.5) Miller-Rabin with the 13 prime bases 2 to 41
+ * is a proof.  Returns 2 or 0 there, and 1 for larger n. */
+static int _GMP_mr_deterministic(mpz_t n)
+{
+  static const unsigned char bases[13] = {2,3,5,7,11,13,17,19,23,29,31,37,41};
+  mr_ctx_t ctx;
+  int i;
+
+  if (mpz_cmp(n, _psi13) >= 0)  return 1;
+  if (mpz_cmp_ui(n, 41) <= 0)   return _GMP_is_prob_prime(n);
+  if (mpz_even_p(n))            return 0;
+  mr_ctx_init(&ctx, n);
+  for (i = 0; i < 13; i++)
+    if (!mr_ctx_test_ui(&ctx, bases[i]))
+      break;
+  mr_ctx_destroy(&ctx);
+  return (i == 13) ? 2 : 0;
+}
+
 
 int _GMP_is_prob_prime(mpz_t n)
 {
@@ -1168,6 +1466,10 @@ int _GMP_is_prime(mpz_t n)
   /* n has passed the ES BPSW test, making it quite unlikely it is a
    * composite (and it cannot be if n < 2^64). */
 
+  /* Up to about 82 bits a fixed set of M-R bases proves it. */
+  if (prob_prime == 1 && nbits <= 82)
+    prob_prime = _GMP_mr_deterministic(n);
+
   /* For small numbers, try a quick BLS75 n-1 proof. */
   if (prob_prime == 1) {
     if (is_proth_form(n))
@@ -1221,6 +1523,145 @@ int _GMP_is_prime(mpz_t n)
   return prob_prime;
 }
 
+/* Racing provers.  Whether BLS75 n-1, n+1, or ECPP finishes first depends
+ * on how easily n-1 or n+1 factors, which can't be predicted, so when more
+ * than one worker is allowed they run at once and the first answer wins.  The
+ * provers use croak, the random state, and stats, so unlike run_parallel
+ * jobs they can't share an address space.  Each runs in a forked child and
+ * sends back its result and certificate through a pipe, and leaves only
+ * through _exit.  The children see the same time budget, and their stats
+ * are not collected. */
+#define PROVE_RACE_BITS  300   /* smaller n are proven too fast to bother */
+#define PROVE_RACE_POLL  100   /* ms between budget checks while waiting */
+
+#ifdef USE_PROVE_RACE
+static int _race_bls_nm1(mpz_t n, char** prooftext)
+  { return _GMP_primality_bls_nm1(n, 100, prooftext); }
+static int _race_bls_np1(mpz_t n, char** prooftext)
+  { return _GMP_primality_bls_np1(n, 100, prooftext); }
+static int _race_ecpp(mpz_t n, char** prooftext)
+  { return _GMP_ecpp(n, prooftext); }
+
+/* cert is 0 for provers whose certificates verify_prime doesn't know */
+static const struct {
+  int (*prove)(mpz_t n, char** prooftext);
+  int cert;
+} _race_provers[] = {
+  { _race_bls_nm1, 1 },
+  { _race_bls_np1, 0 },
+  { _race_ecpp,    1 },
+};
+#define NRACE_PROVERS  (sizeof(_race_provers)/sizeof(_race_provers[0]))
+
+static int _race_io(int fd, void* buf, size_t len, int rd)
+{
+  char* p = (char*) buf;
+  while (len > 0) {
+    long r = rd ? (long)read(fd, p, len) : (long)write(fd, p, len);
+    if (r < 0 && errno == EINTR)  continue;
+    if (r <= 0)  return 0;
+    p += r;
+    len -= r;
+  }
+  return 1;
+}
+
+/* 0 or 2 from the first prover to decide, 1 if none did, or -1 if no
+ * prover could be started. */
+static int _prove_race(mpz_t n, char** prooftext)
+{
+  pid_t pid[NRACE_PROVERS];
+  struct pollfd pfd[NRACE_PROVERS];
+  int i, nrunning = 0, result = 1;
+
+  fflush(stdout);
+  for (i = 0; i < (int)NRACE_PROVERS; i++) {
+    int fds[2];
+    pid[i] = -1;
+    pfd[i].fd = -1;
+    pfd[i].events = POLLIN;
+    if (prooftext != 0 && !_race_provers[i].cert)  continue;
+    if (pipe(fds) != 0)  continue;
+    pid[i] = fork();
+    if (pid[i] == 0) {                          /* child */
+      char* text = 0;
+      int res;
+      size_t len;
+      close(fds[0]);
+#ifdef STANDALONE
+      res = _race_provers[i].prove(n, prooftext ? &text : 0);
+#else
+      {
+        /* The child has a copy of the caller's interpreter.  A croak must
+         * not unwind into its Perl code (eval, END blocks, destructors),
+         * so catch it here and leave. */
+        dTHX;
+        dJMPENV;
+        int jret;
+        JMPENV_PUSH(jret);
+        if (jret == 0)
+          res = _race_provers[i].prove(n, prooftext ? &text : 0);
+        JMPENV_POP;
+        if (jret != 0)  _exit(1);
+      }
+#endif
+      len = (text == 0) ? 0 : strlen(text);
+      if (_race_io(fds[1], &res, sizeof(res), 0) &&
+          _race_io(fds[1], &len, sizeof(len), 0) && len > 0)
+        (void) _race_io(fds[1], text, len, 0);
+      fflush(stdout);
+      _exit(0);
+    }
+    close(fds[1]);
+    if (pid[i] < 0) {
+      close(fds[0]);
+      continue;
+    }
+    pfd[i].fd = fds[0];
+    nrunning++;
+  }
+  if (nrunning == 0)  return -1;
+
+  while (nrunning > 0 && result == 1) {
+    int r = poll(pfd, NRACE_PROVERS, PROVE_RACE_POLL);
+    if (budget_expired())  break;
+    if (r <= 0)  continue;
+    for (i = 0; i < (int)NRACE_PROVERS && result == 1; i++) {
+      int res;
+      size_t len;
+      if (pfd[i].fd < 0 || pfd[i].revents == 0)  continue;
+      if (_race_io(pfd[i].fd, &res, sizeof(res), 1) &&
+          _race_io(pfd[i].fd, &len, sizeof(len), 1)) {
+        if (res == 0 || (res == 2 && prooftext == 0)) {
+          result = res;
+        } else if (res == 2 && len > 0) {      /* keep the certificate */
+          New(0, *prooftext, len+1, char);
+          if (_race_io(pfd[i].fd, *prooftext, len, 1)) {
+            (*prooftext)[len] = '\0';
+            result = 2;
+          } else {
+            Safefree(*prooftext);
+            *prooftext = 0;
+          }
+        }
+      }
+      close(pfd[i].fd);
+      pfd[i].fd = -1;
+      nrunning--;
+    }
+  }
+
+  /* Stop the rest */
+  for (i = 0; i < (int)NRACE_PROVERS; i++) {
+    if (pfd[i].fd >= 0)  close(pfd[i].fd);
+    if (pid[i] > 0) {
+      kill(pid[i], SIGKILL);
+      waitpid(pid[i], 0, 0);
+    }
+  }
+  return result;
+}
+#endif
 
 int _GMP_is_provable_prime(mpz_t n, char** prooftext)
 {
@@ -1237,6 +1678,12 @@ int _GMP_is_provable_prime(mpz_t n, char** prooftext)
   prob_prime = _GMP_BPSW(n);
   if (prob_prime != 1)  return prob_prime;
 
+  /* The M-R base set proof has no certificate type past 2^64. */
+  if (prooftext == 0 && mpz_sizeinbase(n, 2) <= 82) {
+    prob_prime = _GMP_mr_deterministic(n);
+    if (prob_prime != 1)  return prob_prime;
+  }
+
   /* Run one more M-R test, just in case. */
   prob_prime = _GMP_miller_rabin_random(n, 1, 0);
   if (prob_prime != 1)  return prob_prime;
@@ -1244,6 +1691,7 @@ int _GMP_is_provable_prime(mpz_t n, char** prooftext)
   /* We can choose a primality proving algorithm:
    *   AKS    _GMP_is_aks_prime       really slow, don't bother
    *   N-1    _GMP_primality_bls_nm1  small or special numbers
+ *   N+1    _GMP_primality_bls_np1  small or special numbers, no certificate
    *   ECPP   _GMP_ecpp               fastest in general
    */
 
@@ -1251,6 +1699,20 @@ int _GMP_is_provable_prime(mpz_t n, char** prooftext)
   prob_prime = _GMP_primality_bls_nm1(n, is_proth_form(n) ? 3 : 1, prooftext);
   if (prob_prime != 1)  return prob_prime;
 
+  /* Then n+1, whose certificate type verify_prime doesn't know */
+  if (prooftext == 0) {
+    prob_prime = _GMP_primality_bls_np1(n, 1, 0);
+    if (prob_prime != 1)  return prob_prime;
+  }
+
+#ifdef USE_PROVE_RACE
+  /* With workers to spare, race a hard n-1 attempt against ECPP */
+  if (get_thread_count() > 1 && mpz_sizeinbase(n, 2) >= PROVE_RACE_BITS) {
+    prob_prime = _prove_race(n, prooftext);
+    if (prob_prime >= 0)  return prob_prime;
+  }
+#endif
+
   /* ECPP */
   prob_prime = _GMP_ecpp(n, prooftext);
 
@@ -1343,7 +1805,7 @@ static UV largest_factor(UV n) {
 #endif
 
 
-int _GMP_is_aks_prime(mpz_t n)
+static int _is_aks_prime(mpz_t n)
 {
   mpz_t *px, *py;
   int retval;
@@ -1521,75 +1983,186 @@ int _GMP_is_aks_prime(mpz_t n)
   return retval;
 }
 
+int _GMP_is_aks_prime(mpz_t n)
+{
+  stats_timer_t st;
+  int isprime;
+  stats_begin(&st, STATS_AKS, n, 0, 0, 0);
+  isprime = _is_aks_prime(n);
+  stats_end(&st, 1, 0);
+  return isprime;
+}
+
 /*****************************************************************************/
 
 /* Controls how many numbers to sieve.  Little time impact. */
 #define NPS_MERIT  30.0
 /* Controls how many primes to use.  Big time impact. */
 #define NPS_DEPTH  (log2n > 200000 ? 4200000000UL : log2n * (log2n/10))
+/* Below this size a BPSW test is too quick to be worth a thread. */
+#define NPS_PARALLEL_BITS  2000
+
+/* With threads, the sieve survivors are tested speculatively: the next
+ * 2*threads of them at once, keeping the first in order that passes.  A
+ * test is skipped if it hasn't started when an earlier one has passed.
+ * The lowest passing index is shared between the threads under a lock. */
+typedef struct {
+  UV found;               /* lowest idx seen to pass */
+#ifdef USE_PTHREADS
+  pthread_mutex_t lock;
+#endif
+} nps_found_t;
+
+typedef struct {
+  mpz_ptr base;
+  UV off;                 /* test base + off */
+  UV idx;                 /* position in the batch */
+  nps_found_t* found;
+  int pass;
+} nps_job_t;
+
+static UV _nps_get_found(nps_found_t* F)
+{
+  UV f;
+#ifdef USE_PTHREADS
+  pthread_mutex_lock(&F->lock);
+#endif
+  f = F->found;
+#ifdef USE_PTHREADS
+  pthread_mutex_unlock(&F->lock);
+#endif
+  return f;
+}
+
+static void _nps_set_found(nps_found_t* F, UV idx)
+{
+#ifdef USE_PTHREADS
+  pthread_mutex_lock(&F->lock);
+#endif
+  if (idx < F->found)  F->found = idx;
+#ifdef USE_PTHREADS
+  pthread_mutex_unlock(&F->lock);
+#endif
+}
+
+static void _nps_test_job(void* vjob)
+{
+  nps_job_t* J = (nps_job_t*) vjob;
+  mpz_t t;
+  J->pass = 0;
+  if (_nps_get_found(J->found) < J->idx)  return;
+  mpz_init(t);
+  mpz_add_ui(t, J->base, J->off);
+  J->pass = _GMP_BPSW(t);
+  if (J->pass)  _nps_set_found(J->found, J->idx);
+  mpz_clear(t);
+}
+
+/* The index of the first of base+off[0..noff) passing BPSW, or noff. */
+static UV _nps_first_prime(mpz_t base, const UV* off, UV noff)
+{
+  nps_job_t* jobs;
+  nps_found_t found;
+  UV i, b, nb, batch;
+
+  if (get_thread_count() <= 1 || mpz_sizeinbase(base, 2) < NPS_PARALLEL_BITS) {
+    mpz_t t;
+    mpz_init(t);
+    for (i = 0; i < noff; i++) {
+      mpz_add_ui(t, base, off[i]);
+      if (_GMP_BPSW(t))  break;
+    }
+    mpz_clear(t);
+    return i;
+  }
+  batch = 2 * get_thread_count();
+  New(0, jobs, batch, nps_job_t);
+#ifdef USE_PTHREADS
+  pthread_mutex_init(&found.lock, 0);
+#endif
+  for (b = 0; b < noff; b += batch) {
+    nb = (noff - b < batch) ? noff - b : batch;
+    found.found = UV_MAX;
+    for (i = 0; i < nb; i++) {
+      jobs[i].base = base;
+      jobs[i].off = off[b+i];
+      jobs[i].idx = i;
+      jobs[i].found = &found;
+    }
+    run_parallel(_nps_test_job, jobs, sizeof(nps_job_t), nb);
+    for (i = 0; i < nb; i++)
+      if (jobs[i].pass)
+        break;
+    if (i < nb)
+      break;
+  }
+#ifdef USE_PTHREADS
+  pthread_mutex_destroy(&found.lock);
+#endif
+  Safefree(jobs);
+  return (b < noff) ? b + i : noff;
+}
 
 static void next_prime_with_sieve(mpz_t n) {
   uint32_t* comp;
-  mpz_t t, base;
-  UV i;
+  mpz_t base;
+  UV i, k, noff, *off;
   UV log2n = mpz_sizeinbase(n, 2);
   UV width = (UV) (NPS_MERIT/1.4427 * (double)log2n + 0.5);
   UV depth = NPS_DEPTH;
 
   if (width & 1) width++;                     /* Make width even */
   mpz_add_ui(n, n, mpz_even_p(n) ? 1 : 2);    /* Set n to next odd */
-  mpz_init(t);  mpz_init(base);
+  mpz_init(base);
+  New(0, off, width/2+1, UV);
   while (1) {
     mpz_set(base, n);
     comp = partial_sieve(base, width, depth); /* sieve range to depth */
-    for (i = 1; i <= width; i += 2) {
-      if (!TSTAVAL(comp, i)) {
-        mpz_add_ui(t, base, i);               /* We found a candidate */
-        if (_GMP_BPSW(t)) {
-          mpz_set(n, t);
-          mpz_clear(t);  mpz_clear(base);
-          Safefree(comp);
-          return;
-        }
-      }
+    for (i = 1, noff = 0; i <= width; i += 2)
+      if (!TSTAVAL(comp, i))
+        off[noff++] = i;
+    Safefree(comp);
+    k = _nps_first_prime(base, off, noff);
+    if (k < noff) {                           /* We found a prime */
+      mpz_add_ui(n, base, off[k]);
+      break;
     }
-    Safefree(comp);       /* A huge gap found, so sieve another range */
-    mpz_add_ui(n, n, width);
+    mpz_add_ui(n, n, width);  /* A huge gap found, so sieve another range */
   }
+  Safefree(off);
+  mpz_clear(base);
 }
 
 static void prev_prime_with_sieve(mpz_t n) {
   uint32_t* comp;
-  mpz_t t, base;
-  UV i, j;
+  mpz_t base;
+  UV i, j, k, noff, *off;
   UV log2n = mpz_sizeinbase(n, 2);
   UV width = (UV) (NPS_MERIT/1.4427 * (double)log2n + 0.5);
   UV depth = NPS_DEPTH;
 
   mpz_sub_ui(n, n, mpz_even_p(n) ? 1 : 2);       /* Set n to prev odd */
   width = 64 * ((width+63)/64);                /* Round up to next 64 */
-  mpz_init(t);  mpz_init(base);
+  mpz_init(base);
+  New(0, off, width/2+1, UV);
   while (1) {
     mpz_sub_ui(base, n, width-2);
-    /* gmp_printf("sieve from %Zd to %Zd width %lu\n", base, n, width); */
     comp = partial_sieve(base, width, depth); /* sieve range to depth */
-    /* if (mpz_odd_p(base)) croak("base off after partial");
-       if (width & 1) croak("width is odd after partial"); */
-    for (j = 1; j < width; j += 2) {
+    for (j = 1, noff = 0; j < width; j += 2) {
       i = width - j;
-      if (!TSTAVAL(comp, i)) {
-        mpz_add_ui(t, base, i);               /* We found a candidate */
-        if (_GMP_BPSW(t)) {
-          mpz_set(n, t);
-          mpz_clear(t);  mpz_clear(base);
-          Safefree(comp);
-          return;
-        }
-      }
+      if (!TSTAVAL(comp, i))
+        off[noff++] = i;
+    }
+    Safefree(comp);
+    k = _nps_first_prime(base, off, noff);
+    if (k < noff) {                           /* We found a prime */
+      mpz_add_ui(n, base, off[k]);
+      break;
     }
-    Safefree(comp);       /* A huge gap found, so sieve another range */
-    mpz_sub_ui(n, n, width);
+    mpz_sub_ui(n, n, width);  /* A huge gap found, so sieve another range */
   }
+  Safefree(off);
+  mpz_clear(base);
 }
 
 /* Modifies argument */
@@ -1873,7 +2446,7 @@ void binomial(mpz_t r, UV n, UV k)
 
 
 
-int _GMP_prho_factor(mpz_t n, mpz_t f, UV a, UV rounds)
+static int _prho_factor(mpz_t n, mpz_t f, UV a, UV rounds)
 {
   mpz_t U, V, oldU, oldV, m;
   int i;
@@ -1898,8 +2471,10 @@ int _GMP_prho_factor(mpz_t n, mpz_t f, UV a, UV rounds)
       mpz_tdiv_r(m, m, n);
     }
     mpz_gcd(f, m, n);
-    if (!mpz_cmp_ui(f, 1))
+    if (!mpz_cmp_ui(f, 1)) {
+      if (budget_expired()) break;
       continue;
+    }
     if (!mpz_cmp(f, n)) {
       /* f == n, so we have to back up to see what factor got found */
       mpz_set(U, oldU); mpz_set(V, oldV);
@@ -1922,7 +2497,17 @@ int _GMP_prho_factor(mpz_t n, mpz_t f, UV a, UV rounds)
   return 0;
 }
 
-int _GMP_pbrent_factor(mpz_t n, mpz_t f, UV a, UV rounds)
+int _GMP_prho_factor(mpz_t n, mpz_t f, UV a, UV rounds)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_PRHO, n, a, rounds, 0);
+  success = _prho_factor(n, f, a, rounds);
+  stats_end(&st, success, f);
+  return success;
+}
+
+static int _pbrent_factor(mpz_t n, mpz_t f, UV a, UV rounds)
 {
   mpz_t Xi, Xm, saveXi, m, t;
   UV i, r;
@@ -1954,6 +2539,8 @@ int _GMP_pbrent_factor(mpz_t n, mpz_t f, UV a, UV rounds)
       mpz_gcd(f, m, n);
       if (mpz_cmp_ui(f, 1) != 0)
         break;
+      if (budget_expired())
+        rleft = rounds = 0;
     }
     if (!mpz_cmp_ui(f, 1)) {
       r *= 2;
@@ -1979,6 +2566,16 @@ int _GMP_pbrent_factor(mpz_t n, mpz_t f, UV a, UV rounds)
   return 0;
 }
 
+int _GMP_pbrent_factor(mpz_t n, mpz_t f, UV a, UV rounds)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_PBRENT, n, a, rounds, 0);
+  success = _pbrent_factor(n, f, a, rounds);
+  stats_end(&st, success, f);
+  return success;
+}
+
 
 void _GMP_lcm_of_consecutive_integers(UV B, mpz_t m)
 {
@@ -2022,7 +2619,7 @@ void _GMP_lcm_of_consecutive_integers(UV B, mpz_t m)
 }
 
 
-int _GMP_pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
+static int _pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
 {
   mpz_t a, savea, t;
   UV q, saveq, j, sqrtB1;
@@ -2086,6 +2683,8 @@ int _GMP_pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
         break;
       if (mpz_cmp_ui(f, 1) != 0)
         goto end_success;
+      if (budget_expired())
+        goto end_fail;
       saveq = q;
       mpz_set(savea, a);
     }
@@ -2187,6 +2786,8 @@ int _GMP_pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
         mpz_gcd(f, b, n);
         if ( (mpz_cmp_ui(f, 1) != 0) && (mpz_cmp(f, n) != 0) )
           break;
+        if (budget_expired())
+          break;
       }
     }
     mpz_gcd(f, b, n);
@@ -2218,6 +2819,16 @@ int _GMP_pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
     return 0;
 }
 
+int _GMP_pminus1_factor(mpz_t n, mpz_t f, UV B1, UV B2)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_PMINUS1, n, B1, B2, 0);
+  success = _pminus1_factor(n, f, B1, B2);
+  stats_end(&st, success, f);
+  return success;
+}
+
 static void pp1_pow(mpz_t X, mpz_t Y, unsigned long exp, mpz_t n)
 {
   mpz_t x0;
@@ -2251,7 +2862,7 @@ static void pp1_pow(mpz_t X, mpz_t Y, unsigned long exp, mpz_t n)
   mpz_clear(x0);
 }
 
-int _GMP_pplus1_factor(mpz_t n, mpz_t f, UV P0, UV B1, UV B2)
+static int _pplus1_factor(mpz_t n, mpz_t f, UV P0, UV B1, UV B2)
 {
   UV j, q, saveq, sqrtB1;
   mpz_t X, Y, saveX;
@@ -2308,6 +2919,7 @@ int _GMP_pplus1_factor(mpz_t n, mpz_t f, UV P0, UV B1, UV B2)
       mpz_gcd(f, f, n);
       if (mpz_cmp(f, n) == 0)     break;
       if (mpz_cmp_ui(f, 1) > 0)   goto end_success;
+      if (budget_expired())       goto end_fail;
       saveq = q;
       mpz_set(saveX, X);
     }
@@ -2345,7 +2957,17 @@ int _GMP_pplus1_factor(mpz_t n, mpz_t f, UV P0, UV B1, UV B2)
     return (mpz_cmp_ui(f, 1) != 0) && (mpz_cmp(f, n) != 0);
 }
 
-int _GMP_holf_factor(mpz_t n, mpz_t f, UV rounds)
+int _GMP_pplus1_factor(mpz_t n, mpz_t f, UV P0, UV B1, UV B2)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_PPLUS1, n, B1, B2, P0);
+  success = _pplus1_factor(n, f, P0, B1, B2);
+  stats_end(&st, success, f);
+  return success;
+}
+
+static int _holf_factor(mpz_t n, mpz_t f, UV rounds)
 {
   mpz_t s, m;
   UV i;
@@ -2362,6 +2984,8 @@ int _GMP_holf_factor(mpz_t n, mpz_t f, UV rounds)
   mpz_init(s);
   mpz_init(m);
   for (i = 1; i <= rounds; i++) {
+    if ((i % 4096) == 0 && budget_expired())
+      break;
     mpz_mul_ui(f, n, i);    /* f = n*i */
     if (mpz_perfect_square_p(f)) {
       /* s^2 = n*i, so m = s^2 mod n = 0.  Hence f = GCD(n, s) = GCD(n, n*i) */
@@ -2390,6 +3014,16 @@ int _GMP_holf_factor(mpz_t n, mpz_t f, UV rounds)
   return 0;
 }
 
+int _GMP_holf_factor(mpz_t n, mpz_t f, UV rounds)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_HOLF, n, rounds, 0, 0);
+  success = _holf_factor(n, f, rounds);
+  stats_end(&st, success, f);
+  return success;
+}
+
 
 /*----------------------------------------------------------------------
  * GMP version of Ben Buhrow's public domain 9/24/09 implementation.
@@ -2546,7 +3180,7 @@ static int shanks_mult(mpz_t n, mpz_t f)
    return result;
 }
 
-int _GMP_squfof_factor(mpz_t n, mpz_t f, UV rounds)
+static int _squfof_factor(mpz_t n, mpz_t f, UV rounds)
 {
    const UV multipliers[] = {
       3*5*7*11, 3*5*7, 3*5*11, 3*5, 3*7*11, 3*7, 5*7*11, 5*7,
@@ -2591,6 +3225,16 @@ int _GMP_squfof_factor(mpz_t n, mpz_t f, UV rounds)
    return (mpz_cmp_ui(f, 1) > 0);
 }
 
+int _GMP_squfof_factor(mpz_t n, mpz_t f, UV rounds)
+{
+  stats_timer_t st;
+  int success;
+  stats_begin(&st, STATS_SQUFOF, n, rounds, 0, 0);
+  success = _squfof_factor(n, f, rounds);
+  stats_end(&st, success, f);
+  return success;
+}
+
 /* See if n is a perfect power */
 UV power_factor(mpz_t n, mpz_t f)
 {
@@ -2687,6 +3331,849 @@ uint32_t* partial_sieve(mpz_t start, UV length, UV maxprime)
   return comp;
 }
 
+/*****************************************************************************/
+/*  Prime clusters: the n in [low, high] where mult[i]*n + add[i] is prime
+ *  for every form i.  Offsets n+o are forms (1, o), and Cunningham chains
+ *  of the first kind are (2^i, 2^i-1).
+ *
+ *  A small prime p rules out the residues n mod p where some form is 0 mod
+ *  p, so the sieve marks all of them at once.  The primes up to 13 (as far
+ *  as the range is long enough to use them) make a wheel: only the residues
+ *  mod W they leave are stored, one bit array per residue in j where
+ *  n = base + residue + W*j.  Each remaining prime then marks its roots in
+ *  every array.  Positions that survive every prime get BPSW on each form,
+ *  in parallel if threads are enabled.
+ */
+
+/* Larger than next_prime's depth: each prime removes nforms residues. */
+#define CLUSTER_DEPTH(log2n, nforms) \
+  ((log2n) > 60000 ? 4200000000UL : (nforms) * (log2n) * (log2n) / 8 + 1000)
+/* Bits of residue arrays sieved at once */
+#define CLUSTER_SIEVE_BITS  (1UL << 23)
+
+static const UV _cluster_wheel_primes[6] = {2, 3, 5, 7, 11, 13};
+
+/* The residues of n mod p where some form is 0 mod p (maybe repeated).
+ * Returns the number of them, or UV_MAX if some form is always a multiple
+ * of p. */
+static UV _cluster_roots(UV p, UV nforms, const UV* mult, const IV* add, UV* roots)
+{
+  UV i, nroots = 0;
+  for (i = 0; i < nforms; i++) {
+    UV m = mult[i] % p;
+    UV a = (add[i] >= 0) ? (UV)add[i] % p : (p - (UV)(-add[i]) % p) % p;
+    if (m == 0) {
+      if (a == 0) return UV_MAX;
+      continue;
+    }
+    roots[nroots++] = ((p - a) % p) * modinverse(m, p) % p;
+  }
+  return nroots;
+}
+
+static void _cluster_value(mpz_t v, mpz_t n, UV mult, IV add)
+{
+  mpz_mul_ui(v, n, mult);
+  if (add >= 0)  mpz_add_ui(v, v, add);
+  else           mpz_sub_ui(v, v, -add);
+}
+
+typedef struct {
+  mpz_ptr low;
+  UV *off, noff;          /* test n = low + off[i] */
+  UV nforms;
+  const UV* mult;
+  const IV* add;
+  char* pass;
+} cluster_job_t;
+
+static void _cluster_test_job(void* vjob)
+{
+  cluster_job_t* J = (cluster_job_t*) vjob;
+  mpz_t n, v;
+  UV i, f;
+  mpz_init(n);  mpz_init(v);
+  for (i = 0; i < J->noff; i++) {
+    mpz_add_ui(n, J->low, J->off[i]);
+    for (f = 0; f < J->nforms; f++) {
+      _cluster_value(v, n, J->mult[f], J->add[f]);
+      if (!_GMP_BPSW(v)) break;
+    }
+    J->pass[i] = (f == J->nforms);
+  }
+  mpz_clear(n);  mpz_clear(v);
+}
+
+/* Run BPSW on the candidates low+off[0..noff), keeping those that pass. */
+static UV _cluster_test(mpz_t low, UV* off, UV noff, UV nforms,
+                        const UV* mult, const IV* add)
+{
+  cluster_job_t* jobs;
+  char* pass;
+  UV i, njobs, per, nkeep = 0;
+
+  if (noff == 0) return 0;
+  njobs = 4 * get_thread_count();
+  if (njobs > noff) njobs = noff;
+  per = (noff + njobs - 1) / njobs;
+  njobs = (noff + per - 1) / per;
+  New(0, jobs, njobs, cluster_job_t);
+  New(0, pass, noff, char);
+  for (i = 0; i < njobs; i++) {
+    jobs[i].low = low;
+    jobs[i].off = off + i*per;
+    jobs[i].noff = (i == njobs-1) ? noff - i*per : per;
+    jobs[i].nforms = nforms;
+    jobs[i].mult = mult;
+    jobs[i].add = add;
+    jobs[i].pass = pass + i*per;
+  }
+  run_parallel(_cluster_test_job, jobs, sizeof(cluster_job_t), njobs);
+  for (i = 0; i < noff; i++)
+    if (pass[i])
+      off[nkeep++] = off[i];
+  Safefree(pass);
+  Safefree(jobs);
+  return nkeep;
+}
+
+static void _cluster_push(UV** list, UV* n, UV* alloc, UV v)
+{
+  if (*n >= *alloc) {
+    *alloc = (*alloc < 64) ? 64 : 2 * *alloc;
+    Renew(*list, *alloc, UV);
+  }
+  (*list)[(*n)++] = v;
+}
+
+UV* sieve_cluster(mpz_t low, mpz_t high, UV nforms, const UV* mult,
+                  const IV* add, UV* count)
+{
+  UV *list = 0, nlist = 0, alloc = 0;
+  UV *roots, *resid, *cand, nres, ncand, candalloc;
+  UV i, f, p, depth, range, maxadd = 0, maxmult = 1, small_end, skip, lead;
+  UV W, nwheel, jtotal, jchunk, words, j0;
+  uint32_t* bits;
+  mpz_t t, v, base, cbase;
+
+  *count = 0;
+  if (mpz_cmp(low, high) > 0)  return 0;
+  for (f = 0; f < nforms; f++) {
+    MPUassert(mult[f] > 0, "sieve_cluster: form multiplier must be positive");
+    if (mult[f] > maxmult)  maxmult = mult[f];
+    if ((UV)(add[f] < 0 ? -add[f] : add[f]) > maxadd)
+      maxadd = (add[f] < 0) ? -add[f] : add[f];
+  }
+  mpz_init(t);  mpz_init(v);
+  mpz_sub(t, high, low);
+  if (!mpz_fits_ulong_p(t) || mpz_cmp_ui(t, UV_MAX-1) >= 0)
+    croak("sieve_cluster: range too large");
+  range = mpz_get_ui(t);
+
+  /* No point sieving past sqrt of the largest value */
+  mpz_mul_ui(t, high, maxmult);
+  mpz_add_ui(t, t, maxadd);
+  depth = CLUSTER_DEPTH(mpz_sizeinbase(t, 2), nforms);
+#if BITS_PER_WORD == 32
+  if (depth > 65535)  depth = 65535;           /* residue products fit */
+#endif
+  mpz_sqrt(t, t);
+  if (mpz_cmp_ui(t, depth) < 0)
+    depth = mpz_get_ui(t);
+
+  /* Values up to depth could be the sieving primes themselves, so test
+   * the n where some value may be that small directly. */
+  small_end = depth + maxadd;
+  mpz_init_set(base, low);
+  for (skip = 0; mpz_cmp_ui(base, small_end) <= 0 && mpz_cmp(base, high) <= 0; skip++) {
+    for (f = 0; f < nforms; f++) {
+      _cluster_value(v, base, mult[f], add[f]);
+      if (mpz_sgn(v) <= 0 || !_GMP_is_prob_prime(v)) break;
+    }
+    if (f == nforms)  _cluster_push(&list, &nlist, &alloc, skip);
+    mpz_add_ui(base, base, 1);
+  }
+  if (mpz_cmp(base, high) > 0) {
+    mpz_clear(base);  mpz_clear(t);  mpz_clear(v);
+    *count = nlist;
+    return list;
+  }
+
+  /* The wheel: small primes while the range has room for them. */
+  New(0, roots, nforms, UV);
+  W = 1;
+  for (nwheel = 0; nwheel < 6; nwheel++) {
+    p = _cluster_wheel_primes[nwheel];
+    if (p > depth || W * p > (range - skip) / 64 + 1)  break;
+    W *= p;
+  }
+  New(0, resid, W, UV);
+  for (i = 0, nres = 0; i < W; i++) {
+    UV k;
+    for (k = 0; k < nwheel; k++) {
+      UV q = _cluster_wheel_primes[k], nr = _cluster_roots(q, nforms, mult, add, roots), r;
+      if (nr == UV_MAX) break;
+      for (r = 0; r < nr && roots[r] != i % q; r++)
+        ;
+      if (r < nr) break;
+    }
+    if (k == nwheel)  resid[nres++] = i;
+  }
+
+  /* n = base + resid[c] + W*j, with base a multiple of W, so the first
+   * lead positions are below low + skip and were tested above. */
+  mpz_init(cbase);
+  lead = mpz_fdiv_ui(base, W);
+  mpz_sub_ui(base, base, lead);
+  mpz_sub(t, high, base);
+  jtotal = mpz_get_ui(t) / W + 1;
+  jchunk = (nres == 0) ? jtotal : CLUSTER_SIEVE_BITS / nres;
+  if (jchunk < 64)  jchunk = 64;
+  if (jchunk > jtotal)  jchunk = jtotal;
+  words = (jchunk + 31) / 32;
+  New(0, bits, (nres == 0) ? 1 : nres * words, uint32_t);
+  candalloc = 1024;
+  New(0, cand, candalloc, UV);
+
+  for (j0 = 0; j0 < jtotal && nres > 0; j0 += jchunk) {
+    UV jn = (jtotal - j0 < jchunk) ? jtotal - j0 : jchunk, c, j;
+    PRIME_ITERATOR(iter);
+    memset(bits, 0, nres * words * sizeof(uint32_t));
+    mpz_set_ui(cbase, W);
+    mpz_mul_ui(cbase, cbase, j0);
+    mpz_add(cbase, cbase, base);
+    for (p = 2; p <= depth; p = prime_iterator_next(&iter)) {
+      UV nr, bmod, winv, r;
+      if (nwheel > 0 && p <= _cluster_wheel_primes[nwheel-1])  continue;
+      nr = _cluster_roots(p, nforms, mult, add, roots);
+      bmod = mpz_fdiv_ui(cbase, p);
+      winv = modinverse(W % p, p);
+      if (nr == UV_MAX) {
+        memset(bits, 0xFF, nres * words * sizeof(uint32_t));
+        break;
+      }
+      for (c = 0; c < nres; c++) {
+        uint32_t* b = bits + c * words;
+        UV rc = (bmod + resid[c]) % p;
+        for (r = 0; r < nr; r++) {
+          UV jj = ((roots[r] + p - rc) % p) * winv % p;
+          for ( ; jj < jn; jj += p)
+            b[jj >> 5] |= 1U << (jj & 31);
+        }
+      }
+    }
+    prime_iterator_destroy(&iter);
+
+    /* Survivors in increasing order, as offsets from low */
+    ncand = 0;
+    for (j = 0; j < jn; j++) {
+      for (c = 0; c < nres; c++) {
+        UV pos = resid[c] + W * (j0 + j), off;
+        if (bits[c * words + (j >> 5)] & (1U << (j & 31)))  continue;
+        if (pos < lead)  continue;
+        off = skip + pos - lead;
+        if (off > range)  continue;
+        if (ncand >= candalloc) {
+          candalloc *= 2;
+          Renew(cand, candalloc, UV);
+        }
+        cand[ncand++] = off;
+      }
+    }
+    ncand = _cluster_test(low, cand, ncand, nforms, mult, add);
+    for (i = 0; i < ncand; i++)
+      _cluster_push(&list, &nlist, &alloc, cand[i]);
+  }
+
+  Safefree(cand);
+  Safefree(bits);
+  Safefree(resid);
+  Safefree(roots);
+  mpz_clear(cbase);  mpz_clear(base);  mpz_clear(t);  mpz_clear(v);
+  *count = nlist;
+  return list;
+}
+
+/*****************************************************************************/
+/*  Polynomial values: the n in [low, high] where f(n) is prime, for f with
+ *  integer coefficients.  This covers n^2+1 style families as well as
+ *  k*b^e+c over a range of k (f = b^e*x + c).
+ *
+ *  The roots of f mod each sieving prime are found once.  Linear and
+ *  quadratic f are done directly, higher degree takes gcd(f, x^p-x) and
+ *  splits it.  The range is then sieved in chunks: each root marks every
+ *  p-th position.  Where |f(n)| might be no larger than the depth a
+ *  marked position could be the prime p itself, so those positions are
+ *  found with a Taylor bound and always tested.  Survivors are evaluated
+ *  and given LLR if it applies, else BPSW.
+ */
+
+#define POLY_DEPTH(log2f) \
+  ((log2f) > 60000 ? 4200000000UL : (log2f) * (log2f) / 8 + 1000)
+/* Positions sieved at once */
+#define POLY_SIEVE_BITS  (1UL << 22)
+/* Intervals with possibly small values are split down to this length */
+#define POLY_SMALL_LEN   64
+
+static void _poly_value(mpz_t v, mpz_t n, mpz_t* coef, UV deg)
+{
+  UV i;
+  mpz_set(v, coef[deg]);
+  for (i = deg; i-- > 0; ) {
+    mpz_mul(v, v, n);
+    mpz_add(v, v, coef[i]);
+  }
+}
+
+/* Roots of f mod p for higher degree: the roots of gcd(f, x^p - x).
+ * c[] is reduced mod p with c[d] nonzero. */
+static UV _poly_roots_split(UV p, const UV* c, UV d, UV* roots)
+{
+  mpz_t P, xx[2], *f, *xp, *g, *rts;
+  long i, dxp, dg, nrts = 0;
+  UV inv = modinverse(c[d], p), nroots = 0;
+
+  mpz_init_set_ui(P, p);
+  mpz_init_set_ui(xx[0], 0);
+  mpz_init_set_ui(xx[1], 1);
+  New(0, f, d+1, mpz_t);
+  New(0, xp, 2*d+1, mpz_t);
+  New(0, g, 2*d+1, mpz_t);
+  for (i = 0; i <= (long)d; i++)
+    mpz_init_set_ui(f[i], (c[i] * inv) % p);
+  for (i = 0; i <= 2*(long)d; i++) {
+    mpz_init(xp[i]);
+    mpz_init(g[i]);
+  }
+  polyz_pow_polymod(xp, xx, f, &dxp, 1, d, P, P);
+  for (i = dxp+1; i <= 1; i++)
+    mpz_set_ui(xp[i], 0);
+  if (dxp < 1)  dxp = 1;
+  mpz_sub_ui(xp[1], xp[1], 1);
+  mpz_mod(xp[1], xp[1], P);
+  polyz_gcd(g, f, xp, &dg, d, dxp, P);
+  if (dg > 0) {
+    polyz_roots_modp(&rts, &nrts, 0, g, dg, P, get_randstate());
+    for (i = 0; i < nrts; i++)
+      roots[nroots++] = mpz_get_ui(rts[i]);
+    for (i = 0; i <= dg; i++)
+      mpz_clear(rts[i]);
+    Safefree(rts);
+  }
+  for (i = 0; i <= 2*(long)d; i++) {
+    mpz_clear(xp[i]);
+    mpz_clear(g[i]);
+  }
+  for (i = 0; i <= (long)d; i++)
+    mpz_clear(f[i]);
+  Safefree(g);
+  Safefree(xp);
+  Safefree(f);
+  mpz_clear(xx[0]);  mpz_clear(xx[1]);  mpz_clear(P);
+  return nroots;
+}
+
+/* The roots of f mod p, with c[] the coefficients reduced mod p.  Returns
+ * the number of them, or UV_MAX if f is always a multiple of p.  Roots may
+ * be missed for degree above 2, which only makes the sieve weaker. */
+static UV _poly_roots(UV p, const UV* c, UV deg, UV* roots, mpz_t* t)
+{
+  UV d = deg, nroots = 0, r, i;
+
+  while (d > 0 && c[d] == 0)  d--;
+  if (d == 0)
+    return (c[0] == 0) ? UV_MAX : 0;
+  if (p < 64 || (d > 2 && p < 2048)) {
+    for (r = 0; r < p; r++) {
+      UV v = c[d];
+      for (i = d; i-- > 0; )
+        v = (v * r + c[i]) % p;
+      if (v == 0)  roots[nroots++] = r;
+    }
+    return nroots;
+  }
+  if (d == 1) {
+    roots[0] = ((p - c[0]) % p) * modinverse(c[1], p) % p;
+    return 1;
+  }
+  if (d == 2) {                     /* (-b +- sqrt(b^2-4ac)) / 2a */
+    UV inv2a = modinverse((2 * c[2]) % p, p), mb = (p - c[1]) % p, s, disc;
+    disc = (c[1] * c[1] + p - (((4 * c[2]) % p) * c[0]) % p) % p;
+    if (disc == 0) {
+      roots[0] = mb * inv2a % p;
+      return 1;
+    }
+    mpz_set_ui(t[0], disc);
+    mpz_set_ui(t[1], p);
+    if (!sqrtmod(t[2], t[0], t[1], t[3], t[4], t[5], t[6]))
+      return 0;
+    s = mpz_get_ui(t[2]);
+    roots[0] = ((mb + s) % p) * inv2a % p;
+    roots[1] = ((mb + p - s) % p) * inv2a % p;
+    return 2;
+  }
+  return _poly_roots_split(p, c, d, roots);
+}
+
+/* Add to the list (as start, length pairs relative to a) the parts of
+ * [a+start, a+start+len) where |f(n)| may be at most bound.  With the
+ * Taylor shift g(x) = f(a+start+x), no value is that small if
+ * |g_0| > bound + sum |g_i| (len-1)^i. */
+static void _poly_small(mpz_t* coef, UV deg, mpz_t a, UV start, UV len,
+                        UV bound, mpz_t* g, mpz_t s,
+                        UV** list, UV* n, UV* alloc)
+{
+  UV i, j;
+  mpz_add_ui(s, a, start);
+  for (i = 0; i <= deg; i++)
+    mpz_set(g[i], coef[i]);
+  for (i = 0; i < deg; i++)
+    for (j = deg; j-- > i; )
+      mpz_addmul(g[j], s, g[j+1]);
+  mpz_abs(s, g[deg]);
+  for (i = deg; i-- > 1; ) {
+    mpz_mul_ui(s, s, len-1);
+    mpz_add(s, s, g[i]);  /* |g_i| */
+    if (mpz_sgn(g[i]) < 0)  mpz_submul_ui(s, g[i], 2);
+  }
+  if (deg > 0)  mpz_mul_ui(s, s, len-1);
+  else          mpz_set_ui(s, 0);
+  mpz_add_ui(s, s, bound);
+  if (mpz_cmpabs(g[0], s) > 0)
+    return;
+  if (len <= POLY_SMALL_LEN) {
+    _cluster_push(list, n, alloc, start);
+    _cluster_push(list, n, alloc, len);
+    return;
+  }
+  _poly_small(coef, deg, a, start, len/2, bound, g, s, list, n, alloc);
+  _poly_small(coef, deg, a, start+len/2, len-len/2, bound, g, s, list, n, alloc);
+}
+
+typedef struct {
+  mpz_ptr low;
+  UV *off, noff;          /* test f(n) for n = low + off[i] */
+  mpz_t* coef;
+  UV deg;
+  char* pass;
+} poly_job_t;
+
+static void _poly_test_job(void* vjob)
+{
+  poly_job_t* J = (poly_job_t*) vjob;
+  mpz_t n, v;
+  UV i;
+  int res;
+  mpz_init(n);  mpz_init(v);
+  for (i = 0; i < J->noff; i++) {
+    mpz_add_ui(n, J->low, J->off[i]);
+    _poly_value(v, n, J->coef, J->deg);
+    if (mpz_cmp_ui(v, 1) <= 0) {
+      res = 0;
+    } else {
+      res = llr(v);
+      if (res < 0)  res = _GMP_BPSW(v);
+    }
+    J->pass[i] = (res > 0);
+  }
+  mpz_clear(n);  mpz_clear(v);
+}
+
+/* Test f(low+off[i]) for each candidate, keeping those that pass. */
+static UV _poly_test(mpz_t low, UV* off, UV noff, mpz_t* coef, UV deg)
+{
+  poly_job_t* jobs;
+  char* pass;
+  UV i, njobs, per, nkeep = 0;
+
+  if (noff == 0) return 0;
+  njobs = 4 * get_thread_count();
+  if (njobs > noff) njobs = noff;
+  per = (noff + njobs - 1) / njobs;
+  njobs = (noff + per - 1) / per;
+  New(0, jobs, njobs, poly_job_t);
+  New(0, pass, noff, char);
+  for (i = 0; i < njobs; i++) {
+    jobs[i].low = low;
+    jobs[i].off = off + i*per;
+    jobs[i].noff = (i == njobs-1) ? noff - i*per : per;
+    jobs[i].coef = coef;
+    jobs[i].deg = deg;
+    jobs[i].pass = pass + i*per;
+  }
+  run_parallel(_poly_test_job, jobs, sizeof(poly_job_t), njobs);
+  for (i = 0; i < noff; i++)
+    if (pass[i])
+      off[nkeep++] = off[i];
+  Safefree(pass);
+  Safefree(jobs);
+  return nkeep;
+}
+
+UV* sieve_polynomial(mpz_t low, mpz_t high, UV deg, mpz_t* coef, UV* count)
+{
+  UV *list = 0, nlist = 0, alloc = 0;
+  UV *tab = 0, ntab = 0, taballoc = 0;       /* (p, root) pairs */
+  UV *small = 0, nsmall, smallalloc = 0;
+  UV *c, *roots, *cand, ncand, candalloc;
+  UV i, p, depth, range, log2f, maxbits, chunk, words, off0;
+  int allmarked = 0;
+  uint32_t* bits;
+  mpz_t t[7], *g, cbase;
+
+  *count = 0;
+  while (deg > 0 && mpz_sgn(coef[deg]) == 0)  deg--;
+  if (mpz_cmp(low, high) > 0)  return 0;
+  mpz_init(t[0]);
+  mpz_sub(t[0], high, low);
+  if (!mpz_fits_ulong_p(t[0]) || mpz_cmp_ui(t[0], UV_MAX-1) >= 0)
+    croak("sieve_polynomial: range too large");
+  range = mpz_get_ui(t[0]);
+  for (i = 1; i < 7; i++)
+    mpz_init(t[i]);
+
+  for (i = 0, maxbits = 1; i <= deg; i++)
+    if (mpz_sizeinbase(coef[i], 2) > maxbits)
+      maxbits = mpz_sizeinbase(coef[i], 2);
+  log2f = deg * mpz_sizeinbase(high, 2) + maxbits + 8;
+  depth = POLY_DEPTH(log2f);
+#if BITS_PER_WORD == 32
+  if (depth > 65535)  depth = 65535;           /* residue products fit */
+#endif
+
+  /* Roots of f mod each sieving prime */
+  New(0, c, deg+1, UV);
+  New(0, roots, deg+1, UV);
+  {
+    PRIME_ITERATOR(iter);
+    for (p = 2; p <= depth; p = prime_iterator_next(&iter)) {
+      UV nr, r;
+      for (i = 0; i <= deg; i++)
+        c[i] = mpz_fdiv_ui(coef[i], p);
+      nr = _poly_roots(p, c, deg, roots, t);
+      if (nr == UV_MAX) {
+        allmarked = 1;
+        break;
+      }
+      for (r = 0; r < nr; r++) {
+        _cluster_push(&tab, &ntab, &taballoc, p);
+        _cluster_push(&tab, &ntab, &taballoc, roots[r]);
+      }
+    }
+    prime_iterator_destroy(&iter);
+  }
+  Safefree(roots);
+  Safefree(c);
+
+  New(0, g, deg+1, mpz_t);
+  for (i = 0; i <= deg; i++)
+    mpz_init(g[i]);
+  mpz_init(cbase);
+  chunk = (range < POLY_SIEVE_BITS) ? range+1 : POLY_SIEVE_BITS;
+  words = (chunk + 31) / 32;
+  New(0, bits, words, uint32_t);
+  candalloc = 1024;
+  New(0, cand, candalloc, UV);
+
+  for (off0 = 0; off0 <= range; off0 += chunk) {
+    UV len = (range - off0 < chunk) ? range - off0 + 1 : chunk, bmod = 0, pos;
+    mpz_add_ui(cbase, low, off0);
+    if (allmarked) {
+      memset(bits, 0xFF, words * sizeof(uint32_t));
+    } else {
+      memset(bits, 0, words * sizeof(uint32_t));
+      for (i = 0; i < ntab; i += 2) {
+        p = tab[i];
+        if (i == 0 || p != tab[i-2])
+          bmod = mpz_fdiv_ui(cbase, p);
+        for (pos = (tab[i+1] + p - bmod) % p; pos < len; pos += p)
+          bits[pos >> 5] |= 1U << (pos & 31);
+      }
+    }
+    /* A marked value could be the sieving prime itself */
+    nsmall = 0;
+    _poly_small(coef, deg, cbase, 0, len, depth, g, t[0],
+                &small, &nsmall, &smallalloc);
+    for (i = 0; i < nsmall; i += 2)
+      for (pos = small[i]; pos < small[i] + small[i+1]; pos++)
+        bits[pos >> 5] &= ~(1U << (pos & 31));
+
+    ncand = 0;
+    for (pos = 0; pos < len; pos++) {
+      if (bits[pos >> 5] & (1U << (pos & 31)))  continue;
+      if (ncand >= candalloc) {
+        candalloc *= 2;
+        Renew(cand, candalloc, UV);
+      }
+      cand[ncand++] = off0 + pos;
+    }
+    ncand = _poly_test(low, cand, ncand, coef, deg);
+    for (i = 0; i < ncand; i++)
+      _cluster_push(&list, &nlist, &alloc, cand[i]);
+    if (range - off0 < chunk)  break;         /* range may be near UV_MAX */
+  }
+
+  Safefree(cand);
+  Safefree(bits);
+  if (small != 0)  Safefree(small);
+  if (tab != 0)  Safefree(tab);
+  for (i = 0; i <= deg; i++)
+    mpz_clear(g[i]);
+  Safefree(g);
+  mpz_clear(cbase);
+  for (i = 0; i < 7; i++)
+    mpz_clear(t[i]);
+  *count = nlist;
+  return list;
+}
+
+/* Primes p = a mod d in [low, high].  The terms first + k*d are f(k) for a
+ * linear f, so each sieving prime's start in k is -first/d mod p, and
+ * nothing outside the progression is sieved or tested. */
+UV* primes_in_ap(mpz_t first, mpz_t a, mpz_t d, mpz_t low, mpz_t high,
+                 UV* count)
+{
+  mpz_t coef[2], klow, khigh;
+  UV* list;
+
+  *count = 0;
+  if (mpz_sgn(d) <= 0)  croak("primes_in_ap: d must be positive");
+  mpz_init(coef[0]);  mpz_init_set(coef[1], d);
+  mpz_sub(coef[0], a, low);
+  mpz_fdiv_r(coef[0], coef[0], d);
+  mpz_add(coef[0], coef[0], low);      /* smallest term >= low */
+  mpz_set(first, coef[0]);
+  if (mpz_cmp(first, high) > 0) {
+    mpz_clear(coef[0]);  mpz_clear(coef[1]);
+    return 0;
+  }
+  mpz_init_set_ui(klow, 0);
+  mpz_init(khigh);
+  mpz_sub(khigh, high, first);
+  mpz_fdiv_q(khigh, khigh, d);
+  if (!mpz_fits_ulong_p(khigh) || mpz_cmp_ui(khigh, UV_MAX-1) >= 0)
+    croak("primes_in_ap: range too large");
+  list = sieve_polynomial(klow, khigh, 1, coef, count);
+  mpz_clear(klow);  mpz_clear(khigh);
+  mpz_clear(coef[0]);  mpz_clear(coef[1]);
+  return list;
+}
+
+/*****************************************************************************/
+/*  Pi using the Chudnovsky series with binary splitting.
+ *
+ *  P, Q, T for the terms [a,b) are built with integer arithmetic only, so
+ *  no mpf default precision is touched.  With more than one thread the term
+ *  range is cut into chunks evaluated in parallel, then merged pairwise.
+ *
+ *  Conversion to decimal is divide and conquer using a table of 10^(L*2^k),
+ *  which lets us stream the digits out rather than build one giant string.
+ */
+
+#define PI_DIGITS_PER_TERM  14.181647462725477   /* log10(640320^3/1728) */
+#define PI_GUARD_DIGITS     10
+#define PI_DC_LEAF_DIGITS   16384
+
+typedef struct {
+  UV a, b;
+  mpz_t P, Q, T;
+  mpz_t *C3_24;
+} pi_bs_t;
+
+typedef struct {
+  pi_bs_t *L, *R;
+} pi_merge_t;
+
+typedef struct {
+  char* buf;     /* If non-NULL, digits are appended here */
+  int   fd;      /* otherwise they are written to this descriptor */
+  int   err;
+} pi_out_t;
+
+static void _pi_bs(mpz_t P, mpz_t Q, mpz_t T, UV a, UV b, mpz_t C3_24)
+{
+  if (b - a == 1) {
+    if (a == 0) {
+      mpz_set_ui(P, 1);
+      mpz_set_ui(Q, 1);
+    } else {
+      mpz_set_ui(P, 6*a-5);  mpz_mul_ui(P, P, 2*a-1);  mpz_mul_ui(P, P, 6*a-1);
+      mpz_set_ui(Q, a);      mpz_mul_ui(Q, Q, a);      mpz_mul_ui(Q, Q, a);
+      mpz_mul(Q, Q, C3_24);
+    }
+    mpz_set_ui(T, 545140134);
+    mpz_mul_ui(T, T, a);
+    mpz_add_ui(T, T, 13591409);
+    mpz_mul(T, T, P);
+    if (a & 1) mpz_neg(T, T);
+  } else {
+    mpz_t P2, Q2, T2;
+    UV m = a + (b-a)/2;
+    mpz_init(P2);  mpz_init(Q2);  mpz_init(T2);
+    _pi_bs(P,  Q,  T,  a, m, C3_24);
+    _pi_bs(P2, Q2, T2, m, b, C3_24);
+    /* T = T*Q2 + P*T2,  P = P*P2,  Q = Q*Q2 */
+    mpz_mul(T, T, Q2);
+    mpz_mul(T2, T2, P);
+    mpz_add(T, T, T2);
+    mpz_mul(P, P, P2);
+    mpz_mul(Q, Q, Q2);
+    mpz_clear(P2);  mpz_clear(Q2);  mpz_clear(T2);
+  }
+}
+static void _pi_bs_job(void* vjob)
+{
+  pi_bs_t* job = (pi_bs_t*) vjob;
+  _pi_bs(job->P, job->Q, job->T, job->a, job->b, *(job->C3_24));
+}
+static void _pi_merge_job(void* vjob)
+{
+  pi_bs_t *L = ((pi_merge_t*)vjob)->L,  *R = ((pi_merge_t*)vjob)->R;
+  mpz_mul(L->T, L->T, R->Q);
+  mpz_mul(R->T, R->T, L->P);
+  mpz_add(L->T, L->T, R->T);
+  mpz_mul(L->P, L->P, R->P);
+  mpz_mul(L->Q, L->Q, R->Q);
+  L->b = R->b;
+}
+
+/* r = round(Pi * 10^(n-1)), an n digit integer */
+static void _pi_scaled(mpz_t r, UV n)
+{
+  mpz_t C3_24, S, t;
+  pi_bs_t *chunks;
+  pi_merge_t *merges;
+  UV i, step, digits = n - 1 + PI_GUARD_DIGITS;
+  UV nterms = (UV)(digits / PI_DIGITS_PER_TERM) + 2;
+  UV nchunks = get_thread_count();
+
+  if (nchunks > nterms/64)  nchunks = 1;
+
+  mpz_init_set_str(C3_24, "10939058860032000", 10);   /* 640320^3 / 24 */
+  New(0, chunks, nchunks, pi_bs_t);
+  New(0, merges, nchunks, pi_merge_t);
+  for (i = 0; i < nchunks; i++) {
+    chunks[i].a = (nterms * i) / nchunks;
+    chunks[i].b = (nterms * (i+1)) / nchunks;
+    chunks[i].C3_24 = &C3_24;
+    mpz_init(chunks[i].P);  mpz_init(chunks[i].Q);  mpz_init(chunks[i].T);
+  }
+  run_parallel(_pi_bs_job, chunks, sizeof(pi_bs_t), nchunks);
+  for (step = 1; step < nchunks; step *= 2) {
+    UV nmerges = 0;
+    for (i = 0; i+step < nchunks; i += 2*step) {
+      merges[nmerges].L = chunks + i;
+      merges[nmerges].R = chunks + i + step;
+      nmerges++;
+    }
+    run_parallel(_pi_merge_job, merges, sizeof(pi_merge_t), nmerges);
+  }
+
+  /* Pi = 426880 * sqrt(10005) * Q / T */
+  mpz_init(S);  mpz_init(t);
+  mpz_ui_pow_ui(t, 10, 2*digits);
+  mpz_mul_ui(t, t, 10005);
+  mpz_sqrt(S, t);
+  mpz_mul_ui(S, S, 426880);
+  mpz_mul(S, S, chunks[0].Q);
+  mpz_tdiv_q(r, S, chunks[0].T);
+  /* Round off the guard digits */
+  mpz_ui_pow_ui(t, 10, PI_GUARD_DIGITS);
+  mpz_tdiv_q_2exp(S, t, 1);
+  mpz_add(r, r, S);
+  mpz_tdiv_q(r, r, t);
+
+  for (i = 0; i < nchunks; i++) {
+    mpz_clear(chunks[i].P);  mpz_clear(chunks[i].Q);  mpz_clear(chunks[i].T);
+  }
+  Safefree(merges);
+  Safefree(chunks);
+  mpz_clear(t);  mpz_clear(S);  mpz_clear(C3_24);
+}
+
+static void _pi_emit(pi_out_t* o, const char* s, size_t len)
+{
+  if (o->buf) {
+    memcpy(o->buf, s, len);
+    o->buf += len;
+    return;
+  }
+  while (len > 0 && !o->err) {
+    long w = write(o->fd, s, len);
+    if (w <= 0) { o->err = 1; break; }
+    s += w;
+    len -= w;
+  }
+}
+
+/* Output X as exactly nd decimal digits, zero padded on the left.
+ * pow10[k] = 10^(PI_DC_LEAF_DIGITS * 2^k).  leafbuf holds a leaf string. */
+static void _pi_dc_out(pi_out_t* o, mpz_t X, UV nd, mpz_t* pow10, int k, char* leafbuf)
+{
+  while (k >= 0 && ((UV)PI_DC_LEAF_DIGITS << k) >= nd)
+    k--;
+  if (k < 0) {
+    size_t len;
+    (void) mpz_get_str(leafbuf, 10, X);
+    len = strlen(leafbuf);
+    if (len < nd) {
+      memmove(leafbuf + (nd-len), leafbuf, len);
+      memset(leafbuf, '0', nd-len);
+    }
+    _pi_emit(o, leafbuf, nd);
+  } else {
+    UV lowdigits = (UV)PI_DC_LEAF_DIGITS << k;
+    mpz_t q, r;
+    mpz_init(q);  mpz_init(r);
+    mpz_tdiv_qr(q, r, X, pow10[k]);
+    _pi_dc_out(o, q, nd - lowdigits, pow10, k-1, leafbuf);
+    mpz_clear(q);
+    _pi_dc_out(o, r, lowdigits, pow10, k-1, leafbuf);
+    mpz_clear(r);
+  }
+}
+
+/* Write "3.14159..." with n total digits */
+static void _pi_out(pi_out_t* o, UV n)
+{
+  mpz_t r, t, pow10[BITS_PER_WORD];
+  char* leafbuf;
+  int k, nk = 0;
+
+  _pi_emit(o, "3.", (n <= 1) ? 1 : 2);
+  if (n <= 1) return;
+
+  mpz_init(r);  mpz_init(t);
+  _pi_scaled(r, n);
+  n--;                                   /* Remove the leading 3 */
+  mpz_ui_pow_ui(t, 10, n);
+  mpz_submul_ui(r, t, 3);
+  mpz_clear(t);
+
+  if (n > PI_DC_LEAF_DIGITS) {
+    mpz_init(pow10[0]);
+    mpz_ui_pow_ui(pow10[0], 10, PI_DC_LEAF_DIGITS);
+    for (nk = 1; ((UV)PI_DC_LEAF_DIGITS << nk) < n; nk++) {
+      mpz_init(pow10[nk]);
+      mpz_mul(pow10[nk], pow10[nk-1], pow10[nk-1]);
+    }
+  }
+  New(0, leafbuf, PI_DC_LEAF_DIGITS+2, char);
+  _pi_dc_out(o, r, n, pow10, nk-1, leafbuf);
+  Safefree(leafbuf);
+  for (k = 0; k < nk; k++)
+    mpz_clear(pow10[k]);
+  mpz_clear(r);
+}
+
+int pidigits_fd(UV n, int fd)
+{
+  pi_out_t o;
+  o.buf = 0;  o.fd = fd;  o.err = 0;
+  _pi_out(&o, n);
+  return !o.err;
+}
+
 char* pidigits(UV n) {
   char* out;
 
@@ -2807,8 +4294,9 @@ char* pidigits(UV n) {
     out[1] = '.';
     out[n+1] = '\0';
   }
-#else
-  /* AGM using GMP's floating point.  Fast and very good growth. */
+#elif 0
+  /* AGM using GMP's floating point.  Fast and very good growth, but it
+   * changes the global mpf default precision and the %Ff output is slow. */
   {
     mpf_t t, an, bn, tn, prev_an;
     UV k = 0;
@@ -2840,6 +4328,14 @@ char* pidigits(UV n) {
     mpf_clear(prev_an); mpf_clear(t);
     mpf_set_default_prec(oldprec);
   }
+#else
+  /* Chudnovsky with binary splitting, see _pi_out above. */
+  {
+    pi_out_t o;
+    o.buf = out;  o.fd = -1;  o.err = 0;
+    _pi_out(&o, n);
+    *(o.buf) = '\0';
+  }
 #endif
   return out;
 }
@@ -15,9 +15,40 @@ extern int  is_perrin_pseudoprime(mpz_t n);
 extern int  is_frobenius_pseudoprime(mpz_t n, IV P, IV Q);
 extern int  _GMP_miller_rabin_random(mpz_t n, UV numbases, char* seedstr);
 
+/* Miller-Rabin for many bases against one odd n > 3.  The mpz values are
+ * scratch temporaries, so contexts must be destroyed in LIFO order. */
+typedef struct {
+  mpz_ptr n, nminus1, d, x;
+  UV    s;
+  UV    mark;
+} mr_ctx_t;
+extern void mr_ctx_init(mr_ctx_t* ctx, mpz_t n);
+extern void mr_ctx_destroy(mr_ctx_t* ctx);
+extern int  mr_ctx_test(mr_ctx_t* ctx, mpz_t a);
+extern int  mr_ctx_test_ui(mr_ctx_t* ctx, UV base);
+
 extern void _GMP_lucas_seq(mpz_t U, mpz_t V, mpz_t n, IV P, IV Q, mpz_t k,
                            mpz_t Qk, mpz_t t);
 extern void lucasuv(mpz_t Uh, mpz_t Vl, IV P, IV Q, mpz_t k);
+
+/* Lucas sequences mod n for a fixed (P,Q,n), reused for many k.  Uses
+ * scratch temporaries, so contexts must be destroyed in LIFO order. */
+typedef struct {
+  mpz_ptr n;
+  IV    P, Q, D;
+  int   method;
+  mpz_ptr inv;                /* 1/D mod n when using the V chain */
+  mpz_ptr t;
+  UV    mark;
+  UV    nstates;              /* ladder states, one per bit for batches */
+  mpz_t *stU, *stV, *stQ;
+} lucas_ctx_t;
+extern void lucas_ctx_init(lucas_ctx_t* ctx, mpz_t n, IV P, IV Q);
+extern void lucas_ctx_destroy(lucas_ctx_t* ctx);
+/* U_k, V_k, Q^k mod n.  Any of U, V, Qk may be NULL. */
+extern void lucas_ctx_seq(lucas_ctx_t* ctx, mpz_t U, mpz_t V, mpz_t Qk, mpz_t k);
+/* U[i], V[i] for each of nk values k[i].  U or V may be NULL. */
+extern void lucas_ctx_seq_multi(lucas_ctx_t* ctx, mpz_t* U, mpz_t* V, mpz_t* k, UV nk);
 extern int lucas_lehmer(UV p);
 extern int llr(mpz_t N);
 
@@ -51,6 +82,20 @@ extern UV   is_power(mpz_t n, UV a);
 extern void exp_mangoldt(mpz_t res, mpz_t n);
 
 extern uint32_t* partial_sieve(mpz_t start, UV length, UV maxprime);
+/* The n in [low,high] with mult[i]*n + add[i] prime for each of the nforms
+ * forms, as a list of n-low (count in *count).  Safefree the list. */
+extern UV* sieve_cluster(mpz_t low, mpz_t high, UV nforms, const UV* mult,
+                         const IV* add, UV* count);
+/* The n in [low,high] with f(n) = sum coef[i]*n^i prime, as a list of
+ * n-low (count in *count).  Safefree the list. */
+extern UV* sieve_polynomial(mpz_t low, mpz_t high, UV deg, mpz_t* coef,
+                            UV* count);
+/* The primes a mod d in [low,high] are first + k*d for the returned k,
+ * where first is set to the smallest term at least low. */
+extern UV* primes_in_ap(mpz_t first, mpz_t a, mpz_t d, mpz_t low, mpz_t high,
+                        UV* count);
 extern char* pidigits(UV n);
+/* Write the n digits of pidigits(n) to a file descriptor.  0 on error. */
+extern int   pidigits_fd(UV n, int fd);
 
 #endif
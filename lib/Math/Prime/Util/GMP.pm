@@ -19,6 +19,9 @@ our @EXPORT_OK = qw(
                      is_provable_prime_with_cert
                      is_aks_prime
                      is_nminus1_prime
+                     is_nplus1_prime
+                     prove_nminus1
+                     prove_nplus1
                      is_ecpp_prime
                      is_pseudoprime
                      is_strong_pseudoprime
@@ -32,9 +35,13 @@ our @EXPORT_OK = qw(
                      is_mersenne_prime
                      is_llr_prime
                      miller_rabin_random
-                     lucas_sequence  lucasu  lucasv
+                     lucas_sequence  lucasu  lucasv  lucasumod  lucasvmod
                      primes
                      sieve_primes
+                     sieve_prime_cluster
+                     sieve_cunningham_chain
+                     sieve_polynomial
+                     primes_in_ap
                      next_prime
                      prev_prime
                      trial_factor
@@ -65,6 +72,7 @@ our @EXPORT_OK = qw(
                      znorder
                      znprimroot
                      Pi
+                     get_stats reset_stats
                    );
                    # Should add:
                    # nth_prime
@@ -104,11 +112,8 @@ sub is_strong_pseudoprime {
   my($n, @bases) = @_;
   _validate_positive_integer($n);
   croak "No bases given to is_strong_pseudoprime" unless @bases;
-  foreach my $base (@bases) {
-    _validate_positive_integer($base);
-    return 0 unless _GMP_miller_rabin("$n", "$base");
-  }
-  1;
+  _validate_positive_integer($_) for @bases;
+  return _GMP_miller_rabin("$n", map { "$_" } @bases);
 }
 
 sub is_provable_prime {
@@ -131,6 +136,25 @@ sub is_provable_prime_with_cert {
   return ($result, $text);
 }
 
+sub prove_nminus1 { return _prove_with_cert(0, @_); }
+sub prove_nplus1  { return _prove_with_cert(1, @_); }
+
+sub _prove_with_cert {
+  my ($np1, $n, @factors) = @_;
+  _validate_positive_integer($_) for ($n, @factors);
+  my @composite = (0, '');
+  return @composite if $n < 2;
+
+  my ($result, $text) = _prove_with_factors("$n", $np1, map { "$_" } @factors);
+  return @composite if $result == 0;
+  return ($result, '') if $result != 2;
+  $text = "Type Small\nN $n\n" if $text eq '' && $n < 4;
+  return ($result, '') if $text eq '';
+  $text =~ s/\n$//;
+  $text = "[MPU - Primality Certificate]\nVersion 1.0\n\nProof for:\nN $n\n\n$text";
+  return ($result, $text);
+}
+
 sub factor {
   my ($n) = @_;
   my @factors = ($n < 4) ? ($n)
@@ -168,7 +192,7 @@ __END__
 
 =encoding utf8
 
-=for stopwords Möbius Deléglise Bézout gcdext vecsum vecprod moebius totient liouville znorder znprimroot bernfrac stirling lucasu lucasv OpenPFGW gmpy2
+=for stopwords Möbius Deléglise Bézout gcdext vecsum vecprod moebius totient liouville znorder znprimroot bernfrac stirling lucasu lucasv lucasumod lucasvmod OpenPFGW gmpy2
 
 =head1 NAME
 
@@ -298,6 +322,9 @@ Takes a positive number as input and returns back either 0 (composite),
 exactly like C<is_prob_prime>, as will numbers less than C<2^64>.
 For numbers larger than C<2^64>, some additional tests are performed
 on probable primes to see if they can be proven by another means.
+Below C<3317044064679887385961981> (about C<2^81.5>), Miller-Rabin with
+the first 13 prime bases is deterministic (Sorenson and Webster, 2015), so
+the answer there is always 0 or 2.
 
 This call walks the line between the performance of L</is_prob_prime>
 and the certainty of L</is_provable_prime>.  Those calls may be more
@@ -340,8 +367,19 @@ taken to return either 0 or 2 for all numbers.
 
 The current method first uses BPSW and a small number of Miller-Rabin
 tests with random bases to weed out composites and provide a
-deterministic answer for tiny numbers (under C<2^64>).  A quick BLS75
+deterministic answer for tiny numbers (under C<2^64>).  Below
+C<3317044064679887385961981> the first 13 prime bases give a deterministic
+answer as well, unless a certificate is wanted.  A quick BLS75
 C<n-1> test is attempted, followed by ECPP.
+With C<_GMP_set_threads(n)> above 1 on non-Windows systems, inputs of 300
+bits or more then run a hard BLS75 C<n-1> proof and ECPP at the same time
+(and a BLS75 C<n+1> proof if no certificate is wanted), each in a child
+process, and the first proof found is returned.  Which one finishes first
+depends on how easily C<n-1> factors, so this smooths out the slow cases.
+Note that this means the module will C<fork>.  The children only compute,
+never run any Perl code, and leave with C<_exit>, but they do briefly
+share the process's open file descriptors.  Leave the thread count at 1
+if forking is a problem.
 
 The time required for primes of different input sizes on a circa-2009
 workstation averages about C<3ms> for 30-digits, C<5ms> for 40-digit,
@@ -617,6 +655,45 @@ slows down rapidly.
 
 Typically you should use L</is_provable_prime> and let it decide the method.
 
+=head2 is_nplus1_prime
+
+  say "$n is definitely prime" if is_nplus1_prime($n);
+
+Like L</is_nminus1_prime> but factoring C<n+1>, using a Lucas sequence in
+place of the Fermat tests.  This is the Brillhart-Lehmer-Selfridge
+theorem 15, or their theorem 14 with the factored part of C<n+1> a bit over
+the cube root of the input.  Numbers like C<k*p#-1> or C<n!-1>, where
+C<n+1> is smooth, are quickly proven this way.
+
+=head2 prove_nminus1
+
+  # n = 1021# + 1, so n-1 is the product of the primes to 1021
+  my ($isprime, $cert) = prove_nminus1($n, @{primes(1021)});
+
+Takes a positive number C<n> and a list of primes dividing C<n-1>, and
+returns the same result and certificate as L</is_provable_prime_with_cert>.
+This is for numbers like C<k*p#+1>, C<n!+1>, or C<k*2^m+1> where the
+factors of C<n-1> are known from the form, so no factoring is done: the
+given primes, along with any small primes dividing C<n-1>, go straight to
+the Brillhart-Lehmer-Selfridge theorem 5 checks.  Given primes over 64 bits
+are proven, with their proofs included in the certificate.  If the
+cofactor left over is a prime it is used as well.  The result is C<1> if
+not enough of C<n-1> is known (the factored part must be a bit over the
+cube root of C<n>).  Each given factor must be a prime divisor of C<n-1>.
+The 4042-digit C<1477!+1> takes a few seconds.
+
+=head2 prove_nplus1
+
+  my ($isprime, $cert) = prove_nplus1($n, @factors);
+
+Like L</prove_nminus1> but for known primes dividing C<n+1>, for numbers
+like C<k*p#-1> or C<n!-1>.  If the largest prime C<q> has C<2q-1> greater
+than the square root of C<n>, theorem 15 is used and a C<BLS15> certificate
+is returned.  Otherwise the factored part must be a bit over the cube root
+of C<n>, and an C<NP1> certificate is returned.  That is a certificate type
+of this module (see C<xt/proof-text-format.txt>, and C<examples/vcert.c>
+for a verifier) that L<Math::Prime::Util/verify_prime> does not yet know.
+
 =head2 is_ecpp_prime
 
   say "$n is definitely prime" if is_ecpp_prime($n);
@@ -673,6 +750,61 @@ list of values in the range with no small factors.  This is quite common
 for applications involving prime gaps.
 
 
+=head2 sieve_prime_cluster
+
+  my @twins = sieve_prime_cluster(10**100, 10**100 + 10**7, 2);
+  my @quads = sieve_prime_cluster($low, $high, 2, 6, 8);
+
+Given C<low>, C<high>, and a list of offsets, returns the values C<n> in
+the inclusive range where C<n> and C<n> plus each offset are all probable
+primes.  The range is sieved once for all the offsets together, ruling out
+every C<n> where any of the values has a small factor, and only the
+positions that survive for every offset get BPSW tests.  This is far
+faster than walking with L</next_prime> for twins, quadruplets, and other
+k-tuples.  The range (C<high> minus C<low>) must fit in a native integer.
+If the module was built with threads, C<_GMP_set_threads(n)> spreads the
+BPSW tests over C<n> threads.
+
+=head2 sieve_cunningham_chain
+
+  my @chains = sieve_cunningham_chain($low, $high, 5);      # p, 2p+1, ...
+  my @second = sieve_cunningham_chain($low, $high, 4, 2);   # p, 2p-1, ...
+
+Given C<low>, C<high>, a chain length, and an optional kind (1 for the first
+kind, the default, or 2 for the second kind), returns the C<p> in the
+inclusive range that start a Cunningham chain of at least that length:
+C<p>, C<2p+1>, C<4p+3>, ... (or C<2p-1>, C<4p-3>, ...) are all probable
+primes.  C<p> may also be in the middle of a longer chain.  This uses the
+same sieve as L</sieve_prime_cluster>.
+
+=head2 sieve_polynomial
+
+  my @n = sieve_polynomial(0, 10**6, 1, 0, 1);               # n^2+1
+  my @k = sieve_polynomial(1, 10**5, "1267650600228229401496703205376", -1);
+
+Given C<low>, C<high>, and the coefficients of a polynomial C<f> with the
+highest degree first, returns the C<n> in the inclusive range where C<f(n)>
+is a probable prime.  The second example finds the C<k> where C<k*2^100-1>
+is prime.  Coefficients may be negative, and values C<f(n)> below 2 are
+skipped.  The roots of C<f> modulo each small prime are found once, and the
+range sieved with them, so only values with no small factors are tested.
+Values of the form C<k*2^n-1> with C<k E<lt> 2^n> get the LLR test, which is
+a proof; the rest get BPSW.  As with L</sieve_prime_cluster>, the range
+must fit in a native integer and the tests are threaded.
+
+=head2 primes_in_ap
+
+  my @p = primes_in_ap(1, 4, 0, 100);             # primes 1 mod 4
+  my @q = primes_in_ap(1, 2**64 * 1000, 2**100, 2**100 + 2**84);
+
+Given C<a>, C<d>, C<low>, and C<high>, returns the primes C<p> in the
+inclusive range with C<p = a mod d>.  Only the terms of the progression are
+sieved and tested, so for large C<d> this is about C<d/phi(d)> times faster
+than L</sieve_primes> followed by a filter, and the range can be far larger
+than a native integer as long as the number of terms fits in one.  The
+primes are BPSW probable primes.
+
+
 =head2 next_prime
 
   $n = next_prime($n);
@@ -684,6 +816,9 @@ hence the result is a probable prime (using BPSW).
 
 For large inputs this function is quite a bit faster than GMP's
 C<mpz_nextprime> or Pari's C<nextprime>.
+Above 2000 bits, if the module was built with threads,
+C<_GMP_set_threads(n)> tests several sieved candidates at once and keeps the
+first one in order that is prime.  L</prev_prime> does the same.
 
 
 =head2 prev_prime
@@ -736,6 +871,25 @@ The following conditions must hold:
   - C<< k >= 0 >>
   - C<< n >= 2 >>
 
+=head2 lucasumod
+
+  my @U = lucasumod($P, $Q, $n, 1000 .. 2000);
+
+Given integers C<P>, C<Q>, a modulus C<n>, and one or more non-negative
+integers C<k>, returns the list of C<U_k mod n> in the same order as the
+C<k> values.  The same conditions as L</lucas_sequence> apply.
+
+The modulus-dependent setup is done once, and the C<k> values are
+processed in order of their bit strings so that values with common
+leading bits share the top of the ladder.  This makes evaluating many
+C<k> against one modulus much faster than individual calls.
+
+=head2 lucasvmod
+
+  my @V = lucasvmod($P, $Q, $n, @k);
+
+Like L</lucasumod> but returns the list of C<V_k mod n>.
+
 
 =head2 primorial
 
@@ -946,8 +1100,9 @@ over 100 or so.
 Takes a positive integer argument C<n> and returns the constant Pi with that
 many digits (including the leading 3).  Rounding is performed.
 
-The implementation uses AGM and is only slightly slower than MPFR (which has
-tighter bounds on the intermediate bits and exit conditions).
+The implementation uses the Chudnovsky series with binary splitting and
+integer arithmetic, followed by a divide and conquer decimal conversion.
+A million digits takes about a second.
 
 
 =head2 exp_mangoldt
@@ -1258,6 +1413,29 @@ However, it is substantially faster than the other methods on large inputs
 having large factors, and is the method of choice for 35+ digit semiprimes.
 
 
+=head2 get_stats
+
+  my $stats = get_stats();
+  printf "ECM: %d calls, %.2fs\n", $stats->{ecm}{calls}, $stats->{ecm}{seconds};
+
+Returns a hash reference of cumulative counters for the factoring and
+proving methods.  The keys are C<prho>, C<pbrent>, C<pminus1>, C<pplus1>,
+C<holf>, C<squfof>, C<ecm>, C<qs>, C<bls75>, C<ecpp>, and C<aks>.  Each
+value is a hash reference with C<calls>, C<successes>, and C<seconds>
+(elapsed wall time).  For the factoring methods a success means a
+factor was found, while for the proving methods it means a definite
+answer was given.  Calls made internally, e.g. by L</factor>, are counted.
+
+The C interface in C<stats.h> also allows a callback to receive start and
+end events for each call, including the method parameters (such as B1, B2,
+and the number of curves) and the size of the factor found.
+
+
+=head2 reset_stats
+
+Resets all the counters returned by L</get_stats> to zero.
+
+
 =head1 SEE ALSO
 
 =over 4
@@ -14,29 +14,47 @@ static const unsigned char distancewheel30[30] =
 static const unsigned char masktab30[30] = {
     0,  1,  0,  0,  0,  0,  0,  2,  0,  0,  0,  4,  0,  8,  0,
     0,  0, 16,  0, 32,  0,  0,  0, 64,  0,  0,  0,  0,  0,128  };
-static const unsigned char nextwheel30[30] = {
-    1,  7,  7,  7,  7,  7,  7, 11, 11, 11, 11, 13, 13, 17, 17,
-   17, 17, 19, 19, 23, 23, 23, 23, 29, 29, 29, 29, 29, 29,  1 };
 static const unsigned char prevwheel30[30] = {
    29, 29,  1,  1,  1,  1,  1,  1,  7,  7,  7,  7, 11, 11, 13,
    13, 13, 13, 17, 17, 19, 19, 19, 19, 23, 23, 23, 23, 23, 23 };
+/* The bits in a byte for values above m */
+static const unsigned char abovemask30[30] = {
+  255,254,254,254,254,254,254,252,252,252,252,248,248,240,240,
+  240,240,224,224,192,192,192,192,128,128,128,128,128,128,  0 };
+/* The value of the lowest set bit.  Used on an inverted sieve byte, this
+ * gives the first prime in it without testing bits one at a time. */
+static const unsigned char lowbit30[256] = {
+   0, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  19, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  23, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  19, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  29, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  19, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  23, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  19, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1,
+  17, 1, 7, 1,11, 1, 7, 1,13, 1, 7, 1,11, 1, 7, 1 };
 
 static INLINE UV next_prime_in_segment( const unsigned char* sieve, UV segment_start, UV segment_bytes, UV p)
 {
   UV d, m;
+  unsigned char s;
   if (p < segment_start) return 0;
   d = (p-segment_start)/30;
   if (d >= segment_bytes) return 0;
   m = (p-segment_start) - d*30;
-  do {
-    if (m==29) {
-      d++; m = 1;
-      if (d >= segment_bytes) return 0;
-    } else {
-      m = nextwheel30[m];
-    }
-  } while (sieve[d] & masktab30[m]);
-  return (segment_start + d*30 + m);
+  s = ~sieve[d] & abovemask30[m];
+  while (s == 0) {
+    if (++d >= segment_bytes) return 0;
+    s = ~sieve[d];
+  }
+  return (segment_start + d*30 + lowbit30[s]);
 }
 static INLINE int is_prime_in_segment( const unsigned char* sieve, UV segment_start, UV segment_bytes, UV p)
 {
@@ -138,6 +156,39 @@ static const unsigned char presieve13[PRESIEVE_SIZE] =
   0x18,0x89,0x08,0x25,0x44,0x22,0x30,0x14,0xc3,0x88,0x86,0x40,0x1a,
   0x28,0x30,0x85,0x09,0x54,0x60,0x43,0x24,0x92,0x81,0x08,0x04,0x70};
 
+/* Built from presieve13 at startup: 7*11*13*17 bytes with 17 also marked,
+ * and 19*23 bytes marking 19 and 23 (plus a word more, so it can be read
+ * a word at a time from any offset).  Filling with the first and ORing in
+ * the second means the sieves start at 29. */
+#define PRESIEVE17_SIZE (PRESIEVE_SIZE*17)
+#define PRESIEVE23_SIZE (19*23)
+static unsigned char presieve17[PRESIEVE17_SIZE];
+static unsigned char presieve23[PRESIEVE23_SIZE + sizeof(UV)];
+static int presieve_ready = 0;
+
+static void presieve_init(void)
+{
+  static const unsigned char wheel30[8] = {1,7,11,13,17,19,23,29};
+  UV d, b;
+  for (d = 0; d < PRESIEVE17_SIZE; d++) {
+    unsigned char c = presieve13[d % PRESIEVE_SIZE];
+    for (b = 0; b < 8; b++)
+      if ((30*d + wheel30[b]) % 17 == 0)
+        c |= 1 << b;
+    presieve17[d] = c;
+  }
+  for (d = 0; d < PRESIEVE23_SIZE + sizeof(UV); d++) {
+    unsigned char c = 0;
+    for (b = 0; b < 8; b++) {
+      UV n = 30*(d % PRESIEVE23_SIZE) + wheel30[b];
+      if (n % 19 == 0 || n % 23 == 0)
+        c |= 1 << b;
+    }
+    presieve23[d] = c;
+  }
+  presieve_ready = 1;
+}
+
 #define FIND_COMPOSITE_POS(i,j) \
   { \
     UV dlast = d; \
@@ -165,23 +216,36 @@ static const unsigned char presieve13[PRESIEVE_SIZE] =
 static void sieve_prefill(unsigned char* mem, UV startd, UV endd)
 {
   UV nbytes = endd - startd + 1;
+  UV i, off;
   MPUassert( (mem != 0) && (endd >= startd), "sieve_prefill bad arguments");
 
-  /* Walk the memory, tiling in the presieve area using memcpy.
-   * This is pretty fast, but it might still benefit from using copy
-   * doubling (where we copy to the memory, then copy memory to memory
-   * doubling in size each time), as memcpy usually loves big chunks.
-   */
-  while (startd <= endd) {
-    UV pstartd = startd % PRESIEVE_SIZE;
-    UV sieve_bytes = PRESIEVE_SIZE - pstartd;
-    UV bytes = (nbytes > sieve_bytes) ? sieve_bytes : nbytes;
-    memcpy(mem, presieve13 + pstartd, bytes);
-    if (startd == 0)  mem[0] = 0x01; /* Correct first byte */
-    startd += bytes;
-    mem += bytes;
-    nbytes -= bytes;
+  if (!presieve_ready)  presieve_init();
+
+  /* Tile in 7 through 17 using memcpy. */
+  for (i = 0, off = startd % PRESIEVE17_SIZE;  i < nbytes;  off = 0) {
+    UV bytes = PRESIEVE17_SIZE - off;
+    if (bytes > nbytes - i)  bytes = nbytes - i;
+    memcpy(mem + i, presieve17 + off, bytes);
+    i += bytes;
+  }
+
+  /* OR in 19 and 23 a word at a time. */
+  off = startd % PRESIEVE23_SIZE;
+  for (i = 0; i + sizeof(UV) <= nbytes; i += sizeof(UV)) {
+    UV w, pat;
+    memcpy(&w, mem + i, sizeof(UV));
+    memcpy(&pat, presieve23 + off, sizeof(UV));
+    w |= pat;
+    memcpy(mem + i, &w, sizeof(UV));
+    off += sizeof(UV);
+    if (off >= PRESIEVE23_SIZE)  off -= PRESIEVE23_SIZE;
+  }
+  for ( ; i < nbytes; i++) {
+    mem[i] |= presieve23[off];
+    if (++off >= PRESIEVE23_SIZE)  off = 0;
   }
+
+  if (startd == 0)  mem[0] = 0x01; /* Correct first byte */
 }
 
 
@@ -202,11 +266,11 @@ static unsigned char* sieve_erat30(UV end)
     return 0;
   }
 
-  /* Fill buffer with marked 7, 11, and 13 */
+  /* Fill buffer with marked 7 through 23 */
   sieve_prefill(mem, 0, max_buf-1);
 
   limit = sqrt((double) end);  /* prime*prime can overflow */
-  for (prime = 17; prime <= limit; prime = next_prime_in_sieve(mem,prime)) {
+  for (prime = 29; prime <= limit; prime = next_prime_in_sieve(mem,prime)) {
     UV d = (prime*prime)/30;
     UV m = (prime*prime) - d*30;
     UV dinc = (2*prime)/30;
@@ -246,7 +310,7 @@ static int sieve_segment(unsigned char* mem, UV startd, UV endd,
   MPUassert( (mem != 0) && (endd >= startd) && (endp >= startp),
              "sieve_segment bad arguments");
 
-  /* Fill buffer with marked 7, 11, and 13 */
+  /* Fill buffer with marked 7 through 23 */
   sieve_prefill(mem, startd, endd);
 
   limit = sqrt((double) endp);
@@ -259,9 +323,9 @@ static int sieve_segment(unsigned char* mem, UV startd, UV endd,
   }
   MPUassert( sieve != 0, "Could not generate base sieve" );
 
-  for (p = 17; p <= limit; p = next_prime_in_sieve(sieve,p))
+  for (p = 29; p <= limit; p = next_prime_in_sieve(sieve,p))
   {
-    /* p increments from 17 to at least sqrt(endp) */
+    /* p increments from 29 to at least sqrt(endp) */
     UV p2 = p*p;   /* TODO: overflow */
     if (p2 > endp)  break;
     /* Find first multiple of p greater than p*p and larger than startp */
@@ -581,16 +645,21 @@ UV* sieve_to_n(UV n, UV* count)
   else
     sieve = sieve_erat30(n);
   max_buf = (n/30) + ((n%30) != 0);
+  /* Take the primes a byte at a time, lowest bit first, skipping over
+   * words with no primes. */
   for (i = 1, p = 30;   i < max_buf;   i++, p += 30) {
-    UV c = sieve[i];
-    if (!(c &   1)) primes[pi++] = p+ 1;
-    if (!(c &   2)) primes[pi++] = p+ 7;
-    if (!(c &   4)) primes[pi++] = p+11;
-    if (!(c &   8)) primes[pi++] = p+13;
-    if (!(c &  16)) primes[pi++] = p+17;
-    if (!(c &  32)) primes[pi++] = p+19;
-    if (!(c &  64)) primes[pi++] = p+23;
-    if (!(c & 128)) primes[pi++] = p+29;
+    unsigned char s;
+    if ((i % sizeof(UV)) == 0) {
+      UV w;
+      while (i + sizeof(UV) <= max_buf) {
+        memcpy(&w, sieve + i, sizeof(UV));
+        if (w != UV_MAX) break;
+        i += sizeof(UV);  p += 30*sizeof(UV);
+      }
+      if (i >= max_buf) break;
+    }
+    for (s = ~sieve[i]; s != 0; s &= s-1)
+      primes[pi++] = p + lowbit30[s];
   }
   while (pi > 0 && primes[pi-1] > n) pi--;
   if (sieve != primary_sieve) Safefree(sieve);
@@ -83,6 +83,7 @@
 #endif
 
 #include "utility.h"
+#include "stats.h"
 
 /* DANAJ: Modify matrix code to do 64-bit-padded character arrays */
 typedef unsigned char* row_t;  /* row of an F2 matrix */
@@ -1029,7 +1030,7 @@ static int mainRoutine(
   unsigned long multiplier)
 {
     mpz_t A, B, C, D, Bdivp2, q, r, nsqrtdiv, temp, temp2, temp3, temp4;
-    int i, j, l, s, fact, span, min, nfactors, verbose;
+    int i, j, l, s, fact, span, min, nfactors, verbose, stopped = 0;
     unsigned long u1, p, reps, numRelations, M;
     unsigned long curves = 0;
     unsigned long npartials = 0;
@@ -1122,7 +1123,7 @@ static int mainRoutine(
 
     /* Compute first polynomial and adjustments */
 
-    while (relsFound < relSought)
+    while (relsFound < relSought && !stopped)
     {
         int polyindex;
         mpz_set_ui(A,1);
@@ -1304,6 +1305,7 @@ static int mainRoutine(
               &npartials, &relsFound, &relSought,
               temp, temp2, temp3, temp4
            );
+           if (budget_expired()) { stopped = 1; break; }
         }
 
 #ifdef COUNT
@@ -1347,6 +1349,20 @@ static int mainRoutine(
     mpz_clear(q);  mpz_clear(r);
     mpz_clear(Bdivp2); mpz_clear(nsqrtdiv);
 
+    if (stopped) {
+      /* Out of time.  Skip the linear algebra, and return just n. */
+      if (verbose>3) printf("# qs stopped with %lu relations\n", relsFound);
+      mpz_div_ui(n,n,multiplier);
+      mpz_set(farray[0], n);
+      destroyMat(m, relSought);
+      Safefree(relations);
+      for (i = 0; i < (int)relsFound; i++)
+        mpz_clear(XArr[i]);
+      Safefree(XArr);
+      mpz_clear(temp);  mpz_clear(temp2);  mpz_clear(temp3);  mpz_clear(temp4);
+      return 1;
+    }
+
     /* Do the matrix algebra step */
 
     numRelations = gaussReduce(m, numPrimes, relSought);
@@ -1418,7 +1434,7 @@ static int mainRoutine(
     return nfactors;
 }
 
-int _GMP_simpqs(mpz_t n, mpz_t* farray)
+static int _simpqs(mpz_t n, mpz_t* farray)
 {
   unsigned long numPrimes, Mdiv2, multiplier, decdigits, relSought;
   int result = 0;
@@ -1507,6 +1523,16 @@ int _GMP_simpqs(mpz_t n, mpz_t* farray)
   return result;
 }
 
+int _GMP_simpqs(mpz_t n, mpz_t* farray)
+{
+  stats_timer_t st;
+  int nfactors;
+  stats_begin(&st, STATS_QS, n, 0, 0, 0);
+  nfactors = _simpqs(n, farray);
+  stats_end(&st, nfactors > 1, 0);
+  return nfactors;
+}
+
 #ifdef STANDALONE_SIMPQS
 /*===========================================================================
    Main Program:
@@ -0,0 +1,103 @@
+/*
+ * Instrumentation: events and per-method counters for the factoring and
+ * proving methods.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+  #include <time.h>
+#else
+  #include <sys/time.h>
+#endif
+#include <gmp.h>
+
+#include "ptypes.h"
+#include "stats.h"
+
+static const char* _method_names[STATS_NMETHODS] = {
+  "prho", "pbrent", "pminus1", "pplus1", "holf", "squfof",
+  "ecm", "qs", "bls75", "ecpp", "aks"
+};
+
+static stats_counter_t  _counters[STATS_NMETHODS];
+static stats_callback_t _callback = 0;
+static void*            _callback_data = 0;
+
+static double _stats_now(void)
+{
+#ifdef _WIN32
+  return (double)clock() / CLOCKS_PER_SEC;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+#endif
+}
+
+void stats_set_callback(stats_callback_t cb, void* data)
+{
+  _callback = cb;
+  _callback_data = data;
+}
+
+const char* stats_method_name(int method)
+{
+  return (method >= 0 && method < STATS_NMETHODS) ? _method_names[method] : 0;
+}
+
+void stats_get_counter(int method, stats_counter_t* counter)
+{
+  if (method < 0 || method >= STATS_NMETHODS)
+    croak("stats_get_counter: invalid method %d", method);
+  *counter = _counters[method];
+}
+
+void stats_reset(void)
+{
+  int i;
+  for (i = 0; i < STATS_NMETHODS; i++) {
+    _counters[i].calls = 0;
+    _counters[i].successes = 0;
+    _counters[i].seconds = 0.0;
+  }
+}
+
+static void _stats_event(stats_timer_t* st, int type, double seconds,
+                         int success, UV fbits)
+{
+  stats_event_t ev;
+  ev.method   = st->method;
+  ev.type     = type;
+  ev.nbits    = st->nbits;
+  ev.param[0] = st->param[0];
+  ev.param[1] = st->param[1];
+  ev.param[2] = st->param[2];
+  ev.seconds  = seconds;
+  ev.success  = success;
+  ev.fbits    = fbits;
+  (*_callback)(&ev, _callback_data);
+}
+
+void stats_begin(stats_timer_t* st, int method, mpz_t n, UV p0, UV p1, UV p2)
+{
+  st->method = method;
+  st->nbits = mpz_sizeinbase(n, 2);
+  st->param[0] = p0;  st->param[1] = p1;  st->param[2] = p2;
+  if (_callback)
+    _stats_event(st, STATS_EVENT_START, 0.0, 0, 0);
+  st->start = _stats_now();
+}
+
+void stats_end(stats_timer_t* st, int success, mpz_t f)
+{
+  double seconds = _stats_now() - st->start;
+  stats_counter_t* c = _counters + st->method;
+  if (seconds < 0) seconds = 0;
+  c->calls++;
+  if (success) c->successes++;
+  c->seconds += seconds;
+  if (_callback)
+    _stats_event(st, STATS_EVENT_END, seconds, success,
+                 (success && f) ? mpz_sizeinbase(f, 2) : 0);
+}
@@ -0,0 +1,70 @@
+#ifndef MPU_STATS_H
+#define MPU_STATS_H
+
+#include <gmp.h>
+#include "ptypes.h"
+
+/* Instrumentation for the factoring and proving methods.
+ *
+ * Each instrumented call sends a start and an end event to an optional
+ * callback, and the end event is added to per-method counters.  For the
+ * factoring methods success means a factor was found.  For the proving
+ * methods it means a definite answer (proven prime or composite).
+ *
+ * None of this is thread safe.
+ */
+
+enum {
+  STATS_PRHO,
+  STATS_PBRENT,
+  STATS_PMINUS1,
+  STATS_PPLUS1,
+  STATS_HOLF,
+  STATS_SQUFOF,
+  STATS_ECM,
+  STATS_QS,
+  STATS_BLS75,
+  STATS_ECPP,
+  STATS_AKS,
+  STATS_NMETHODS
+};
+
+#define STATS_EVENT_START  0
+#define STATS_EVENT_END    1
+
+typedef struct {
+  int    method;
+  int    type;          /* STATS_EVENT_START or STATS_EVENT_END */
+  UV     nbits;         /* size of the input */
+  UV     param[3];      /* method parameters, e.g. B1, B2, curves */
+  double seconds;       /* elapsed time (end only) */
+  int    success;       /* (end only) */
+  UV     fbits;         /* size of the factor found (end only) */
+} stats_event_t;
+
+typedef struct {
+  UV     calls;
+  UV     successes;
+  double seconds;
+} stats_counter_t;
+
+typedef void (*stats_callback_t)(const stats_event_t* ev, void* data);
+
+/* Set or clear (cb = 0) the event callback */
+extern void stats_set_callback(stats_callback_t cb, void* data);
+extern const char* stats_method_name(int method);
+extern void stats_get_counter(int method, stats_counter_t* counter);
+extern void stats_reset(void);
+
+/* Used by the instrumented methods */
+typedef struct {
+  int    method;
+  UV     nbits;
+  UV     param[3];
+  double start;
+} stats_timer_t;
+extern void stats_begin(stats_timer_t* st, int method, mpz_t n,
+                        UV p0, UV p1, UV p2);
+extern void stats_end(stats_timer_t* st, int success, mpz_t f);
+
+#endif
@@ -4,8 +4,9 @@ use warnings;
 
 use Test::More;
 use Math::Prime::Util::GMP qw/next_prime prev_prime/;
+use Math::BigInt;
 
-plan tests => 2 + 3*2 + 6 + 1 + 148 + 148 + 1 + 2;
+plan tests => 2 + 3*2 + 6 + 1 + 148 + 148 + 1 + 2 + 2;
 
 my @small_primes = qw/
 2 3 5 7 11 13 17 19 23 29 31 37 41 43 47 53 59 61 67 71 73 79 83 89 97
@@ -88,3 +89,12 @@ is( next_prime('87567547898934657346596012842304861297462937562349058673456'),
 is( prev_prime('1353175074828899034888345292712068768032725991919855436631156'),
                '1353175074828899034888345292712068768032725991919855436630917',
     "prev_prime(1353....31156) = 1353....30917");
+
+{
+  # Large enough that the survivors are tested in parallel
+  my $two2000 = Math::BigInt->new(2) ** 2000;
+  Math::Prime::Util::GMP::_GMP_set_threads(3);
+  is( next_prime("$two2000"), $two2000 + 841, "next_prime(2^2000) with threads" );
+  is( prev_prime("$two2000"), $two2000 - 2217, "prev_prime(2^2000) with threads" );
+  Math::Prime::Util::GMP::_GMP_set_threads(1);
+}
@@ -4,7 +4,10 @@ use warnings;
 
 use Test::More;
 use Math::Prime::Util::GMP qw/is_provable_prime is_provable_prime_with_cert
-                              is_aks_prime is_nminus1_prime is_ecpp_prime/;
+                              is_aks_prime is_nminus1_prime is_nplus1_prime
+                              is_ecpp_prime
+                              prove_nminus1 prove_nplus1 primes primorial/;
+use Math::BigInt;
 
 plan tests => 0 + 6
                 + 38
@@ -12,7 +15,9 @@ plan tests => 0 + 6
                 + 34
                 + 2
                 + 7   # _with_cert
-                + 3   # AKS, N-1, ECPP
+                + 2   # racing provers
+                + 6   # known n-1 and n+1 factors
+                + 5   # AKS, N-1, N+1, ECPP
                 + 0;
 
 is(is_provable_prime(2) , 2,  '2 is prime');
@@ -174,6 +179,35 @@ if ($cert =~ /\bType BLS5\b/) {
   like($cert, qr/\nType BLS15\nN  3138550867693340381917894711603833208051177722232017256453\nQ  120713494911282322381457488907839738771199143162769894479\nLP 1\nLQ 6\n\n/, "is_provable_prime_with_cert(3138550867693340381917894711603833208051177722232017256453)");
 }
 
+{
+  # With more than one worker, BLS75 n-1 and ECPP race
+  my $p96 = "1" . ("0" x 92) . "151";
+  Math::Prime::Util::GMP::_GMP_set_threads(2);
+  my($isp96, $cert96) = is_provable_prime_with_cert($p96);
+  is($isp96, 2, "is_provable_prime_with_cert(10^95+151) with racing provers");
+  like($cert96, qr/\nN $p96\n/, "certificate from the winning prover");
+  Math::Prime::Util::GMP::_GMP_set_threads(1);
+}
+
+{
+  # Primes dividing n-1 or n+1 known from the form of n
+  my @p = grep { $_ <= 1021 } @{primes(1033)};
+  my $pp = Math::BigInt->new(primorial(1021))->binc;
+  my($isp, $cert) = prove_nminus1("$pp", @p);
+  is($isp, 2, "prove_nminus1(1021#+1)");
+  like($cert, qr/\nType BLS5\nN  $pp\n/, "1021#+1 has a BLS5 certificate");
+  my $pm = Math::BigInt->new(primorial(991))->bdec;
+  ($isp, $cert) = prove_nplus1("$pm", grep { $_ <= 991 } @p);
+  is($isp, 2, "prove_nplus1(991#-1)");
+  like($cert, qr/\nType NP1\nN  $pm\nD  -?\d+\n/, "991#-1 has an NP1 certificate");
+  is((prove_nminus1("72312211991654562399388294155352317113499134720225677588561921", 2))[0],
+     2, "prove_nminus1(45*2^200+1) with only the factor 2");
+  ($isp, $cert) = prove_nplus1("5070602400912917605986812874043",
+                               "1267650600228229401496703218511");
+  like($cert, qr/\nType BLS15\nN  5070602400912917605986812874043\nQ  1267650600228229401496703218511\n/,
+       "prove_nplus1 with a large factor gives a BLS15 certificate");
+}
+
 
 # Individual routines
 # AKS.  Sigh, so freaking slow.  2/3 of the time for the whole suite is here.
@@ -182,5 +216,9 @@ ok( is_aks_prime(74017), "is_aks_prime(74017)" );
 # BLS75 n-1
 ok( is_nminus1_prime("340282366920938463463374607431768211507"), "is_nminus1_prime(340282366920938463463374607431768211507)" );
 
+# BLS75 n+1
+ok( is_nplus1_prime("170141183460469231731687303715884105727"), "is_nplus1_prime(2^127-1)" );
+is( is_nplus1_prime("170141183460469231731687303715884105729"), 0, "is_nplus1_prime(2^127+1) is composite" );
+
 # ECPP
 ok( is_ecpp_prime("340282366920938463463374607431768211507"), "is_ecpp_prime(340282366920938463463374607431768211507)" );
@@ -13,7 +13,7 @@ use Math::Prime::Util::GMP qw/
    is_frobenius_pseudoprime
    is_perrin_pseudoprime
    is_prime
-   lucas_sequence lucasu lucasv
+   lucas_sequence lucasu lucasv lucasumod lucasvmod
    miller_rabin_random
    primes/;
 my $extra = defined $ENV{EXTENDED_TESTING} && $ENV{EXTENDED_TESTING};
@@ -92,10 +92,13 @@ my %lucas_sequences = (
   "323 5 -1 81" => [153,195,322],
   "49001 25 117 24501" => [20933,18744,19141],
   "18971 10001 -1 4743" => [5866,14421,18970],
+  "1000003 3 1 2" => [3,7,1],
+  "1000003 3 1 3" => [8,18,1],
+  "1000003 4 1 5" => [209,724,1],
 );
 
 
-plan tests => 0 + 9
+plan tests => 0 + 10
                 + 3
                 + 6
                 + $num_pseudoprimes
@@ -104,6 +107,7 @@ plan tests => 0 + 9
                 + scalar @small_lucas_trials
                 + scalar(keys %lucas_sequences)
                 + 7  # lucasu lucasv
+                + 3  # lucasumod lucasvmod
               # + $num_large_pseudoprime_tests
                 + 12*$extra  # Large Carmichael numbers
                 + 2 # M-R-random
@@ -119,6 +123,10 @@ eval { is_strong_pseudoprime(2047,0); };
 like($@, qr/invalid/i, "is_strong_pseudoprime with base 0 fails");
 eval { is_strong_pseudoprime(2047,1); };
 like($@, qr/invalid/i, "is_strong_pseudoprime with base 1 fails");
+# A croak with several bases must not leak scratch temporaries
+eval { is_strong_pseudoprime(1000003, 2, 1); } for 1 .. 5000;
+is( is_prime("1000000000000000000000000000057"), 2,
+    "is_prime after 5000 failed is_strong_pseudoprime calls" );
 eval { is_strong_pseudoprime(2047,-7); };
 like($@, qr/positive/i, "is_strong_pseudoprime with base -7 fails");
 eval { is_strong_pseudoprime(undef, 2); };
@@ -237,6 +245,15 @@ while (my($params, $expect) = each (%lucas_sequences)) {
   substr($str, 15, -15, "...");
   is( $str, "580334188745259...957502147624960", "lucasv(10,8,88321)" );
 }
+{
+  is_deeply( [lucasumod(4,5,323, 324,81,0,1,2)], [194,188,0,1,4],
+             "lucasumod(4,5,323, ...)" );
+  is_deeply( [lucasvmod(5,-1,1000, 81,0,324,17)], [780,2,602,335],
+             "lucasvmod with even modulus" );
+  is_deeply( [lucasumod(1,-1,"1000000007", 1001, 1000, 1002)],
+             [107579939,517691607,625271546],
+             "Fibonacci(1000 .. 1002) mod 1000000007" );
+}
 
 if ($extra) {
   my $n;
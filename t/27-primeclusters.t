@@ -0,0 +1,36 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+
+use Test::More;
+use Math::Prime::Util::GMP qw/sieve_prime_cluster sieve_cunningham_chain/;
+
+my @twins = (3,5,11,17,29,41,59,71,101,107,137,149,179,191,197);
+my @quads = (5,11,101,191,821,1481,1871,2081,3251,3461);         # A007530
+my @cc1   = (2,5,89,179,359,509,1229,1409,2699,3539,6449,10589,11549,11909);
+my @cc2   = (1531,2131,2311,3061,6211,6841,7411,10321,13681,15391,16651,18121);
+my @bigtwins = map { "10000000000000000$_" }
+               qw/0391 0559 4237 5611 5779 8119/;
+
+plan tests => 8;
+
+is_deeply( [sieve_prime_cluster(0, 200, 2)], \@twins, "twin primes to 200" );
+is_deeply( [sieve_prime_cluster(0, 3500, 2, 6, 8)], \@quads,
+           "prime quadruplets to 3500" );
+is_deeply( [sieve_prime_cluster(0, 100, 2, 4)], [3],
+           "n, n+2, n+4 only at 3" );
+is_deeply( [sieve_prime_cluster("100000000000000000000",
+                                "100000000000000010000", 2)], \@bigtwins,
+           "twin primes from 10^20 to 10^20+10000" );
+is_deeply( [sieve_prime_cluster("100000000000000000000",
+                                "100000000000000010000", 2, 6)], [],
+           "no n, n+2, n+6 from 10^20 to 10^20+10000" );
+Math::Prime::Util::GMP::_GMP_set_threads(3);
+is_deeply( [sieve_prime_cluster(0, 3500, 2, 6, 8)], \@quads,
+           "prime quadruplets to 3500 with threads" );
+Math::Prime::Util::GMP::_GMP_set_threads(1);
+
+is_deeply( [sieve_cunningham_chain(0, 12000, 4)], \@cc1,
+           "Cunningham chains of the first kind, length 4, to 12000" );
+is_deeply( [sieve_cunningham_chain(0, 20000, 4, 2)], \@cc2,
+           "Cunningham chains of the second kind, length 4, to 20000" );
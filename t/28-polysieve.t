@@ -0,0 +1,40 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+
+use Test::More;
+use Math::Prime::Util::GMP qw/sieve_polynomial primes_in_ap/;
+
+my @sq1  = (1,2,4,6,10,14,16,20,24,26,36,40,54,56,66,74,84,90,94); # A005574
+my @cub2 = (1,3,5,29,45,63,65,69,71,83,105,113,123,129,143,153,171,173,189);
+my @k100 = (24,77,128,132,162,195);        # k*2^100-1 prime
+
+plan tests => 7 + 4;
+
+is_deeply( [sieve_polynomial(0, 100, 1, 0, 1)], \@sq1, "n^2+1 prime to 100" );
+is_deeply( [sieve_polynomial(1, 200, 1, 0, 0, 2)], \@cub2,
+           "n^3+2 prime to 200" );
+is_deeply( [sieve_polynomial(0, 39, 1, 1, 41)], [0..39],
+           "Euler's n^2+n+41 for n < 40" );
+is_deeply( [sieve_polynomial(0, 1000, 1, 0, -1)], [2],
+           "n^2-1 is prime only at 2" );
+is_deeply( [sieve_polynomial(1, 200, "1267650600228229401496703205376", -1)],
+           \@k100, "k*2^100-1 for k to 200" );
+my @big = sieve_polynomial("1000000000000000000000000000000",
+                           "1000000000000000000000000002000", 1, 0, 0, 0, 1);
+is( scalar(@big), 28, "n^4+1 prime for 28 n from 10^30 to 10^30+2000" );
+Math::Prime::Util::GMP::_GMP_set_threads(3);
+is_deeply( [sieve_polynomial(0, 100, 1, 0, 1)], \@sq1,
+           "n^2+1 prime to 100 with threads" );
+Math::Prime::Util::GMP::_GMP_set_threads(1);
+
+is_deeply( [primes_in_ap(1, 4, 0, 100)],
+           [5,13,17,29,37,41,53,61,73,89,97], "primes 1 mod 4 to 100" );
+is_deeply( [primes_in_ap(5, 3, 0, 30)], [2,5,11,17,23,29],
+           "primes 2 mod 3 to 30, a reduced mod d" );
+is_deeply( [primes_in_ap(0, 7, 0, 100)], [7], "primes 0 mod 7" );
+is_deeply( [primes_in_ap(17, 30030, "18446744073709551616",
+                                    "18446744073710551616")],
+           [qw/18446744073709581647 18446744073709761827 18446744073709972037
+               18446744073710482547 18446744073710512577/],
+           "primes 17 mod 30030 from 2^64 to 2^64+10^6" );
@@ -11,6 +11,7 @@ plan tests => 0 + 57
                 + 6    # individual tets for factoring methods
                 + 7*7  # factor extra tests
                 + 8    # factor in scalar context
+                + 3    # method statistics
                 + 0;
 
 # On a 64-bit machine, put all 32-bit nums in /tmp/foo, 64-bit in /tmp/foo2
@@ -163,3 +164,15 @@ is( scalar factor(5), 1, "scalar factor(5) should be 1" );
 is( scalar factor(6), 2, "scalar factor(6) should be 2" );
 is( scalar factor(30107), 4, "scalar factor(30107) should be 4" );
 is( scalar factor(174636000), 15, "scalar factor(174636000) should be 15" );
+
+# Method statistics
+{
+  Math::Prime::Util::GMP::reset_stats();
+  Math::Prime::Util::GMP::pbrent_factor('1754012594703269855671');
+  my $st = Math::Prime::Util::GMP::get_stats();
+  ok( $st->{pbrent}{calls} >= 1 && $st->{pbrent}{successes} >= 1,
+      "get_stats counts pbrent calls and successes" );
+  ok( $st->{ecm}{calls} == 0, "get_stats has no ecm calls" );
+  Math::Prime::Util::GMP::reset_stats();
+  is( Math::Prime::Util::GMP::get_stats()->{pbrent}{calls}, 0, "reset_stats clears counters" );
+}
@@ -5,9 +5,20 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#ifdef _WIN32
+  #include <time.h>
+#else
+  #include <sys/time.h>
+#endif
 #include <gmp.h>
 
 #include "ptypes.h"
+#ifdef USE_PTHREADS
+  #include <pthread.h>
+#endif
 
 /* includes mpz_mulmod(r, a, b, n, temp) */
 #include "utility.h"
@@ -24,6 +35,193 @@ void init_randstate(unsigned long seed) {
 }
 void clear_randstate(void) {  gmp_randclear(_randstate);  }
 
+static double _budget_deadline = 0;
+static volatile sig_atomic_t _budget_cancelled = 0;
+static int _budget_stopped = 0;
+static double _budget_now(void)
+{
+#ifdef _WIN32
+  return (double)clock() / CLOCKS_PER_SEC;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+#endif
+}
+void budget_set(double seconds) {
+  _budget_deadline = (seconds > 0) ? _budget_now() + seconds : 0;
+  _budget_cancelled = 0;
+  _budget_stopped = 0;
+}
+void budget_cancel(void) { _budget_cancelled = 1; }
+int budget_expired(void) {
+  if (!_budget_cancelled) {
+    if (_budget_deadline == 0 || _budget_now() < _budget_deadline)
+      return 0;
+    _budget_cancelled = 1;
+  }
+  _budget_stopped = 1;
+  return 1;
+}
+int budget_stopped(void) { return _budget_stopped; }
+
+static int _nthreads = 1;
+int get_thread_count(void) { return _nthreads; }
+void set_thread_count(int nthreads) { _nthreads = (nthreads < 1) ? 1 : nthreads; }
+
+
+/* Scratch stack.  Entries live in fixed chunks so pointers stay valid as
+ * the stack grows.  A temporary that grew very large is shrunk when it is
+ * released so one big computation doesn't pin its memory.
+ * run_parallel's threads use this through _GMP_BPSW, and have no Perl
+ * interpreter, so it takes memory with plain malloc and never croaks.  Like
+ * GMP itself, it aborts if it can't allocate. */
+#define SCRATCH_CHUNK      64
+#define SCRATCH_KEEP_BITS 32768
+
+/* With threads, each thread has its own stack.  A compiler without thread
+ * local storage gets one shared stack, and run_parallel runs serially. */
+#if !defined(USE_PTHREADS)
+  #define SCRATCH_LOCAL static
+#elif defined(__GNUC__)
+  #define SCRATCH_LOCAL static __thread
+#elif defined(_MSC_VER)
+  #define SCRATCH_LOCAL static __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define SCRATCH_LOCAL static _Thread_local
+#else
+  #define SCRATCH_LOCAL static
+  #define SCRATCH_SHARED
+#endif
+SCRATCH_LOCAL __mpz_struct** _scratch = 0;
+SCRATCH_LOCAL UV _scratch_nchunks = 0;  /* size of the _scratch table */
+SCRATCH_LOCAL UV _scratch_top = 0;     /* next entry to hand out */
+SCRATCH_LOCAL UV _scratch_inited = 0;  /* entries that have been mpz_init'd */
+
+UV scratch_mark(void) { return _scratch_top; }
+
+static void* _scratch_alloc(void* p, size_t size)
+{
+  p = realloc(p, size);
+  if (p == 0) {
+    fprintf(stderr, "scratch mpz stack: out of memory\n");
+    abort();
+  }
+  return p;
+}
+
+mpz_ptr scratch_mpz(UV bits)
+{
+  UV i = _scratch_top;
+  mpz_ptr z;
+  if (i >= _scratch_inited) {
+    if (i % SCRATCH_CHUNK == 0) {
+      if (i / SCRATCH_CHUNK >= _scratch_nchunks) {
+        _scratch_nchunks = (_scratch_nchunks == 0) ? 16 : 2*_scratch_nchunks;
+        _scratch = (__mpz_struct**) _scratch_alloc(_scratch,
+                               _scratch_nchunks * sizeof(__mpz_struct*));
+      }
+      _scratch[i / SCRATCH_CHUNK] = (__mpz_struct*) _scratch_alloc(0,
+                               SCRATCH_CHUNK * sizeof(__mpz_struct));
+    }
+    z = _scratch[i / SCRATCH_CHUNK] + (i % SCRATCH_CHUNK);
+    mpz_init2(z, bits);
+    _scratch_inited++;
+  } else {
+    z = _scratch[i / SCRATCH_CHUNK] + (i % SCRATCH_CHUNK);
+    if ((UV)z->_mp_alloc * GMP_NUMB_BITS < bits)
+      mpz_realloc2(z, bits);
+    mpz_set_ui(z, 0);
+  }
+  _scratch_top++;
+  return z;
+}
+
+void scratch_release(UV mark)
+{
+  MPUassert(mark <= _scratch_top, "scratch_release: bad mark");
+  while (_scratch_top > mark) {
+    mpz_ptr z;
+    _scratch_top--;
+    z = _scratch[_scratch_top / SCRATCH_CHUNK] + (_scratch_top % SCRATCH_CHUNK);
+    if ((UV)z->_mp_alloc * GMP_NUMB_BITS > SCRATCH_KEEP_BITS)
+      mpz_realloc2(z, 64);
+  }
+}
+
+void scratch_free(void)
+{
+  UV i;
+  for (i = 0; i < _scratch_inited; i++)
+    mpz_clear(_scratch[i / SCRATCH_CHUNK] + (i % SCRATCH_CHUNK));
+  for (i = 0; i < _scratch_inited; i += SCRATCH_CHUNK)
+    free(_scratch[i / SCRATCH_CHUNK]);
+  free(_scratch);
+  _scratch = 0;
+  _scratch_nchunks = 0;
+  _scratch_top = _scratch_inited = 0;
+}
+
+#if defined(USE_PTHREADS) && !defined(SCRATCH_SHARED)
+typedef struct {
+  void (*fn)(void*);
+  char* args;
+  size_t argsize;
+  int njobs;
+  int next;
+  pthread_mutex_t lock;
+} parallel_queue_t;
+
+static void* _parallel_worker(void* vq)
+{
+  parallel_queue_t* q = (parallel_queue_t*) vq;
+  while (1) {
+    int i;
+    pthread_mutex_lock(&q->lock);
+    i = q->next++;
+    pthread_mutex_unlock(&q->lock);
+    if (i >= q->njobs) break;
+    q->fn(q->args + (size_t)i * q->argsize);
+  }
+  return 0;
+}
+static void* _parallel_thread(void* vq)
+{
+  (void) _parallel_worker(vq);
+  scratch_free();               /* this thread's scratch temporaries */
+  return 0;
+}
+#endif
+
+void run_parallel(void (*fn)(void*), void* args, size_t argsize, int njobs)
+{
+  int i;
+#if defined(USE_PTHREADS) && !defined(SCRATCH_SHARED)
+  int nthreads = (_nthreads < njobs) ? _nthreads : njobs;
+  if (nthreads > 1) {
+    parallel_queue_t q;
+    pthread_t* tids;
+    int nstarted = 0;
+    q.fn = fn;  q.args = (char*) args;  q.argsize = argsize;
+    q.njobs = njobs;  q.next = 0;
+    pthread_mutex_init(&q.lock, 0);
+    New(0, tids, nthreads-1, pthread_t);
+    /* If a thread can't be created, the remaining ones pick up the work. */
+    for (i = 0; i < nthreads-1; i++)
+      if (pthread_create(&tids[nstarted], 0, _parallel_thread, &q) == 0)
+        nstarted++;
+    (void) _parallel_worker(&q);
+    for (i = 0; i < nstarted; i++)
+      pthread_join(tids[i], 0);
+    Safefree(tids);
+    pthread_mutex_destroy(&q.lock);
+    return;
+  }
+#endif
+  for (i = 0; i < njobs; i++)
+    fn((char*)args + (size_t)i * argsize);
+}
+
 
 int mpz_divmod(mpz_t r, mpz_t a, mpz_t b, mpz_t n, mpz_t t)
 {
@@ -44,6 +242,103 @@ static int verify_sqrt(mpz_t x, mpz_t a, mpz_t p, mpz_t t, mpz_t t2) {
   return 0;
 }
 
+/* Tonelli-Shanks after the non-residue is known.  p-1 = q*2^e with q odd,
+ * z is a primitive 2^e-th root of unity (c^q for a non-residue c), and if
+ * zpow is not null then zpow[i] = z^(2^i).  One exponentiation is shared
+ * by x = a^((q+1)/2) and b = a^q.  Returns 0 if a is not a square. */
+static int _sqrtmod_ts(mpz_t x, mpz_t a, mpz_t p, mpz_t q, int e,
+                       mpz_t z, mpz_t* zpow, mpz_t t, mpz_t b, mpz_t y)
+{
+  int r, m, i;
+
+  mpz_sub_ui(t, q, 1);
+  mpz_tdiv_q_2exp(t, t, 1);
+  mpz_powm(y, a, t, p);                 /* y = a^((q-1)/2) */
+  mpz_mulmod(x, a, y, p, t);            /* x = a^((q+1)/2) */
+  mpz_mulmod(b, x, y, p, t);            /* b = a^q */
+  if (zpow == 0) mpz_set(y, z);         /* y = z^(2^(e-r)) */
+  r = e;
+
+  while (mpz_cmp_ui(b, 1)) {
+    /* least m with b^(2^m) = 1 */
+    mpz_set(t, b);
+    m = 0;
+    do {
+      mpz_mulmod(t, t, t, p, t);
+      m++;
+    } while (m < r && mpz_cmp_ui(t, 1));
+    if (m == r) return 0;
+    if (zpow) {
+      mpz_mulmod(x, x, zpow[e-m-1], p, t);
+      mpz_mulmod(b, b, zpow[e-m], p, t);
+    } else {
+      for (i = 0; i < r-m-1; i++)
+        mpz_mulmod(y, y, y, p, t);
+      mpz_mulmod(x, x, y, p, t);
+      mpz_mulmod(y, y, y, p, t);
+      mpz_mulmod(b, b, y, p, t);
+    }
+    r = m;
+  }
+  return 1;
+}
+
+/* Cipolla's method, computed as V_{(p+1)/2}(2t, a) / 2 where t^2-a is a
+ * non-residue.  About 3 multiplies per bit regardless of the 2-adic
+ * valuation of p-1, so it wins when Tonelli-Shanks would need O(e^2). */
+static int _sqrtmod_cipolla(mpz_t x, mpz_t a, mpz_t p)
+{
+  UV t, P;
+  long bit;
+  mpz_t Q, k, V, V1, Qk, w;
+
+  mpz_init(Q);  mpz_init(k);  mpz_init(V);  mpz_init(V1);
+  mpz_init(Qk); mpz_init(w);
+  mpz_mod(Q, a, p);
+  for (t = 1; t < 100000; t++) {
+    mpz_set_ui(w, t);
+    mpz_mul_ui(w, w, t);
+    mpz_sub(w, w, Q);
+    if (mpz_jacobi(w, p) == -1) break;
+  }
+  if (t >= 100000) {
+    mpz_set_ui(x, 0);
+  } else {
+    P = 2*t;
+    mpz_add_ui(k, p, 1);
+    mpz_tdiv_q_2exp(k, k, 1);
+    mpz_set_ui(V, 2);  mpz_set_ui(V1, P);  mpz_set_ui(Qk, 1);
+    for (bit = mpz_sizeinbase(k, 2)-1; bit >= 0; bit--) {
+      mpz_mul(w, V, V1);
+      mpz_submul_ui(w, Qk, P);
+      if (mpz_tstbit(k, bit)) {
+        mpz_mod(V, w, p);
+        mpz_mul(V1, V1, V1);
+        mpz_mul(w, Qk, Q);
+        mpz_submul_ui(V1, w, 2);
+        mpz_mod(V1, V1, p);
+        mpz_mul(Qk, Qk, w);
+      } else {
+        mpz_mod(V1, w, p);
+        mpz_mul(V, V, V);
+        mpz_submul_ui(V, Qk, 2);
+        mpz_mod(V, V, p);
+        mpz_mul(Qk, Qk, Qk);
+      }
+      mpz_mod(Qk, Qk, p);
+    }
+    /* x = V/2 */
+    if (mpz_odd_p(V)) mpz_add(V, V, p);
+    mpz_tdiv_q_2exp(x, V, 1);
+  }
+  mpz_clear(Q);  mpz_clear(k);  mpz_clear(V);  mpz_clear(V1);
+  mpz_clear(Qk); mpz_clear(w);
+  return mpz_sgn(x) != 0;
+}
+
+/* Use Cipolla rather than Tonelli-Shanks when e^2 is large vs. log2(p). */
+#define SQRTMOD_USE_CIPOLLA(e, p)  ((UV)(e)*(e) > 12*mpz_sizeinbase(p,2))
+
 /* set x to sqrt(a) mod p.  Returns 0 if a is not a square root mod p */
 /* See Cohen section 1.5.
  * See http://www.math.vt.edu/people/brown/doc/sqrts.pdf
@@ -51,7 +346,8 @@ static int verify_sqrt(mpz_t x, mpz_t a, mpz_t p, mpz_t t, mpz_t t2) {
 int sqrtmod(mpz_t x, mpz_t a, mpz_t p,
             mpz_t t, mpz_t q, mpz_t b, mpz_t z) /* 4 temp variables */
 {
-  int r, e, m;
+  int e;
+  UV c;
 
   /* Easy cases from page 31 (or Menezes 3.36, 3.37) */
   if (mpz_congruent_ui_p(p, 3, 4)) {
@@ -93,35 +389,192 @@ int sqrtmod(mpz_t x, mpz_t a, mpz_t p,
 
   mpz_sub_ui(q, p, 1);
   e = mpz_scan1(q, 0);              /* Remove 2^e from q */
+  if (SQRTMOD_USE_CIPOLLA(e, p)) {
+    _sqrtmod_cipolla(x, a, p);
+    return verify_sqrt(x, a, p, t, q);
+  }
   mpz_tdiv_q_2exp(q, q, e);
-  mpz_set_ui(t, 2);
-  while (mpz_legendre(t, p) != -1)  /* choose t "at random" */
-    mpz_add_ui(t, t, 1);
-  mpz_powm(z, t, q, p);                     /* Step 1 complete */
-  r = e;
+  for (c = 2; c < 100000; c++)      /* choose c "at random" */
+    if (mpz_ui_kronecker(c, p) == -1)
+      break;
+  mpz_set_ui(t, c);
+  mpz_powm(z, t, q, p);
+  _sqrtmod_ts(x, a, p, q, e, z, 0, t, b, q);
+  return verify_sqrt(x, a, p, t, q);
+}
 
-  mpz_powm(b, a, q, p);
-  mpz_add_ui(q, q, 1);
-  mpz_divexact_ui(q, q, 2);
-  mpz_powm(x, a, q, p);   /* Done with q, will use it for y now */
+/* Square roots modulo a fixed odd prime p.  The non-residue, the 2^e-th
+ * roots of unity, and the roots of small integers are computed once. */
+void sqrtmod_ctx_init(sqrtmod_ctx_t* ctx, mpz_t p)
+{
+  int i;
+  UV c;
+
+  mpz_init_set(ctx->p, p);
+  mpz_init(ctx->q);
+  mpz_init(ctx->c);   mpz_init(ctx->cinv);
+  mpz_init(ctx->t1);  mpz_init(ctx->t2);  mpz_init(ctx->t3);  mpz_init(ctx->t4);
+  mpz_init(ctx->t5);
+  mpz_sub_ui(ctx->q, p, 1);
+  ctx->e = mpz_scan1(ctx->q, 0);
+  mpz_tdiv_q_2exp(ctx->q, ctx->q, ctx->e);
+  ctx->zpow = 0;
+  ctx->cache = 0;
+  ctx->ncache = ctx->maxcache = 0;
+
+  for (c = 2; c < 100000; c++)
+    if (mpz_ui_kronecker(c, p) == -1)
+      break;
+  mpz_set_ui(ctx->c, c);
+  if (!mpz_invert(ctx->cinv, ctx->c, p))
+    mpz_set_ui(ctx->cinv, 0);
+
+  if (ctx->e > 2 && !SQRTMOD_USE_CIPOLLA(ctx->e, p)) {
+    New(0, ctx->zpow, ctx->e+1, mpz_t);
+    mpz_init(ctx->zpow[0]);
+    mpz_powm(ctx->zpow[0], ctx->c, ctx->q, p);
+    for (i = 1; i <= ctx->e; i++) {
+      mpz_init(ctx->zpow[i]);
+      mpz_mulmod(ctx->zpow[i], ctx->zpow[i-1], ctx->zpow[i-1], p, ctx->t1);
+    }
+  }
+}
 
-  while (mpz_cmp_ui(b, 1)) {
-    /* calculate how many times b^2 mod p == 1 */
-    mpz_set(t, b);
-    m = 0;
-    do {
-      mpz_powm_ui(t, t, 2, p);
-      m++;
-    } while (m < r && mpz_cmp_ui(t, 1));
-    if (m == r) break;
-    mpz_ui_pow_ui(t, 2, r-m-1);
-    mpz_powm(t, z, t, p);
-    mpz_mulmod(x, x, t, p, x);
-    mpz_powm_ui(z, t, 2, p);
-    mpz_mulmod(b, b, z, p, b);
-    r = m;
+void sqrtmod_ctx_destroy(sqrtmod_ctx_t* ctx)
+{
+  UV i;
+  if (ctx->zpow) {
+    for (i = 0; i <= (UV)ctx->e; i++)
+      mpz_clear(ctx->zpow[i]);
+    Safefree(ctx->zpow);
   }
-  return verify_sqrt(x, a, p, t, q);
+  for (i = 0; i < ctx->ncache; i++)
+    mpz_clear(ctx->cache[i].root);
+  if (ctx->cache) Safefree(ctx->cache);
+  mpz_clear(ctx->p);   mpz_clear(ctx->q);
+  mpz_clear(ctx->c);   mpz_clear(ctx->cinv);
+  mpz_clear(ctx->t1);  mpz_clear(ctx->t2);  mpz_clear(ctx->t3);  mpz_clear(ctx->t4);
+  mpz_clear(ctx->t5);
+}
+
+int sqrtmod_ctx(sqrtmod_ctx_t* ctx, mpz_t x, mpz_t a)
+{
+  mpz_mod(ctx->t4, a, ctx->p);
+  if (mpz_sgn(ctx->t4) == 0) {
+    mpz_set_ui(x, 0);
+    return 1;
+  }
+  if (ctx->zpow == 0)
+    return sqrtmod(x, ctx->t4, ctx->p, ctx->t1, ctx->t2, ctx->t3, ctx->t5);
+  if (_sqrtmod_ts(x, ctx->t4, ctx->p, ctx->q, ctx->e, ctx->zpow[0], ctx->zpow,
+                  ctx->t1, ctx->t2, ctx->t3))
+    return verify_sqrt(x, ctx->t4, ctx->p, ctx->t1, ctx->t2);
+  mpz_set_ui(x, 0);
+  return 0;
+}
+
+/* Find or add the cache entry for k (a small integer, or -1).  The entry
+ * holds sqrt(k) if k is a residue, otherwise sqrt(c*k) for the non-residue
+ * c, so products of entries can always be formed.  Returns 0 on failure,
+ * which can only happen if p is not prime. */
+static sqrtmod_cache_t* _sqrtmod_cache(sqrtmod_ctx_t* ctx, IV k)
+{
+  UV lo = 0, hi = ctx->ncache;
+  sqrtmod_cache_t* ent;
+
+  while (lo < hi) {
+    UV mid = lo + (hi-lo)/2;
+    if (ctx->cache[mid].k < k) lo = mid+1;
+    else                       hi = mid;
+  }
+  if (lo < ctx->ncache && ctx->cache[lo].k == k)
+    return ctx->cache + lo;
+
+  if (ctx->ncache == ctx->maxcache) {
+    ctx->maxcache = (ctx->maxcache == 0) ? 32 : 2*ctx->maxcache;
+    if (ctx->cache) Renew(ctx->cache, ctx->maxcache, sqrtmod_cache_t);
+    else            New(0, ctx->cache, ctx->maxcache, sqrtmod_cache_t);
+  }
+  /* Shift up to keep the cache sorted.  The mpz_t structs move as bytes. */
+  if (lo < ctx->ncache)
+    memmove(ctx->cache + lo + 1, ctx->cache + lo,
+            (ctx->ncache - lo) * sizeof(sqrtmod_cache_t));
+  ctx->ncache++;
+  ent = ctx->cache + lo;
+  ent->k = k;
+  mpz_init(ent->root);
+
+  if (k < 0) { mpz_set_si(ctx->t5, k);  mpz_mod(ctx->t5, ctx->t5, ctx->p); }
+  else       { mpz_set_ui(ctx->t5, k);  mpz_mod(ctx->t5, ctx->t5, ctx->p); }
+  ent->qnr = (mpz_jacobi(ctx->t5, ctx->p) == -1);
+  if (ent->qnr)
+    mpz_mul(ctx->t5, ctx->t5, ctx->c);
+  if (!sqrtmod_ctx(ctx, ent->root, ctx->t5))
+    return 0;
+  return ent;
+}
+
+/* x = sqrt(a) for a small signed integer a.  |a| is split over small
+ * primes, and the root of each prime is computed once per modulus. */
+int sqrtmod_ctx_si(sqrtmod_ctx_t* ctx, mpz_t x, IV a)
+{
+  UV n, f, k, nqnr = 0;
+  sqrtmod_cache_t* ent;
+
+  if (a == 0) { mpz_set_ui(x, 0); return 1; }
+  mpz_set_ui(x, 1);
+  n = (a < 0) ? -(UV)a : (UV)a;
+  if (a < 0) {
+    if ( (ent = _sqrtmod_cache(ctx, -1)) == 0 ) return 0;
+    mpz_mul(x, x, ent->root);
+    nqnr += ent->qnr;
+  }
+  for (f = 2; f < 65536 && f*f <= n; f += 1 + (f&1)) {
+    if (n % f) continue;
+    for (k = 0; n % f == 0; k++)
+      n /= f;
+    if (k >= 2) {
+      UV s = 1;
+      while (k >= 2) { s *= f; k -= 2; }
+      mpz_mul_ui(x, x, s);
+    }
+    if (k) {
+      if ( (ent = _sqrtmod_cache(ctx, f)) == 0 ) return 0;
+      mpz_mul(x, x, ent->root);
+      mpz_mod(x, x, ctx->p);
+      nqnr += ent->qnr;
+    }
+  }
+  if (n > 1) {
+    if ( (ent = _sqrtmod_cache(ctx, n)) == 0 ) return 0;
+    mpz_mul(x, x, ent->root);
+    nqnr += ent->qnr;
+  }
+  if (nqnr & 1) {   /* a is not a square */
+    mpz_set_ui(x, 0);
+    return 0;
+  }
+  /* Each pair of non-residue entries carries an extra factor of c. */
+  if (nqnr > 0) {
+    mpz_powm_ui(ctx->t5, ctx->cinv, nqnr/2, ctx->p);
+    mpz_mul(x, x, ctx->t5);
+  }
+  mpz_mod(x, x, ctx->p);
+  return 1;
+}
+
+/* x[i] = sqrt(a[i]) mod p for n small integers, with x[i] = 0 for those
+ * that aren't squares.  Returns the number of roots found. */
+UV sqrtmod_batch_si(mpz_t* x, IV* a, UV n, mpz_t p)
+{
+  sqrtmod_ctx_t ctx;
+  UV i, nfound = 0;
+
+  sqrtmod_ctx_init(&ctx, p);
+  for (i = 0; i < n; i++)
+    nfound += sqrtmod_ctx_si(&ctx, x[i], a[i]);
+  sqrtmod_ctx_destroy(&ctx);
+  return nfound;
 }
 
 /* Smith-Cornacchia: Solve x,y for x^2 + |D|y^2 = p given prime p */
@@ -165,42 +618,68 @@ int cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p)
   return result;
 }
 
-/* Modified Cornacchia, Solve x,y for x^2 + |D|y^2 = 4p given prime p */
-/* See Cohen 1.5.3 */
-int modified_cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p)
+/* Reduce (a,b) by Euclid until b <= c, for a > b.  While b is well above c
+ * we use Lehmer's method on the top bits, applying several steps at once
+ * with single precision cofactors.  Uses t and u as temporaries.
+ * The Lehmer step needs 64-bit IVs and a 64-bit long for mpz_get_ui and
+ * mpz_mul_si, so 32-bit and LLP64 builds do plain division steps. */
+#if BITS_PER_WORD == 64 && ULONG_MAX > 4294967295UL
+  #define EUCLID_LEHMER
+#endif
+static void _euclid_until(mpz_t a, mpz_t b, mpz_t c, mpz_t t, mpz_t u)
 {
-  int result = 0;
-  mpz_t a, b, c, d;
+#ifdef EUCLID_LEHMER
+  UV cbits = mpz_sizeinbase(c, 2);
+#endif
 
-  if (mpz_cmp_ui(p, 2) == 0) {
-    mpz_add_ui(x, D, 8);
-    if (mpz_perfect_square_p(x)) {
-      mpz_sqrt(x, x);
-      mpz_set_ui(y, 1);
-      result = 1;
+  while (mpz_cmp(b, c) > 0) {
+#ifdef EUCLID_LEHMER
+    UV bbits = mpz_sizeinbase(b, 2);
+    if (bbits > cbits + 64) {
+      /* Top 62 bits of a, and b with the same shift (Knuth 4.5.2 L) */
+      UV shift = mpz_sizeinbase(a, 2) - 62;
+      IV A = 1, B = 0, C = 0, D = 1, ah, bh, q, T;
+      mpz_tdiv_q_2exp(t, a, shift);  ah = (IV) mpz_get_ui(t);
+      mpz_tdiv_q_2exp(t, b, shift);  bh = (IV) mpz_get_ui(t);
+      while (bh + C != 0 && bh + D != 0) {
+        q = (ah + A) / (bh + C);
+        if (q != (ah + B) / (bh + D)) break;
+        T = A - q*C;  A = C;  C = T;
+        T = B - q*D;  B = D;  D = T;
+        T = ah - q*bh;  ah = bh;  bh = T;
+      }
+      if (B != 0) {
+        /* (a,b) = (A a + B b, C a + D b) */
+        mpz_mul_si(t, a, A);  mpz_mul_si(u, b, B);  mpz_add(t, t, u);
+        mpz_mul_si(u, a, C);  mpz_mul_si(a, b, D);  mpz_add(b, a, u);
+        mpz_swap(a, t);
+        continue;
+      }
     }
-    return result;
+#else
+    (void) u;
+#endif
+    mpz_tdiv_r(t, a, b);
+    mpz_swap(a, b);
+    mpz_swap(b, t);
   }
-  if (mpz_jacobi(D, p) == -1)     /* No solution */
-    return 0;
-
-  mpz_init(a); mpz_init(b); mpz_init(c); mpz_init(d);
+}
 
-  sqrtmod(x, D, p, a, b, c, d);
-  if ( (mpz_even_p(D) && mpz_odd_p(x)) || (mpz_odd_p(D) && mpz_even_p(x)) )
-    mpz_sub(x, p, x);
+/* Given r = sqrt(D) mod p, finish Cornacchia for x^2 + |D|y^2 = 4p */
+static int _modified_cornacchia_reduce(mpz_t x, mpz_t y, mpz_t D, mpz_t p,
+                                       mpz_t r, mpz_t a, mpz_t b, mpz_t c, mpz_t d)
+{
+  if ( (mpz_even_p(D) && mpz_odd_p(r)) || (mpz_odd_p(D) && mpz_even_p(r)) )
+    mpz_sub(b, p, r);
+  else
+    mpz_set(b, r);
 
   mpz_mul_ui(a, p, 2);
-  mpz_set(b, x);
   mpz_sqrt(c, p);
   mpz_mul_ui(c, c, 2);
 
   /* Euclidean algorithm */
-  while (mpz_cmp(b, c) > 0) {
-    mpz_set(d, a);
-    mpz_set(a, b);
-    mpz_mod(b, d, b);
-  }
+  _euclid_until(a, b, c, d, x);
 
   mpz_mul_ui(c, p, 4);
   mpz_mul(a, b, b);
@@ -212,15 +691,62 @@ int modified_cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p)
     if (mpz_perfect_square_p(c)) {
       mpz_set(x, b);
       mpz_sqrt(y, c);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Modified Cornacchia, Solve x,y for x^2 + |D|y^2 = 4p given prime p */
+/* See Cohen 1.5.3 */
+int modified_cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p)
+{
+  int result = 0;
+  mpz_t a, b, c, d;
+
+  if (mpz_cmp_ui(p, 2) == 0) {
+    mpz_add_ui(x, D, 8);
+    if (mpz_perfect_square_p(x)) {
+      mpz_sqrt(x, x);
+      mpz_set_ui(y, 1);
       result = 1;
     }
+    return result;
   }
+  if (mpz_jacobi(D, p) == -1)     /* No solution */
+    return 0;
+
+  mpz_init(a); mpz_init(b); mpz_init(c); mpz_init(d);
+
+  sqrtmod(x, D, p, a, b, c, d);
+  mpz_set(d, x);
+  result = _modified_cornacchia_reduce(x, y, D, p, d, a, b, c, d);
 
   mpz_clear(a); mpz_clear(b); mpz_clear(c); mpz_clear(d);
 
   return result;
 }
 
+/* The same for many D with a fixed odd prime p.  sqrt(D) is assembled
+ * from the cached roots of the primes dividing D. */
+int modified_cornacchia_ctx(mpz_t x, mpz_t y, IV D, sqrtmod_ctx_t* ctx)
+{
+  int result = 0;
+  mpz_t mD, r, a, b, c, d;
+
+  mpz_init_set_si(mD, D);
+  if (mpz_jacobi(mD, ctx->p) == -1) {
+    mpz_clear(mD);
+    return 0;
+  }
+  mpz_init(r);  mpz_init(a);  mpz_init(b);  mpz_init(c);  mpz_init(d);
+  if (sqrtmod_ctx_si(ctx, r, D))
+    result = _modified_cornacchia_reduce(x, y, mD, ctx->p, r, a, b, c, d);
+  mpz_clear(mD);
+  mpz_clear(r);  mpz_clear(a);  mpz_clear(b);  mpz_clear(c);  mpz_clear(d);
+  return result;
+}
+
 
 /* Modular inversion: invert a mod p.
  * This implementation from William Hart, using extended gcd.
@@ -524,7 +1050,7 @@ void polyz_mulmod(mpz_t* pr, mpz_t* px, mpz_t *py, long *dr, long dx, long dy, m
   while (*dr > 0 && mpz_sgn(pr[*dr]) == 0)  dr[0]--;
 }
 #endif
-#if 1
+#if 0
 void polyz_mulmod(mpz_t* pr, mpz_t* px, mpz_t *py, long *dr, long dx, long dy, mpz_t mod)
 {
   UV i, bits, r;
@@ -618,6 +1144,77 @@ void polyz_mulmod(mpz_t* pr, mpz_t* px, mpz_t *py, long *dr, long dx, long dy, m
 }
 #endif
 
+/* Kronecker substitution using import/export as in poly_mod_mul, but with
+ * whole limbs so GMP can copy directly.  Packing and unpacking are linear in
+ * the size, unlike the shift+add version.  Sizes are in limbs. */
+#define LIMBBYTES sizeof(mp_limb_t)
+static UV _polyz_klimbs(mpz_t mod, long terms)
+{
+  UV bits;
+  mpz_t t;
+  mpz_init(t);
+  mpz_mul(t, mod, mod);
+  mpz_mul_ui(t, t, terms);
+  bits = mpz_sizeinbase(t, 2);
+  mpz_clear(t);
+  return (bits + 8*LIMBBYTES - 1) / (8*LIMBBYTES);
+}
+/* p = sum px[i] x^(i*limbs) for the n coefficients, reversed if rev. */
+static void _polyz_pack(mpz_t p, mpz_t* px, long n, int rev, UV limbs, mpz_t mod)
+{
+  long i;
+  mp_limb_t* s;
+  mpz_t t;
+  mpz_init(t);
+  Newz(0, s, n*limbs, mp_limb_t);
+  for (i = 0; i < n; i++) {
+    mpz_t* c = px + (rev ? n-1-i : i);
+    if (mpz_sgn(*c) < 0 || mpz_cmp(*c, mod) >= 0) {
+      mpz_mod(t, *c, mod);
+      c = &t;
+    }
+    mpz_export(s + i*limbs, NULL, -1, LIMBBYTES, 0, 0, *c);
+  }
+  mpz_import(p, n*limbs, -1, LIMBBYTES, 0, 0, s);
+  Safefree(s);
+  mpz_clear(t);
+}
+/* pr[0..n-1] = the low n coefficients of packed p, mod mod.  Destroys p. */
+static void _polyz_unpack(mpz_t* pr, long n, mpz_t p, UV limbs, mpz_t mod)
+{
+  long i;
+  mp_limb_t* s;
+  Newz(0, s, n*limbs, mp_limb_t);
+  mpz_tdiv_r_2exp(p, p, 8*LIMBBYTES*n*limbs);
+  mpz_export(s, NULL, -1, LIMBBYTES, 0, 0, p);
+  for (i = 0; i < n; i++) {
+    mpz_import(pr[i], limbs, -1, LIMBBYTES, 0, 0, s + i*limbs);
+    mpz_mod(pr[i], pr[i], mod);
+  }
+  Safefree(s);
+}
+
+void polyz_mulmod(mpz_t* pr, mpz_t* px, mpz_t *py, long *dr, long dx, long dy, mpz_t mod)
+{
+  UV limbs;
+  mpz_t p, p2;
+
+  *dr = dx+dy;
+  limbs = _polyz_klimbs(mod, 1 + ((dx < dy) ? dx : dy));
+  mpz_init(p);
+  _polyz_pack(p, px, dx+1, 0, limbs, mod);
+  if (px == py && dx == dy) {
+    mpz_mul(p, p, p);
+  } else {
+    mpz_init(p2);
+    _polyz_pack(p2, py, dy+1, 0, limbs, mod);
+    mpz_mul(p, p, p2);
+    mpz_clear(p2);
+  }
+  _polyz_unpack(pr, *dr+1, p, limbs, mod);
+  mpz_clear(p);
+}
+
 /* Polynomial division modulo N.
  * This is Cohen algorithm 3.1.2 "pseudo-division". */
 void polyz_div(mpz_t *pq, mpz_t *pr, mpz_t *pn, mpz_t *pd,
@@ -683,7 +1280,7 @@ void polyz_div(mpz_t *pq, mpz_t *pr, mpz_t *pn, mpz_t *pd,
 }
 
 /* Raise poly pn to the power, modulo poly pmod and coefficient NMOD. */
-void polyz_pow_polymod(mpz_t* pres,  mpz_t* pn,  mpz_t* pmod,
+static void _polyz_pow_polymod_classic(mpz_t* pres,  mpz_t* pn,  mpz_t* pmod,
                               long *dres,   long   dn,  long   dmod,
                               mpz_t power, mpz_t NMOD)
 {
@@ -733,7 +1330,7 @@ void polyz_pow_polymod(mpz_t* pres,  mpz_t* pn,  mpz_t* pmod,
   Safefree(pX);
 }
 
-void polyz_gcd(mpz_t* pres, mpz_t* pa, mpz_t* pb, long* dres, long da, long db, mpz_t MODN)
+static void _polyz_gcd_classic(mpz_t* pres, mpz_t* pa, mpz_t* pb, long* dres, long da, long db, mpz_t MODN)
 {
   long i;
   long dr1, dq, dr, maxd;
@@ -800,6 +1397,538 @@ void polyz_gcd(mpz_t* pres, mpz_t* pa, mpz_t* pb, long* dres, long da, long db,
   Safefree(pr);
 }
 
+/*****************************************************************************/
+/* Fast polynomial arithmetic modulo N, for large degree.
+ *
+ *   - Remainders by a fixed modulus f use a precomputed Newton reciprocal
+ *     of reverse(f), so each reduction is two Kronecker multiplies.
+ *   - GCD uses the half-GCD algorithm (Thull and Yap 1990) above a
+ *     threshold, and Euclid with field division below it.
+ *
+ * Both need the leading coefficients to be invertible mod N, which is
+ * always true for prime N.  If not, we fall back to the classic code.
+ */
+
+#define POLYZ_FASTDIV_THRESH   4   /* modulus degree to use Newton division */
+#define POLYZ_HGCD_THRESH    200   /* gcd degree to use half-GCD */
+#define POLYZ_HGCD_BASE       48   /* half-GCD degree to do directly */
+
+typedef struct {
+  mpz_t *f;       /* the monic modulus */
+  long   m;       /* its degree */
+  UV     limbs;   /* Kronecker packing size in limbs */
+  mpz_t  F;       /* packed f */
+  mpz_t  I;       /* packed 1/reverse(f) mod x^(m-1) */
+  mpz_t *t1, *t2; /* m coefficient workspaces */
+} polyz_pre_t;
+
+static void _polyz_pre_clear(polyz_pre_t* pre)
+{
+  long i;
+  for (i = 0; i <= pre->m; i++)  mpz_clear(pre->f[i]);
+  for (i = 0; i < pre->m; i++) { mpz_clear(pre->t1[i]); mpz_clear(pre->t2[i]); }
+  Safefree(pre->f);  Safefree(pre->t1);  Safefree(pre->t2);
+  mpz_clear(pre->F);  mpz_clear(pre->I);
+}
+
+/* Returns 0 if the leading coefficient isn't invertible mod N. */
+static int _polyz_pre_init(polyz_pre_t* pre, mpz_t* pf, long m, mpz_t N)
+{
+  long i, k, prec, np, dt;
+  mpz_t linv, *h, *g, *e, *t;
+
+  mpz_init(linv);
+  if (!mpz_invert(linv, pf[m], N)) { mpz_clear(linv); return 0; }
+
+  pre->m = m;
+  pre->limbs = _polyz_klimbs(N, m+1);
+  New(0, pre->f, m+1, mpz_t);
+  New(0, pre->t1, m, mpz_t);
+  New(0, pre->t2, m, mpz_t);
+  for (i = 0; i <= m; i++) {
+    mpz_init(pre->f[i]);
+    mpz_mul(pre->f[i], pf[i], linv);
+    mpz_mod(pre->f[i], pre->f[i], N);
+  }
+  for (i = 0; i < m; i++) { mpz_init(pre->t1[i]); mpz_init(pre->t2[i]); }
+  mpz_init(pre->F);
+  mpz_init(pre->I);
+  _polyz_pack(pre->F, pre->f, m+1, 0, pre->limbs, N);
+
+  /* Newton iteration g = g(2 - hg) for g = 1/h mod x^k, h = reverse(f). */
+  k = m-1;
+  New(0, h, m+1, mpz_t);
+  New(0, g, k, mpz_t);
+  New(0, e, k, mpz_t);
+  New(0, t, 2*k, mpz_t);
+  for (i = 0; i <= m; i++)  mpz_init_set(h[i], pre->f[m-i]);
+  for (i = 0; i < k; i++) { mpz_init(g[i]); mpz_init(e[i]); }
+  for (i = 0; i < 2*k; i++) mpz_init(t[i]);
+  mpz_set_ui(g[0], 1);
+  for (prec = 1; prec < k; prec = np) {
+    np = (2*prec < k) ? 2*prec : k;
+    /* h*g = 1 + x^prec * e  (mod x^np),  so g -= x^prec * g*e */
+    polyz_mulmod(t, h, g, &dt, np-1, prec-1, N);
+    for (i = 0; i < np-prec; i++)
+      mpz_set(e[i], t[prec+i]);
+    polyz_mulmod(t, g, e, &dt, prec-1, np-prec-1, N);
+    for (i = 0; i < np-prec; i++) {
+      mpz_neg(g[prec+i], t[i]);
+      mpz_mod(g[prec+i], g[prec+i], N);
+    }
+  }
+  _polyz_pack(pre->I, g, k, 0, pre->limbs, N);
+
+  for (i = 0; i <= m; i++)  mpz_clear(h[i]);
+  for (i = 0; i < k; i++) { mpz_clear(g[i]); mpz_clear(e[i]); }
+  for (i = 0; i < 2*k; i++) mpz_clear(t[i]);
+  Safefree(h);  Safefree(g);  Safefree(e);  Safefree(t);
+  mpz_clear(linv);
+  return 1;
+}
+
+/* pr = pa mod f, for deg(pa) <= 2m-2 with reduced coefficients.
+ * pr may be pa, and must have room for max(da,m-1)+1 coefficients. */
+static void _polyz_pre_rem(mpz_t* pr, long* dr, mpz_t* pa, long da,
+                           polyz_pre_t* pre, mpz_t N)
+{
+  long i, m = pre->m, ka = da - m + 1;
+  mpz_t p;
+
+  while (da > 0 && mpz_sgn(pa[da]) == 0)  da--;
+  if (da < m) {
+    if (pr != pa) for (i = 0; i <= da; i++) mpz_set(pr[i], pa[i]);
+    *dr = da;
+    return;
+  }
+  ka = da - m + 1;
+  if (ka > m-1) croak("polyz_pre_rem: input degree too large\n");
+
+  mpz_init(p);
+  /* reverse(q) = reverse(a) * I mod x^ka */
+  _polyz_pack(p, pa+m, ka, 1, pre->limbs, N);
+  mpz_mul(p, p, pre->I);
+  _polyz_unpack(pre->t1, ka, p, pre->limbs, N);
+  /* r = a - q*f mod x^m */
+  _polyz_pack(p, pre->t1, ka, 1, pre->limbs, N);
+  mpz_mul(p, p, pre->F);
+  _polyz_unpack(pre->t2, m, p, pre->limbs, N);
+  for (i = 0; i < m; i++) {
+    mpz_sub(pr[i], pa[i], pre->t2[i]);
+    if (mpz_sgn(pr[i]) < 0) mpz_add(pr[i], pr[i], N);
+  }
+  *dr = m-1;
+  while (*dr > 0 && mpz_sgn(pr[*dr]) == 0)  dr[0]--;
+  mpz_clear(p);
+}
+
+/* pr = (x0 + x1*x) * pr mod f, in linear time */
+static void _polyz_pre_mul_linear(mpz_t* pr, long* dr, mpz_t x0, mpz_t x1,
+                                  polyz_pre_t* pre, mpz_t N, mpz_t c, mpz_t t)
+{
+  long i, m = pre->m;
+  for (i = *dr+1; i < m; i++)  mpz_set_ui(pr[i], 0);
+  if (*dr == m-1) mpz_mulmod(c, x1, pr[m-1], N, t);
+  else            mpz_set_ui(c, 0);
+  for (i = m-1; i >= 0; i--) {
+    mpz_mul(t, x0, pr[i]);
+    if (i > 0)           mpz_addmul(t, x1, pr[i-1]);
+    if (mpz_sgn(c) != 0) mpz_submul(t, c, pre->f[i]);
+    mpz_mod(pr[i], t, N);
+  }
+  *dr = m-1;
+  while (*dr > 0 && mpz_sgn(pr[*dr]) == 0)  dr[0]--;
+}
+
+/* pR = pX^power mod f, with pX reduced.  pR needs room for 2m-1 coefficients.
+ * A linear base uses the binary method with a cheap multiply, otherwise we
+ * use a sliding window over the odd powers of pX. */
+static void _polyz_pre_pow(mpz_t* pR, long* dR, mpz_t* pX, long dX, mpz_t power,
+                           polyz_pre_t* pre, mpz_t N)
+{
+  long i, j, m = pre->m, dP, bit, nbits, *dW = 0;
+  int w, nwin;
+  mpz_t *pP, **pW = 0, c, t;
+
+  nbits = mpz_sizeinbase(power, 2);
+  if (mpz_sgn(power) == 0) {
+    *dR = 0;  mpz_set_ui(pR[0], 1);
+    return;
+  }
+  New(0, pP, 2*m-1, mpz_t);
+  for (i = 0; i < 2*m-1; i++)  mpz_init(pP[i]);
+  mpz_init(c);  mpz_init(t);
+
+  if (dX <= 1) {
+    mpz_t zero;
+    mpz_init(zero);
+    polyz_set(pR, dR, pX, dX);
+    for (bit = nbits-2; bit >= 0; bit--) {
+      polyz_mulmod(pP, pR, pR, &dP, *dR, *dR, N);
+      _polyz_pre_rem(pR, dR, pP, dP, pre, N);
+      if (mpz_tstbit(power, bit))
+        _polyz_pre_mul_linear(pR, dR, pX[0], (dX == 1) ? pX[1] : zero, pre, N, c, t);
+    }
+    mpz_clear(zero);
+  } else {
+    w = (nbits > 671) ? 5 : (nbits > 239) ? 4 : (nbits > 79) ? 3 : (nbits > 23) ? 2 : 1;
+    nwin = 1 << (w-1);
+    /* pW[j] = pX^(2j+1) */
+    New(0, pW, nwin, mpz_t*);
+    New(0, dW, nwin, long);
+    for (j = 0; j < nwin; j++) {
+      New(0, pW[j], m, mpz_t);
+      for (i = 0; i < m; i++)  mpz_init(pW[j][i]);
+    }
+    polyz_set(pW[0], dW, pX, dX);
+    if (nwin > 1) {
+      polyz_mulmod(pP, pX, pX, &dP, dX, dX, N);
+      _polyz_pre_rem(pR, dR, pP, dP, pre, N);        /* pR = X^2 */
+      for (j = 1; j < nwin; j++) {
+        polyz_mulmod(pP, pW[j-1], pR, &dP, dW[j-1], *dR, N);
+        _polyz_pre_rem(pW[j], dW+j, pP, dP, pre, N);
+      }
+    }
+    bit = nbits-1;
+    *dR = -1;
+    while (bit >= 0) {
+      if (!mpz_tstbit(power, bit)) {
+        j = 1;  i = 0;  /* square once */
+      } else {
+        /* Take the longest window bit..i of at most w bits ending in a 1 */
+        i = (bit-w+1 > 0) ? bit-w+1 : 0;
+        while (!mpz_tstbit(power, i)) i++;
+        j = bit-i+1;
+      }
+      if (*dR >= 0) {
+        long k;
+        for (k = 0; k < j; k++) {
+          polyz_mulmod(pP, pR, pR, &dP, *dR, *dR, N);
+          _polyz_pre_rem(pR, dR, pP, dP, pre, N);
+        }
+      }
+      if (mpz_tstbit(power, bit)) {
+        UV e = 0;
+        long k;
+        for (k = bit; k >= i; k--)  e = 2*e + mpz_tstbit(power, k);
+        if (*dR < 0) {
+          polyz_set(pR, dR, pW[e>>1], dW[e>>1]);
+        } else {
+          polyz_mulmod(pP, pR, pW[e>>1], &dP, *dR, dW[e>>1], N);
+          _polyz_pre_rem(pR, dR, pP, dP, pre, N);
+        }
+      }
+      bit -= j;
+    }
+    for (j = 0; j < nwin; j++) {
+      for (i = 0; i < m; i++)  mpz_clear(pW[j][i]);
+      Safefree(pW[j]);
+    }
+    Safefree(pW);  Safefree(dW);
+  }
+  for (i = 0; i < 2*m-1; i++)  mpz_clear(pP[i]);
+  Safefree(pP);
+  mpz_clear(c);  mpz_clear(t);
+}
+
+void polyz_pow_polymod(mpz_t* pres,  mpz_t* pn,  mpz_t* pmod,
+                              long *dres,   long   dn,  long   dmod,
+                              mpz_t power, mpz_t NMOD)
+{
+  polyz_pre_t pre;
+  long i, m, sz, dX, dQ;
+  mpz_t *pX, *pQ;
+
+  while (dmod > 0 && mpz_sgn(pmod[dmod]) == 0)  dmod--;
+  if (dmod < POLYZ_FASTDIV_THRESH || !_polyz_pre_init(&pre, pmod, dmod, NMOD)) {
+    _polyz_pow_polymod_classic(pres, pn, pmod, dres, dn, dmod, power, NMOD);
+    return;
+  }
+  m = dmod;
+
+  sz = ((dn > 2*m) ? dn : 2*m) + 1;
+  New(0, pX, sz, mpz_t);
+  New(0, pQ, sz, mpz_t);
+  for (i = 0; i < sz; i++) { mpz_init(pX[i]); mpz_init(pQ[i]); }
+
+  /* X = pn mod f */
+  polyz_mod(pQ, pn, &dn, NMOD);
+  if (dn <= 2*m-2) {
+    _polyz_pre_rem(pX, &dX, pQ, dn, &pre, NMOD);
+  } else {
+    for (i = 0; i <= dn; i++)  mpz_swap(pX[i], pQ[i]);
+    polyz_div(pQ, pX, pX, pre.f, &dQ, &dX, dn, m, NMOD);
+  }
+  _polyz_pre_pow(pQ, &dQ, pX, dX, power, &pre, NMOD);
+  polyz_set(pres, dres, pQ, dQ);
+
+  for (i = 0; i < sz; i++) { mpz_clear(pX[i]); mpz_clear(pQ[i]); }
+  Safefree(pX);  Safefree(pQ);
+  _polyz_pre_clear(&pre);
+}
+
+/* Polynomials with their own storage, used for the half-GCD.  The zero
+ * polynomial has degree -1. */
+typedef struct {
+  mpz_t *c;
+  long   d;
+  long   n;
+} polyz_t;
+
+static void pz_init(polyz_t* p)
+{
+  p->c = 0;  p->d = -1;  p->n = 0;
+}
+static void pz_clear(polyz_t* p)
+{
+  long i;
+  for (i = 0; i < p->n; i++)  mpz_clear(p->c[i]);
+  if (p->c) Safefree(p->c);
+  pz_init(p);
+}
+static void pz_fit(polyz_t* p, long n)
+{
+  if (n > p->n) {
+    long i;
+    if (p->c) Renew(p->c, n, mpz_t);
+    else      New(0, p->c, n, mpz_t);
+    for (i = p->n; i < n; i++)  mpz_init(p->c[i]);
+    p->n = n;
+  }
+}
+static void pz_norm(polyz_t* p)
+{
+  while (p->d >= 0 && mpz_sgn(p->c[p->d]) == 0)  p->d--;
+}
+static void pz_set(polyz_t* r, polyz_t* a)
+{
+  long i;
+  if (r == a) return;
+  pz_fit(r, a->d+1);
+  for (i = 0; i <= a->d; i++)  mpz_set(r->c[i], a->c[i]);
+  r->d = a->d;
+}
+static void pz_set_ui(polyz_t* r, UV v)
+{
+  pz_fit(r, 1);
+  mpz_set_ui(r->c[0], v);
+  r->d = (v == 0) ? -1 : 0;
+}
+static void pz_swap(polyz_t* a, polyz_t* b)
+{
+  polyz_t t = *a;  *a = *b;  *b = t;
+}
+/* r = a div x^k */
+static void pz_shr(polyz_t* r, polyz_t* a, long k)
+{
+  long i;
+  if (a->d < k) { r->d = -1; return; }
+  pz_fit(r, a->d-k+1);
+  for (i = 0; i <= a->d-k; i++)  mpz_set(r->c[i], a->c[i+k]);
+  r->d = a->d-k;
+}
+static void pz_mul(polyz_t* r, polyz_t* a, polyz_t* b, mpz_t N)
+{
+  long dr;
+  if (a->d < 0 || b->d < 0) { r->d = -1; return; }
+  pz_fit(r, a->d+b->d+1);
+  polyz_mulmod(r->c, a->c, b->c, &dr, a->d, b->d, N);
+  r->d = dr;
+  pz_norm(r);
+}
+/* r = a + sign*b */
+static void pz_addsub(polyz_t* r, polyz_t* a, polyz_t* b, int sign, mpz_t N)
+{
+  long i, d = (a->d > b->d) ? a->d : b->d;
+  pz_fit(r, d+1);
+  for (i = 0; i <= d; i++) {
+    if (i > a->d)       mpz_set_ui(r->c[i], 0);
+    else if (r != a)    mpz_set(r->c[i], a->c[i]);
+    if (i <= b->d) {
+      if (sign > 0) mpz_add(r->c[i], r->c[i], b->c[i]);
+      else          mpz_sub(r->c[i], r->c[i], b->c[i]);
+      mpz_mod(r->c[i], r->c[i], N);
+    }
+  }
+  r->d = d;
+  pz_norm(r);
+}
+/* q,r = a divmod b over Z/NZ.  Returns 0 if lc(b) isn't invertible. */
+static int pz_divrem(polyz_t* q, polyz_t* r, polyz_t* a, polyz_t* b, mpz_t N)
+{
+  long i, j, db = b->d;
+  mpz_t linv, c;
+
+  if (db < 0) croak("polyz_divrem: divide by zero\n");
+  mpz_init(linv);
+  if (!mpz_invert(linv, b->c[db], N)) { mpz_clear(linv); return 0; }
+  pz_set(r, a);
+  if (r->d < db) {
+    q->d = -1;
+    mpz_clear(linv);
+    return 1;
+  }
+  mpz_init(c);
+  q->d = r->d - db;
+  pz_fit(q, q->d+1);
+  for (i = q->d; i >= 0; i--) {
+    mpz_mul(c, r->c[db+i], linv);
+    mpz_mod(q->c[i], c, N);
+    if (mpz_sgn(q->c[i]) == 0) continue;
+    for (j = 0; j < db; j++) {
+      mpz_submul(r->c[i+j], q->c[i], b->c[j]);
+      mpz_mod(r->c[i+j], r->c[i+j], N);
+    }
+  }
+  r->d = db-1;
+  pz_norm(r);
+  mpz_clear(c);
+  mpz_clear(linv);
+  return 1;
+}
+
+/* 2x2 polynomial matrices, row major */
+static void pzm_init(polyz_t* M) { int i; for (i = 0; i < 4; i++) pz_init(M+i); }
+static void pzm_clear(polyz_t* M) { int i; for (i = 0; i < 4; i++) pz_clear(M+i); }
+static void pzm_identity(polyz_t* M)
+{
+  pz_set_ui(M+0, 1);  pz_set_ui(M+1, 0);
+  pz_set_ui(M+2, 0);  pz_set_ui(M+3, 1);
+}
+/* (a,b) = M (a,b) */
+static void pzm_apply(polyz_t* M, polyz_t* a, polyz_t* b, mpz_t N)
+{
+  polyz_t t1, t2, t3;
+  pz_init(&t1);  pz_init(&t2);  pz_init(&t3);
+  pz_mul(&t1, M+0, a, N);  pz_mul(&t2, M+1, b, N);
+  pz_addsub(&t3, &t1, &t2, 1, N);
+  pz_mul(&t1, M+2, a, N);  pz_mul(&t2, M+3, b, N);
+  pz_addsub(b, &t1, &t2, 1, N);
+  pz_swap(a, &t3);
+  pz_clear(&t1);  pz_clear(&t2);  pz_clear(&t3);
+}
+/* M = S M */
+static void pzm_lmul(polyz_t* M, polyz_t* S, mpz_t N)
+{
+  polyz_t R[4], t;
+  int i, j;
+  pzm_init(R);  pz_init(&t);
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++) {
+      pz_mul(R+2*i+j, S+2*i, M+j, N);
+      pz_mul(&t, S+2*i+1, M+2+j, N);
+      pz_addsub(R+2*i+j, R+2*i+j, &t, 1, N);
+    }
+  for (i = 0; i < 4; i++)  pz_swap(M+i, R+i);
+  pzm_clear(R);  pz_clear(&t);
+}
+/* One Euclid step: (a,b) = (b, a mod b), M = [0 1; 1 -q] M */
+static int pz_euclid_step(polyz_t* M, polyz_t* a, polyz_t* b, mpz_t N)
+{
+  polyz_t q, r, t;
+  pz_init(&q);  pz_init(&r);  pz_init(&t);
+  if (!pz_divrem(&q, &r, a, b, N)) {
+    pz_clear(&q);  pz_clear(&r);  pz_clear(&t);
+    return 0;
+  }
+  pz_swap(a, b);
+  pz_swap(b, &r);
+  if (M) {
+    pz_mul(&t, &q, M+2, N);
+    pz_addsub(M+0, M+0, &t, -1, N);
+    pz_mul(&t, &q, M+3, N);
+    pz_addsub(M+1, M+1, &t, -1, N);
+    pz_swap(M+0, M+2);
+    pz_swap(M+1, M+3);
+  }
+  pz_clear(&q);  pz_clear(&r);  pz_clear(&t);
+  return 1;
+}
+
+/* Half-GCD: for deg a > deg b, find M such that (a',b') = M (a,b) are
+ * consecutive remainders with deg b' < ceil(deg a / 2) <= deg a'.
+ * Returns 0 if a non-invertible leading coefficient was found. */
+static int pz_hgcd(polyz_t* M, polyz_t* a, polyz_t* b, mpz_t N)
+{
+  long m = (a->d + 1) / 2, k;
+  int ok = 1;
+  polyz_t a0, b0, a1, b1, S[4];
+
+  pzm_identity(M);
+  if (b->d < m)  return 1;
+
+  pz_init(&a1);  pz_init(&b1);
+  pz_set(&a1, a);  pz_set(&b1, b);
+  if (a->d < POLYZ_HGCD_BASE) {
+    while (ok && b1.d >= m)
+      ok = pz_euclid_step(M, &a1, &b1, N);
+    pz_clear(&a1);  pz_clear(&b1);
+    return ok;
+  }
+
+  pz_init(&a0);  pz_init(&b0);  pzm_init(S);
+  pz_shr(&a0, a, m);  pz_shr(&b0, b, m);
+  ok = pz_hgcd(M, &a0, &b0, N);
+  if (ok) pzm_apply(M, &a1, &b1, N);
+  if (ok && b1.d >= m) {
+    ok = pz_euclid_step(M, &a1, &b1, N);
+    if (ok && b1.d >= m) {
+      k = 2*m - a1.d;
+      pz_shr(&a0, &a1, k);  pz_shr(&b0, &b1, k);
+      ok = pz_hgcd(S, &a0, &b0, N);
+      if (ok) pzm_lmul(M, S, N);
+    }
+  }
+  pz_clear(&a0);  pz_clear(&b0);  pz_clear(&a1);  pz_clear(&b1);  pzm_clear(S);
+  return ok;
+}
+
+static int _polyz_gcd_fast(mpz_t* pres, mpz_t* pa, mpz_t* pb, long* dres, long da, long db, mpz_t N)
+{
+  long i;
+  int ok = 1;
+  polyz_t a, b, M[4];
+  mpz_t linv;
+
+  pz_init(&a);  pz_init(&b);  pzm_init(M);
+  pz_fit(&a, da+1);  pz_fit(&b, db+1);
+  for (i = 0; i <= da; i++)  mpz_mod(a.c[i], pa[i], N);
+  for (i = 0; i <= db; i++)  mpz_mod(b.c[i], pb[i], N);
+  a.d = da;  b.d = db;
+  pz_norm(&a);  pz_norm(&b);
+  if (a.d < b.d) pz_swap(&a, &b);
+
+  while (ok && b.d >= 0) {
+    if (a.d >= POLYZ_HGCD_THRESH && a.d > b.d) {
+      ok = pz_hgcd(M, &a, &b, N);
+      if (ok) pzm_apply(M, &a, &b, N);
+      if (!ok || b.d < 0) break;
+    }
+    ok = pz_euclid_step(0, &a, &b, N);
+  }
+
+  mpz_init(linv);
+  if (ok && a.d >= 0 && mpz_invert(linv, a.c[a.d], N)) {
+    /* Return the monic gcd */
+    for (i = 0; i <= a.d; i++) {
+      mpz_mul(pres[i], a.c[i], linv);
+      mpz_mod(pres[i], pres[i], N);
+    }
+    *dres = a.d;
+  } else {
+    ok = 0;
+  }
+  mpz_clear(linv);
+  pz_clear(&a);  pz_clear(&b);  pzm_clear(M);
+  return ok;
+}
+
+void polyz_gcd(mpz_t* pres, mpz_t* pa, mpz_t* pb, long* dres, long da, long db, mpz_t MODN)
+{
+  if (!_polyz_gcd_fast(pres, pa, pb, dres, da, db, MODN))
+    _polyz_gcd_classic(pres, pa, pb, dres, da, db, MODN);
+}
+
 
 
 void polyz_root_deg1(mpz_t root, mpz_t* pn, mpz_t NMOD)
@@ -840,6 +1969,8 @@ static void polyz_roots(mpz_t* roots, long *nroots,
                         gmp_randstate_t* p_randstate)
 {
   long i, ntries, maxtries, maxd, dxa, dt, dh, dq, dup;
+  int usepre;
+  polyz_pre_t pre;
   mpz_t t, power;
   mpz_t pxa[2];
   mpz_t *pt, *ph, *pq;
@@ -897,6 +2028,8 @@ static void polyz_roots(mpz_t* roots, long *nroots,
 
   mpz_sub_ui(t, NMOD, 1);
   mpz_tdiv_q_2exp(power, t, 1);
+  /* The reciprocal of g is shared by all the attempts. */
+  usepre = (dg >= POLYZ_FASTDIV_THRESH && _polyz_pre_init(&pre, pg, dg, NMOD));
   /* We'll pick random "a" values from 1 to 1000M */
   mpz_set_ui(t, 1000000000UL);
   if (mpz_cmp(t, NMOD) > 0) mpz_set(t, NMOD);
@@ -907,7 +2040,10 @@ static void polyz_roots(mpz_t* roots, long *nroots,
     else              mpz_urandomm(pxa[0], *p_randstate, t);
 
     /* Raise pxa to (NMOD-1)/2, all modulo NMOD and g(x) */
-    polyz_pow_polymod(pt, pxa, pg, &dt, dxa, dg, power, NMOD);
+    if (usepre)
+      _polyz_pre_pow(pt, &dt, pxa, dxa, power, &pre, NMOD);
+    else
+      polyz_pow_polymod(pt, pxa, pg, &dt, dxa, dg, power, NMOD);
 
     /* Subtract 1 and gcd */
     mpz_sub_ui(pt[0], pt[0], 1);
@@ -917,6 +2053,9 @@ static void polyz_roots(mpz_t* roots, long *nroots,
       break;
   }
 
+  if (usepre)
+    _polyz_pre_clear(&pre);
+
   if (dh >= 1 && dh < dg) {
     /* Pick the smaller of the two splits to process first */
     if (dh <= 2 || dh <= (dg-dh)) {
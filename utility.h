@@ -11,6 +11,38 @@ extern gmp_randstate_t* get_randstate(void);
 extern void init_randstate(unsigned long seed);
 extern void clear_randstate(void);
 
+/* Worker threads for parallel sections.  1 (the default) means serial. */
+extern int get_thread_count(void);
+extern void set_thread_count(int nthreads);
+/* Call fn on each of the njobs items of size argsize starting at args,
+ * using up to get_thread_count() threads.  Serial unless USE_PTHREADS and
+ * the compiler has thread local storage for the scratch stack.
+ * fn must only use thread-safe code: mpz ops and scratch temporaries (so
+ * _GMP_BPSW), but no croak, randstate, or stats. */
+extern void run_parallel(void (*fn)(void*), void* args, size_t argsize, int njobs);
+
+/* A time budget for the long-running methods.  The factoring loops (p-1,
+ * p+1, rho, HOLF, ECM, QS, factor), BLS75, and ECPP call budget_expired()
+ * at points where they can stop, and return what they have so far: no
+ * factor, a partial factorization, or probably prime rather than proven.
+ * budget_set(0) removes the limit, and budget_stopped() says whether
+ * anything stopped early since the last budget_set.  budget_cancel() stops
+ * everything, and is safe to call from a signal handler. */
+extern void budget_set(double seconds);
+extern void budget_cancel(void);
+extern int  budget_expired(void);
+extern int  budget_stopped(void);
+
+/* Scratch mpz_t temporaries kept on a stack so their limbs are reused from
+ * call to call.  Take a mark, get temporaries sized for at least bits, and
+ * release back to the mark before returning (in LIFO order, and never
+ * across a croak).  With USE_PTHREADS each thread has its own stack, and
+ * run_parallel's threads free theirs when they finish. */
+extern UV      scratch_mark(void);
+extern mpz_ptr scratch_mpz(UV bits);
+extern void    scratch_release(UV mark);
+extern void    scratch_free(void);
+
 /* tdiv_r is faster, but we'd need to guarantee the input is positive */
 #define mpz_mulmod(r, a, b, n, t)  \
   do { mpz_mul(t, a, b); mpz_mod(r, t, n); } while (0)
@@ -22,6 +54,27 @@ extern int mpz_divmod(mpz_t r, mpz_t a, mpz_t b, mpz_t n, mpz_t t);
 extern int sqrtmod(mpz_t s, mpz_t a, mpz_t p,
                    mpz_t t, mpz_t t2, mpz_t b, mpz_t g); /* 4 temp variables */
 
+/* Square roots modulo a fixed odd prime, for many inputs. */
+typedef struct {
+  IV    k;
+  int   qnr;            /* root is of c*k rather than k */
+  mpz_t root;
+} sqrtmod_cache_t;
+typedef struct {
+  mpz_t p, q;           /* p-1 = q * 2^e */
+  int   e;
+  mpz_t c, cinv;        /* a small non-residue and its inverse */
+  mpz_t *zpow;          /* (c^q)^(2^i) for i = 0..e, or null */
+  sqrtmod_cache_t* cache;
+  UV    ncache, maxcache;
+  mpz_t t1, t2, t3, t4, t5;
+} sqrtmod_ctx_t;
+extern void sqrtmod_ctx_init(sqrtmod_ctx_t* ctx, mpz_t p);
+extern void sqrtmod_ctx_destroy(sqrtmod_ctx_t* ctx);
+extern int  sqrtmod_ctx(sqrtmod_ctx_t* ctx, mpz_t x, mpz_t a);
+extern int  sqrtmod_ctx_si(sqrtmod_ctx_t* ctx, mpz_t x, IV a);
+extern UV   sqrtmod_batch_si(mpz_t* x, IV* a, UV n, mpz_t p);
+
 extern unsigned long modinverse(unsigned long a, unsigned long p);
 
 extern UV mpz_order_ui(UV r, mpz_t n, UV limit);
@@ -58,6 +111,8 @@ extern void polyz_roots_modp(mpz_t** roots, long *nroots, long maxroots,
 extern int cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p);
 /* Solve x^2 + |D|y^2 = 4p */
 extern int modified_cornacchia(mpz_t x, mpz_t y, mpz_t D, mpz_t p);
+/* The same, with sqrt(D) built from roots cached in ctx (p = ctx->p) */
+extern int modified_cornacchia_ctx(mpz_t x, mpz_t y, IV D, sqrtmod_ctx_t* ctx);
 
 /* return a class poly (Hilbert [type 1] or Weber [type 2]) */
 extern UV poly_class_poly(IV D, mpz_t**T, int* type);
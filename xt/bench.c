@@ -0,0 +1,225 @@
+/*
+ * Benchmarks for the core routines, built with the standalone ECPP program
+ * (see xt/create-standalone.sh, "make bench").
+ *
+ * Each routine is timed over a range of input sizes.  The inputs come from
+ * a fixed seed so runs on different releases see the same numbers, and
+ * the factoring methods run at fixed B1/B2 on inputs they won't split, so
+ * they measure the full work at those bounds.  Output is CSV or JSON with
+ * one record per (routine, size), for tracking regressions and tuning
+ * thresholds.
+ *
+ *   mpu-bench                      CSV to stdout
+ *   mpu-bench -json -time 1.0      JSON, at least 1 second per record
+ *   mpu-bench -only ecm            routines whose name contains "ecm"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <gmp.h>
+
+#include "ptypes.h"
+#include "gmp_main.h"
+#include "ecm.h"
+#include "simpqs.h"
+#include "ecpp.h"
+#include "utility.h"
+
+#define BENCH_NINPUTS 16
+
+typedef struct {
+  const char* name;
+  const char* unit;       /* "bits" or "digits" */
+  const char* input;      /* "prime", "semiprime", "balanced", "random" (odd) */
+  int         sizes[8];   /* 0 terminated */
+  UV          param[3];   /* passed to the routine, e.g. B1, B2, curves */
+} bench_t;
+
+static const bench_t benches[] = {
+  { "mr",            "bits",   "prime",     {64,128,256,512,1024,2048,4096}, {2,0,0} },
+  { "lucas",         "bits",   "prime",     {64,128,256,512,1024,2048,4096}, {2,0,0} },
+  { "bpsw",          "bits",   "prime",     {64,128,256,512,1024,2048,4096}, {0,0,0} },
+  { "frobenius",     "bits",   "prime",     {64,128,256,512,1024,2048},      {0,0,0} },
+  { "next_prime",    "bits",   "random",    {64,128,256,512,1024,2048},      {0,0,0} },
+  { "partial_sieve", "bits",   "random",    {64,256,1024,4096},        {10000,100000,0} },
+  { "pbrent",        "bits",   "semiprime", {64,128,256},              {3,4000,0} },
+  { "squfof",        "bits",   "balanced",  {40,50,60},                {200000,0,0} },
+  { "holf",          "bits",   "balanced",  {40,50,60},                {200000,0,0} },
+  { "pminus1",       "bits",   "balanced",  {128,256,512},             {10000,500000,0} },
+  { "pplus1",        "bits",   "balanced",  {128,256,512},             {5,10000,500000} },
+  { "ecm",           "bits",   "balanced",  {128,256,512},             {2000,100000,1} },
+  { "simpqs",        "digits", "balanced",  {30,40,50,60},             {0,0,0} },
+  { "ecpp",          "digits", "prime",     {50,100,200,300},          {0,0,0} },
+  { "aks",           "bits",   "prime",     {16,24,32},                {0,0,0} },
+};
+#define NBENCHES (sizeof(benches)/sizeof(benches[0]))
+
+static double _now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+static void _random_prime(mpz_t p, UV bits, gmp_randstate_t rs)
+{
+  mpz_urandomb(p, rs, bits);
+  mpz_setbit(p, bits-1);
+  _GMP_next_prime(p);
+}
+
+/* Fill in inputs of the given kind and size in bits. */
+static void _make_inputs(mpz_t* in, int nin, const char* kind, UV bits,
+                         gmp_randstate_t rs)
+{
+  mpz_t p, q;
+  int i;
+  mpz_init(p);  mpz_init(q);
+  for (i = 0; i < nin; i++) {
+    if (!strcmp(kind, "prime")) {
+      _random_prime(in[i], bits, rs);
+    } else if (!strcmp(kind, "random")) {
+      mpz_urandomb(in[i], rs, bits);
+      mpz_setbit(in[i], bits-1);
+      mpz_setbit(in[i], 0);
+    } else {
+      /* semiprime: a small factor of bits/4 bits.  balanced: two halves. */
+      UV pbits = !strcmp(kind, "semiprime") ? bits/4 : bits/2;
+      _random_prime(p, pbits, rs);
+      _random_prime(q, bits - pbits, rs);
+      mpz_mul(in[i], p, q);
+    }
+  }
+  mpz_clear(p);  mpz_clear(q);
+}
+
+/* Run the routine once on n.  The result goes in a checksum. */
+static UV _run_one(const bench_t* b, mpz_t n, mpz_t f, mpz_t* farray)
+{
+  const UV* P = b->param;
+  const char* s = b->name;
+  UV r = 0;
+
+  if      (!strcmp(s, "mr"))         { mpz_set_ui(f, P[0]);
+                                       r = _GMP_miller_rabin(n, f); }
+  else if (!strcmp(s, "lucas"))      r = _GMP_is_lucas_pseudoprime(n, P[0]);
+  else if (!strcmp(s, "bpsw"))       r = _GMP_BPSW(n);
+  else if (!strcmp(s, "frobenius"))  r = _GMP_is_frobenius_underwood_pseudoprime(n);
+  else if (!strcmp(s, "next_prime")) { mpz_set(f, n);  _GMP_next_prime(f);
+                                       r = mpz_get_ui(f); }
+  else if (!strcmp(s, "partial_sieve")) {
+    uint32_t* comp;
+    mpz_set(f, n);                    /* it moves start to start-1 */
+    comp = partial_sieve(f, P[0], P[1]);
+    r = comp[0];
+    Safefree(comp);
+  }
+  else if (!strcmp(s, "pbrent"))     r = _GMP_pbrent_factor(n, f, P[0], P[1]);
+  else if (!strcmp(s, "squfof"))     r = _GMP_squfof_factor(n, f, P[0]);
+  else if (!strcmp(s, "holf"))       r = _GMP_holf_factor(n, f, P[0]);
+  else if (!strcmp(s, "pminus1"))    r = _GMP_pminus1_factor(n, f, P[0], P[1]);
+  else if (!strcmp(s, "pplus1"))     r = _GMP_pplus1_factor(n, f, P[0], P[1], P[2]);
+  else if (!strcmp(s, "ecm"))        r = _GMP_ecm_factor_projective(n, f, P[0], P[1], P[2]);
+  else if (!strcmp(s, "simpqs"))     r = _GMP_simpqs(n, farray);
+  else if (!strcmp(s, "ecpp"))       r = _GMP_ecpp(n, 0);
+  else if (!strcmp(s, "aks"))        r = _GMP_is_aks_prime(n);
+  else croak("Unknown benchmark %s\n", s);
+  return r;
+}
+
+static void dieusage(char* prog) {
+  UV i;
+  printf("Usage: %s [options]\n\n", prog);
+  printf("Options:\n");
+  printf("   -csv       CSV output (default)\n");
+  printf("   -json      JSON output\n");
+  printf("   -seed <n>  seed for the inputs (default 42)\n");
+  printf("   -time <s>  minimum seconds per record (default 0.25)\n");
+  printf("   -only <s>  only routines whose name contains s\n");
+  printf("   -quick     only the smallest size of each routine\n");
+  printf("   -help      this message\n");
+  printf("\nRoutines:");
+  for (i = 0; i < NBENCHES; i++)  printf(" %s", benches[i].name);
+  printf("\n");
+  exit(3);
+}
+
+int main(int argc, char **argv)
+{
+  mpz_t in[BENCH_NINPUTS], f, farray[66];
+  gmp_randstate_t rs;
+  unsigned long seed = 42;
+  double mintime = 0.25;
+  const char* only = 0;
+  int do_json = 0, do_quick = 0, nrecords = 0, i;
+  UV b;
+
+  for (i = 1; i < argc; i++) {
+    if      (strcmp(argv[i], "-csv") == 0)   do_json = 0;
+    else if (strcmp(argv[i], "-json") == 0)  do_json = 1;
+    else if (strcmp(argv[i], "-quick") == 0) do_quick = 1;
+    else if (strcmp(argv[i], "-seed") == 0 && i+1 < argc)
+      seed = strtoul(argv[++i], 0, 10);
+    else if (strcmp(argv[i], "-time") == 0 && i+1 < argc)
+      mintime = atof(argv[++i]);
+    else if (strcmp(argv[i], "-only") == 0 && i+1 < argc)
+      only = argv[++i];
+    else
+      dieusage(argv[0]);
+  }
+
+  _GMP_init();
+  gmp_randinit_mt(rs);
+  mpz_init(f);
+  for (i = 0; i < BENCH_NINPUTS; i++)  mpz_init(in[i]);
+  for (i = 0; i < 66; i++)  mpz_init(farray[i]);
+
+  if (do_json)
+    printf("{\"gmp\":\"%s\",\"seed\":%lu,\"results\":[\n", gmp_version, seed);
+  else
+    printf("routine,size,unit,param1,param2,param3,ops,seconds,usec_per_op\n");
+
+  for (b = 0; b < NBENCHES; b++) {
+    const bench_t* B = benches + b;
+    int s;
+    if (only != 0 && strstr(B->name, only) == 0)  continue;
+    for (s = 0; s < 8 && B->sizes[s] > 0; s++) {
+      UV size = B->sizes[s], bits, ops = 0, check = 0;
+      double start, secs;
+      if (do_quick && s > 0)  break;
+      bits = !strcmp(B->unit, "digits") ? (UV)(size * 3.3219281) : size;
+      /* Same inputs for a given seed, routine, and size. */
+      gmp_randseed_ui(rs, seed + 1000*b + s);
+      _make_inputs(in, BENCH_NINPUTS, B->input, bits, rs);
+      start = _now();
+      do {
+        check += _run_one(B, in[ops % BENCH_NINPUTS], f, farray);
+        ops++;
+        secs = _now() - start;
+      } while (secs < mintime);
+      if (do_json)
+        printf("%s {\"routine\":\"%s\",\"size\":%lu,\"unit\":\"%s\",\"param\":[%lu,%lu,%lu],\"ops\":%lu,\"seconds\":%.6f,\"usec_per_op\":%.3f,\"check\":%lu}",
+               (nrecords > 0) ? ",\n" : "", B->name, (unsigned long)size,
+               B->unit, (unsigned long)B->param[0], (unsigned long)B->param[1],
+               (unsigned long)B->param[2], (unsigned long)ops, secs,
+               1e6 * secs / ops, (unsigned long)check);
+      else
+        printf("%s,%lu,%s,%lu,%lu,%lu,%lu,%.6f,%.3f\n", B->name,
+               (unsigned long)size, B->unit, (unsigned long)B->param[0],
+               (unsigned long)B->param[1], (unsigned long)B->param[2],
+               (unsigned long)ops, secs, 1e6 * secs / ops);
+      fflush(stdout);
+      nrecords++;
+    }
+  }
+  if (do_json)  printf("\n]}\n");
+
+  for (i = 0; i < 66; i++)  mpz_clear(farray[i]);
+  for (i = 0; i < BENCH_NINPUTS; i++)  mpz_clear(in[i]);
+  mpz_clear(f);
+  gmp_randclear(rs);
+  _GMP_destroy();
+  return 0;
+}
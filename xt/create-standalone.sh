@@ -7,8 +7,10 @@ fi
 
 cp -p ptypes.h standalone/
 cp -p ecpp.[ch] bls75.[ch] ecm.[ch] prime_iterator.[ch] standalone/
-cp -p gmp_main.[ch] small_factor.[ch] utility.[ch] standalone/
+cp -p gmp_main.[ch] small_factor.[ch] utility.[ch] stats.[ch] standalone/
+cp -p factor.[ch] simpqs.[ch] standalone/
 cp -p xt/expr.[ch] xt/expr-impl.h standalone/
+cp -p xt/bench.c xt/mpu-cli.c xt/mpu-gap.c standalone/
 cp -p xt/proof-text-format.txt standalone/
 cp -p examples/verify-cert.pl standalone/
 cp -p examples/vcert.c standalone/
@@ -22,17 +24,7 @@ else
   cp -p class_poly_data.h standalone/
 fi
 
-# Standalone ECPP doesn't need SIMPQS, so let's not include it.
-# Warning however:  large BLS75 proofs won't be practical without it.
-cat << 'EOSIMPQSH' > standalone/simpqs.h
-#ifndef MPU_SIMPQS_H
-#define MPU_SIMPQS_H
-#include <gmp.h>
-static int _GMP_simpqs(mpz_t n, mpz_t* farray) { return 0; }
-#endif
-EOSIMPQSH
-
-# gcc -O3 -fomit-frame-pointer -DSTANDALONE -DSTANDALONE_ECPP ecpp.c bls75.c ecm.c prime_iterator.c gmp_main.c small_factor.c utility.c expr.c -o ecpp-dj -lgmp -lm
+# gcc -O3 -fomit-frame-pointer -DSTANDALONE -DSTANDALONE_ECPP ecpp.c bls75.c ecm.c prime_iterator.c gmp_main.c small_factor.c utility.c stats.c factor.c simpqs.c expr.c -o ecpp-dj -lgmp -lm
 
 cat << 'EOM' > standalone/Makefile
 TARGET = ecpp-dj
@@ -41,13 +33,21 @@ DEFINES = -DSTANDALONE -DSTANDALONE_ECPP
 CFLAGS = -O3 -g -Wall $(DEFINES)
 LIBS = -lgmp -lm
 
-OBJ = ecpp.o bls75.o ecm.o prime_iterator.o gmp_main.o small_factor.o \
-      utility.o expr.o
+LIBOBJ = bls75.o ecm.o prime_iterator.o gmp_main.o small_factor.o \
+         utility.o stats.o factor.o simpqs.o
+OBJ = ecpp.o $(LIBOBJ) expr.o
 HEADERS = ptypes.h class_poly_data.h
 
-.PHONY: default all clean
+BENCH = mpu-bench
+BENCHOBJ = bench.o ecpp-nomain.o $(LIBOBJ)
+CLI = mpu-cli
+CLIOBJ = mpu-cli.o ecpp-nomain.o $(LIBOBJ) expr.o
+GAP = mpu-gap
+GAPOBJ = mpu-gap.o ecpp-nomain.o $(LIBOBJ) expr.o
+
+.PHONY: default all clean bench
 
-default: $(TARGET) vcert
+default: $(TARGET) vcert $(CLI) $(GAP)
 all: default
 
 %.o: %.c $(HEADERS)
@@ -61,11 +61,26 @@ $(TARGET): $(OBJ)
 vcert: vcert.o
 	$(CC) $^ $(LIBS) -o $@
 
+# The benchmark links ECPP without its main()
+ecpp-nomain.o: ecpp.c $(HEADERS)
+	$(CC) $(filter-out -DSTANDALONE_ECPP,$(CFLAGS)) -c $< -o $@
+
+$(BENCH): $(BENCHOBJ)
+	$(CC) $^ $(LIBS) -o $@
+
+bench: $(BENCH)
+
+$(CLI): $(CLIOBJ)
+	$(CC) $^ $(LIBS) -o $@
+
+$(GAP): $(GAPOBJ)
+	$(CC) $^ $(LIBS) -o $@
+
 clean:
 	-rm -f *.o
 
 realclean distclean: clean
-	-rm -f $(TARGET) vcert
+	-rm -f $(TARGET) vcert $(BENCH) $(CLI) $(GAP)
 
 TEST1 = 11739771271677308623
 TEST2 = 4101186565771483058393796013015990306873
@@ -94,6 +109,11 @@ INSTALLATION:
      make
      make test           (optional)
      ./ecpp-dj -help     (shows usage)
+     ./mpu-cli -help     (factor, is_prime, next_prime, etc., with batch stdin)
+     ./mpu-cli -j 4 -socket /tmp/mpu   (the same as a server on a Unix socket)
+     ./mpu-gap -help     (verify prime gaps, or search k*P#/d for large ones)
+     make bench          (optional, builds mpu-bench)
+     ./mpu-bench -help   (timings of the core routines as CSV or JSON)
 
      # If you plan on doing proofs with numbers over 800 digits, consider:
      #   wget http://probableprime.org/ecpp/cpd/huge/class_poly_data.h.gz
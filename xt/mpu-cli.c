@@ -0,0 +1,880 @@
+/*
+ * mpu-cli: factoring and primality from the command line, as a batch
+ * co-process reading stdin, or as a server on a Unix domain socket.  Built
+ * with the standalone ECPP program (see xt/create-standalone.sh).
+ *
+ *   mpu-cli factor '2**64+1'          one-shot
+ *   mpu-cli -j 4 < requests           batch, 4 worker processes
+ *   mpu-cli -c is_prime < numbers     batch, command for bare numbers
+ *   mpu-cli -j 4 -socket /tmp/mpu     server, until SIGINT or SIGTERM
+ *
+ * Each input line is "[command] expression", where the expression is a
+ * number or an expression like 10**100+267 or 2**127-1.  Blank lines and
+ * lines starting with # are skipped.  There is one line of output for each
+ * request, in the order the requests came in, except that "proof" prints
+ * a certificate followed by an empty line.  For is_provable_prime and
+ * proof, an expression like k*p#+1, k*fac(m)-1, or k*2**m+1 gives the
+ * primes of n-1 or n+1, which go straight to the BLS75 checks.  The line "timeout <secs>" sets
+ * a time limit for later requests (0 for none) and answers "ok".  A
+ * request over the limit stops and answers with what it has, after
+ * "timeout: ".  That is a factorization whose last factors may be
+ * composite, or 1 (probable prime) rather than a proof.  One that doesn't
+ * stop (not every step checks the time) answers "error: timeout".
+ *
+ * Requests are handled by worker processes rather than threads, as the
+ * library keeps global state (random state, stats, scratch temporaries).
+ * This also means a request that croaks or won't stop gives an error
+ * line rather than ending the program: the worker is replaced.  Results
+ * are sent as soon as they are ready and all earlier results from the
+ * same client have been sent, so it works interactively.
+ *
+ * The server builds the sieve and GCD tables before starting the workers,
+ * so each connection starts warm.  Connections share the workers, taking
+ * turns, and each may have as many requests in flight as there are
+ * workers, so a client streaming many small requests is batched through
+ * all of them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <gmp.h>
+
+#include "ptypes.h"
+#include "gmp_main.h"
+#include "factor.h"
+#include "ecpp.h"
+#include "bls75.h"
+#include "prime_iterator.h"
+#include "utility.h"
+#include "expr.h"
+
+#define MAX_WORKERS 64
+
+/*****************************************************************************/
+/* Growable output buffer */
+
+typedef struct {
+  char* s;
+  size_t len, alloc;
+} outbuf_t;
+
+static void out_reserve(outbuf_t* o, size_t n)
+{
+  if (o->len + n + 1 > o->alloc) {
+    o->alloc = 2 * (o->len + n + 1);
+    if (o->s == 0) New(0, o->s, o->alloc, char);
+    else           Renew(o->s, o->alloc, char);
+  }
+}
+static void out_str(outbuf_t* o, const char* str)
+{
+  size_t n = strlen(str);
+  out_reserve(o, n);
+  memcpy(o->s + o->len, str, n+1);
+  o->len += n;
+}
+static void out_mpz(outbuf_t* o, mpz_t n)
+{
+  out_reserve(o, mpz_sizeinbase(n, 10) + 2);
+  mpz_get_str(o->s + o->len, 10, n);
+  o->len += strlen(o->s + o->len);
+}
+
+/*****************************************************************************/
+/* Requests */
+
+static const char* commands[] = {
+  "factor", "is_prime", "is_prob_prime", "is_provable_prime", "proof",
+  "next_prime", "prev_prime", 0
+};
+
+static int find_command(const char* s, size_t len)
+{
+  int i;
+  for (i = 0; commands[i] != 0; i++)
+    if (strlen(commands[i]) == len && strncmp(commands[i], s, len) == 0)
+      return i;
+  return -1;
+}
+
+/* Add the prime factors of the term str (len chars) to the list f:  all
+ * primes to a for a# or fac(a), those of a for a**e, and those of an
+ * integer.  Returns 0 if the term isn't one of these. */
+static int term_factors(const char* str, size_t len, mpz_t** f, int* nf, int* alloc)
+{
+  char buf[64];
+  mpz_t m;
+  UV a = 0, p;
+  int i, nfac, *exp, all = 0;
+  mpz_t* fac;
+
+  if (len == 0 || len >= sizeof(buf))  return 0;
+  memcpy(buf, str, len);
+  buf[len] = '\0';
+  if (buf[len-1] == '#' && strspn(buf, "0123456789") == len-1) {
+    a = strtoul(buf, 0, 10);  all = 1;
+  } else if (strncmp(buf, "fac(", 4) == 0 && buf[len-1] == ')' &&
+             strspn(buf+4, "0123456789") == len-5) {
+    a = strtoul(buf+4, 0, 10);  all = 1;
+  } else {
+    char* e = strstr(buf, "**");
+    if (e != 0) *e = '\0';
+    if (buf[0] == '\0' || strspn(buf, "0123456789") != strlen(buf))  return 0;
+    if (e != 0 && (e[2] == '\0' || strspn(e+2, "0123456789") != strlen(e+2)))
+      return 0;
+  }
+  if (all) {
+    PRIME_ITERATOR(iter);
+    for (p = 2; p <= a; p = prime_iterator_next(&iter)) {
+      if (*nf >= *alloc) { *alloc = 2 * *alloc + 64;  Renew(*f, *alloc, mpz_t); }
+      mpz_init_set_ui((*f)[(*nf)++], p);
+    }
+    prime_iterator_destroy(&iter);
+    return 1;
+  }
+  mpz_init_set_str(m, buf, 10);
+  if (mpz_cmp_ui(m, 1) > 0) {
+    nfac = factor(m, &fac, &exp);
+    for (i = 0; i < nfac; i++) {
+      if (*nf >= *alloc) { *alloc = 2 * *alloc + 64;  Renew(*f, *alloc, mpz_t); }
+      mpz_init_set((*f)[(*nf)++], fac[i]);
+    }
+    clear_factors(nfac, &fac, &exp);
+  }
+  mpz_clear(m);
+  return 1;
+}
+
+/* For an expression X+1 or X-1 where X is a product of the terms above,
+ * return the primes of X in *f (count in *nf) and -1 for n-1 or 1 for n+1.
+ * Returns 0 for other expressions. */
+static int known_factors(const char* str, mpz_t** f, int* nf)
+{
+  char buf[1024];
+  size_t i, j, len = 0;
+  int sign, alloc = 0;
+
+  for (i = 0; str[i] != '\0'; i++)
+    if (str[i] != ' ' && str[i] != '\t') {
+      if (len >= sizeof(buf)-1)  return 0;
+      buf[len++] = str[i];
+    }
+  buf[len] = '\0';
+  if (len < 3 || buf[len-1] != '1' || (buf[len-2] != '+' && buf[len-2] != '-'))
+    return 0;
+  sign = (buf[len-2] == '-') ? 1 : -1;     /* X-1 means n+1 = X */
+  len -= 2;
+  if (strcspn(buf, "+-/%") < len)  return 0;
+
+  *f = 0;  *nf = 0;
+  for (i = 0; i < len; i = j+1) {
+    /* A term ends at a '*' that isn't part of '**' */
+    for (j = i; j < len; j++) {
+      if (buf[j] == '*' && buf[j+1] == '*') { j++; continue; }
+      if (buf[j] == '*') break;
+    }
+    if (!term_factors(buf+i, j-i, f, nf, &alloc)) {
+      while (*nf > 0)  mpz_clear((*f)[--(*nf)]);
+      if (*f != 0)  Safefree(*f);
+      *f = 0;
+      return 0;
+    }
+  }
+  return sign;
+}
+
+/* Run one command on the expression str, appending one result to out. */
+static void run_command(int cmd, const char* str, outbuf_t* out)
+{
+  mpz_t n;
+  mpz_init(n);
+  if (mpz_expr(n, 10, str)) {
+    out_str(out, "error: can't parse '");
+    out_str(out, str);
+    out_str(out, "'\n");
+    mpz_clear(n);
+    return;
+  }
+  switch (cmd) {
+    case 0: {                                   /* factor */
+      mpz_t* factors;
+      int* exponents;
+      int i, nfactors = factor(n, &factors, &exponents);
+      char e[24];
+      out_mpz(out, n);
+      out_str(out, ":");
+      for (i = 0; i < nfactors; i++) {
+        out_str(out, " ");
+        out_mpz(out, factors[i]);
+        if (exponents[i] > 1) { sprintf(e, "^%d", exponents[i]); out_str(out, e); }
+      }
+      out_str(out, "\n");
+      clear_factors(nfactors, &factors, &exponents);
+      break;
+    }
+    case 1:
+    case 2: {                                   /* is_prime, is_prob_prime */
+      int result = (cmd == 1) ? _GMP_is_prime(n) : _GMP_is_prob_prime(n);
+      out_str(out, result == 2 ? "2\n" : result == 1 ? "1\n" : "0\n");
+      break;
+    }
+    case 3:
+    case 4: {                                   /* is_provable_prime, proof */
+      char* prooftext = 0;
+      mpz_t* f;
+      int nf, result = 1, sign = known_factors(str, &f, &nf);
+      if (sign != 0) {
+        result = (sign < 0)
+          ? _GMP_primality_bls_nm1_known(n, f, nf, (cmd == 4) ? &prooftext : 0)
+          : _GMP_primality_bls_np1_known(n, f, nf, (cmd == 4) ? &prooftext : 0);
+        while (nf > 0)  mpz_clear(f[--nf]);
+        if (f != 0)  Safefree(f);
+      }
+      if (result == 1)
+        result = _GMP_is_provable_prime(n, (cmd == 4) ? &prooftext : 0);
+      if (cmd == 3) {
+        out_str(out, result == 2 ? "2\n" : result == 1 ? "1\n" : "0\n");
+      } else if (result != 2) {
+        out_str(out, result == 1 ? "PROBABLY PRIME\n\n" : "COMPOSITE\n\n");
+      } else {
+        out_str(out, "[MPU - Primality Certificate]\nVersion 1.0\n\nProof for:\nN ");
+        out_mpz(out, n);
+        out_str(out, "\n\n");
+        if (prooftext != 0) {
+          out_str(out, prooftext);
+        } else {
+          out_str(out, "Type Small\nN ");
+          out_mpz(out, n);
+          out_str(out, "\n");
+        }
+        out_str(out, "\n");
+      }
+      if (prooftext != 0)  Safefree(prooftext);
+      break;
+    }
+    case 5:  _GMP_next_prime(n);
+             out_mpz(out, n);  out_str(out, "\n");
+             break;
+    case 6:  if (mpz_cmp_ui(n, 2) <= 0)  mpz_set_ui(n, 0);
+             else                        _GMP_prev_prime(n);
+             out_mpz(out, n);  out_str(out, "\n");
+             break;
+  }
+  mpz_clear(n);
+}
+
+/* Handle one input line.  Returns 0 if the line is blank or a comment. */
+static int handle_line(char* line, int defcmd, outbuf_t* out)
+{
+  char *s = line, *e;
+  int cmd;
+  while (*s == ' ' || *s == '\t') s++;
+  e = s + strlen(s);
+  while (e > s && (e[-1] == '\n' || e[-1] == '\r' || e[-1] == ' ' || e[-1] == '\t'))
+    *--e = '\0';
+  if (*s == '\0' || *s == '#')  return 0;
+  for (e = s; *e != '\0' && *e != ' ' && *e != '\t'; e++)
+    ;
+  cmd = find_command(s, e-s);
+  if (cmd >= 0) {
+    s = e;
+    while (*s == ' ' || *s == '\t') s++;
+  } else if (*e != '\0' && strspn(s, "abcdefghijklmnopqrstuvwxyz_") == (size_t)(e-s)) {
+    /* A bare word followed by more text is a command we don't know */
+    out_str(out, "error: unknown command '");
+    *e = '\0';
+    out_str(out, s);
+    out_str(out, "'\n");
+    return 1;
+  } else {
+    cmd = defcmd;
+  }
+  run_command(cmd, s, out);
+  return 1;
+}
+
+/*****************************************************************************/
+/* Worker processes */
+
+typedef struct {
+  pid_t  pid;
+  int    wfd;         /* requests to the worker */
+  int    rfd;         /* results from the worker */
+  int    client;      /* client and sequence number of the request */
+  UV     seq;         /*   being worked on, client = -1 if idle */
+  double deadline;    /* 0 for no time limit */
+} worker_t;
+
+static double _now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+static int write_all(int fd, const char* s, size_t len)
+{
+  while (len > 0) {
+    ssize_t w = write(fd, s, len);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return 0;
+    s += w;  len -= w;
+  }
+  return 1;
+}
+
+static int read_all(int fd, char* s, size_t len)
+{
+  while (len > 0) {
+    ssize_t r = read(fd, s, len);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return 0;
+    s += r;  len -= r;
+  }
+  return 1;
+}
+
+/* Send a request line to a worker, with its time limit in front. */
+static int worker_send(worker_t* w, double timeout, const char* s, size_t len)
+{
+  char hdr[32];
+  sprintf(hdr, "%g ", timeout);
+  return write_all(w->wfd, hdr, strlen(hdr)) && write_all(w->wfd, s, len);
+}
+
+/* Worker: read "<time limit> <request>" lines, and write
+ * "<length>\n<result>" for each. */
+static void worker_loop(int rfd, int wfd, int defcmd)
+{
+  FILE* in = fdopen(rfd, "r");
+  char* line = 0;
+  size_t linealloc = 0;
+  outbuf_t out = {0, 0, 0};
+  char hdr[32];
+
+  while (getline(&line, &linealloc, in) > 0) {
+    char* req;
+    budget_set(strtod(line, &req));
+    out.len = 0;
+    out_reserve(&out, 1);
+    out.s[0] = '\0';
+    if (!handle_line(req, defcmd, &out)) {
+      out_str(&out, "\n");
+    } else if (budget_stopped()) {
+      out_reserve(&out, 9);
+      memmove(out.s + 9, out.s, out.len + 1);
+      memcpy(out.s, "timeout: ", 9);
+      out.len += 9;
+    }
+    sprintf(hdr, "%lu\n", (unsigned long) out.len);
+    if (!write_all(wfd, hdr, strlen(hdr)) || !write_all(wfd, out.s, out.len))
+      break;
+  }
+  free(line);
+  if (out.s != 0) Safefree(out.s);
+  fclose(in);
+  close(wfd);
+}
+
+static void worker_start(worker_t* w, int defcmd)
+{
+  int req[2], res[2], fd;
+  if (pipe(req) != 0 || pipe(res) != 0)
+    croak("mpu-cli: pipe failed\n");
+  fflush(stdout);
+  w->pid = fork();
+  if (w->pid < 0)
+    croak("mpu-cli: fork failed\n");
+  if (w->pid == 0) {
+    /* Anything the library prints (croak, verbose output) goes to stderr.
+     * Drop the other workers' pipes, the clients, and the listen socket. */
+    dup2(2, 1);
+    for (fd = 3; fd < FD_SETSIZE; fd++)
+      if (fd != req[0] && fd != res[1])
+        close(fd);
+    worker_loop(req[0], res[1], defcmd);
+    _GMP_destroy();
+    _exit(0);
+  }
+  close(req[0]);  close(res[1]);
+  w->wfd = req[1];
+  w->rfd = res[0];
+  w->client = -1;
+}
+
+static void worker_stop(worker_t* w, int kill_it)
+{
+  if (kill_it)  kill(w->pid, SIGKILL);
+  close(w->wfd);
+  close(w->rfd);
+  waitpid(w->pid, 0, 0);
+  w->pid = 0;
+}
+
+/* Read one result from w into out.  Returns 0 if the worker died. */
+static int worker_result(worker_t* w, outbuf_t* out)
+{
+  char hdr[32];
+  size_t i = 0, len;
+  while (i < sizeof(hdr)-1) {
+    if (!read_all(w->rfd, hdr+i, 1)) return 0;
+    if (hdr[i++] == '\n') break;
+  }
+  hdr[i] = '\0';
+  len = strtoul(hdr, 0, 10);
+  out->len = 0;
+  out_reserve(out, len);
+  if (!read_all(w->rfd, out->s, len)) return 0;
+  out->s[len] = '\0';
+  out->len = len;
+  return 1;
+}
+
+/*****************************************************************************/
+/* Clients: stdin/stdout, or a connection to the socket.
+ *
+ * Each client reads request lines and numbers them.  Up to `window`
+ * requests per client are in flight, and their results are held in slot
+ * seq % window until all earlier ones have gone out.  Requests from all
+ * clients share the workers.
+ */
+
+typedef struct {
+  int      infd, outfd;       /* -1 when closed */
+  int      at_eof;
+  int      is_socket;
+  char*    in;                /* unread input */
+  size_t   inlen, inalloc;
+  outbuf_t out;               /* output not yet written (sockets) */
+  size_t   outpos;
+  UV       nread, ndone;      /* requests numbered, results sent */
+  outbuf_t *slot;             /* results waiting for earlier ones */
+  char     *ready;
+  double   timeout;           /* seconds per request, 0 for none */
+} client_t;
+
+#define MAX_CLIENTS 64
+
+typedef struct {
+  worker_t workers[MAX_WORKERS];
+  int      nworkers, defcmd, window;
+  client_t clients[MAX_CLIENTS];
+  int      nclients;
+  int      next_client;       /* round robin start for fairness */
+  double   timeout;           /* default for new clients */
+} server_t;
+
+static int client_open(server_t* S, int infd, int outfd, int is_socket)
+{
+  int i;
+  client_t* c;
+  for (i = 0; i < MAX_CLIENTS; i++)
+    if (S->clients[i].infd < 0 && S->clients[i].outfd < 0)
+      break;
+  if (i == MAX_CLIENTS)  return -1;
+  if (i >= S->nclients)  S->nclients = i+1;
+  c = &S->clients[i];
+  memset(c, 0, sizeof(client_t));
+  c->infd = infd;
+  c->outfd = outfd;
+  c->is_socket = is_socket;
+  c->timeout = S->timeout;
+  c->inalloc = 4096;
+  New(0, c->in, c->inalloc, char);
+  Newz(0, c->slot, S->window, outbuf_t);
+  Newz(0, c->ready, S->window, char);
+  if (is_socket)  fcntl(outfd, F_SETFL, fcntl(outfd, F_GETFL) | O_NONBLOCK);
+  return i;
+}
+
+static void client_close(server_t* S, int ci)
+{
+  client_t* c = &S->clients[ci];
+  int i;
+  if (c->infd >= 0)  close(c->infd);
+  if (c->outfd >= 0 && c->outfd != c->infd)  close(c->outfd);
+  for (i = 0; i < S->window; i++)
+    if (c->slot[i].s)  Safefree(c->slot[i].s);
+  Safefree(c->slot);  Safefree(c->ready);  Safefree(c->in);
+  if (c->out.s)  Safefree(c->out.s);
+  c->infd = c->outfd = -1;
+  c->in = 0;
+  /* Results still being computed for this client are dropped */
+  for (i = 0; i < S->nworkers; i++)
+    if (S->workers[i].client == ci)
+      S->workers[i].client = -2;
+}
+
+/* Write what we can of the client's pending output. */
+static void client_flush(server_t* S, int ci)
+{
+  client_t* c = &S->clients[ci];
+  while (c->outpos < c->out.len) {
+    ssize_t w = write(c->outfd, c->out.s + c->outpos, c->out.len - c->outpos);
+    if (w < 0 && errno == EINTR) continue;
+    if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))  return;
+    if (w <= 0) { client_close(S, ci); return; }
+    c->outpos += w;
+  }
+  c->out.len = c->outpos = 0;
+}
+
+/* Result for request seq.  Send it and any that were waiting on it. */
+static void client_result(server_t* S, int ci, UV seq, const char* s)
+{
+  client_t* c = &S->clients[ci];
+  int k = seq % S->window;
+  c->slot[k].len = 0;
+  out_str(&c->slot[k], s);
+  c->ready[k] = 1;
+  while (c->ndone < c->nread && c->ready[c->ndone % S->window]) {
+    k = c->ndone % S->window;
+    out_str(&c->out, c->slot[k].s);
+    c->ready[k] = 0;
+    c->ndone++;
+  }
+  if (c->is_socket) {
+    client_flush(S, ci);
+  } else {
+    if (!write_all(c->outfd, c->out.s, c->out.len)) exit(1);
+    c->out.len = 0;
+  }
+}
+
+/* Take the client's next complete line.  Returns 0 if there isn't one. */
+static int client_line(client_t* c, outbuf_t* line)
+{
+  char* nl = memchr(c->in, '\n', c->inlen);
+  size_t n, used;
+  if (nl == 0 && !(c->at_eof && c->inlen > 0))  return 0;
+  n = used = (nl == 0) ? c->inlen : (size_t)(nl - c->in) + 1;
+  line->len = 0;
+  out_reserve(line, n + 1);
+  memcpy(line->s, c->in, n);
+  if (nl == 0) line->s[n++] = '\n';
+  line->s[n] = '\0';
+  line->len = n;
+  memmove(c->in, c->in + used, c->inlen - used);
+  c->inlen -= used;
+  return 1;
+}
+
+/* Lines handled here rather than by a worker.  "timeout <seconds>" sets
+ * the time limit for the client's later requests. */
+static int control_line(client_t* c, const char* s, const char** result)
+{
+  while (*s == ' ' || *s == '\t') s++;
+  if (strncmp(s, "timeout", 7) == 0 && (s[7] == ' ' || s[7] == '\t')) {
+    c->timeout = atof(s+8);
+    *result = "ok\n";
+    return 1;
+  }
+  return 0;
+}
+
+static int is_request(const char* s)
+{
+  while (*s == ' ' || *s == '\t' || *s == '\r') s++;
+  return (*s != '\n' && *s != '\0' && *s != '#');
+}
+
+/* Give idle workers the next requests, taking clients in turn. */
+static void dispatch(server_t* S, outbuf_t* line)
+{
+  int w, tries = 0;
+  for (w = 0; w < S->nworkers; w++) {
+    worker_t* W = &S->workers[w];
+    if (W->client != -1)  continue;
+    for ( ; tries < S->nclients; tries++) {
+      int ci = (S->next_client + tries) % S->nclients;
+      client_t* c = &S->clients[ci];
+      const char* result;
+      if (c->infd < 0 || c->nread - c->ndone >= (UV)S->window)  continue;
+      while (c->nread - c->ndone < (UV)S->window && client_line(c, line)) {
+        if (!is_request(line->s))  continue;
+        if (control_line(c, line->s, &result)) {
+          client_result(S, ci, c->nread++, result);
+          if (S->clients[ci].infd < 0 && S->clients[ci].outfd < 0)  break;
+          continue;
+        }
+        if (!worker_send(W, c->timeout, line->s, line->len)) {
+          worker_stop(W, 1);
+          worker_start(W, S->defcmd);
+          if (!worker_send(W, c->timeout, line->s, line->len))
+            croak("mpu-cli: can't restart worker\n");
+        }
+        W->client = ci;
+        W->seq = c->nread++;
+        /* The worker stops itself at the time limit.  This is for when
+         * it's in a step that doesn't check. */
+        W->deadline = (c->timeout > 0) ? _now() + 2*c->timeout + 1 : 0;
+        break;
+      }
+      if (W->client != -1) break;
+    }
+    if (tries >= S->nclients)  break;
+  }
+  if (S->nclients > 0)
+    S->next_client = (S->next_client + 1) % S->nclients;
+}
+
+static volatile sig_atomic_t _stop = 0;
+static void _on_signal(int sig) { (void) sig; _stop = 1; }
+
+/* The event loop.  With listenfd < 0, serve stdin/stdout until EOF.
+ * Otherwise accept connections until we get SIGINT or SIGTERM. */
+static void serve(int nworkers, int defcmd, double timeout, int listenfd)
+{
+  server_t* S;
+  outbuf_t line = {0, 0, 0}, res = {0, 0, 0};
+  int i;
+
+  signal(SIGPIPE, SIG_IGN);
+  Newz(0, S, 1, server_t);
+  S->nworkers = nworkers;
+  S->defcmd = defcmd;
+  S->window = nworkers;
+  S->timeout = timeout;
+  for (i = 0; i < MAX_CLIENTS; i++)
+    S->clients[i].infd = S->clients[i].outfd = -1;
+  for (i = 0; i < nworkers; i++)
+    worker_start(&S->workers[i], defcmd);
+  if (listenfd < 0)
+    client_open(S, 0, 1, 0);
+  else {
+    signal(SIGINT, _on_signal);
+    signal(SIGTERM, _on_signal);
+  }
+
+  while (!_stop) {
+    fd_set rset, wset;
+    struct timeval tv, *ptv = 0;
+    double now, first = 0;
+    int maxfd = -1, nactive = 0;
+
+    dispatch(S, &line);
+
+    FD_ZERO(&rset);  FD_ZERO(&wset);
+    for (i = 0; i < S->nclients; i++) {
+      client_t* c = &S->clients[i];
+      if (c->infd < 0 && c->outfd < 0)  continue;
+      /* Done with a client when its input is over and all output is out */
+      if (c->at_eof && c->inlen == 0 && c->ndone == c->nread && c->out.len == 0) {
+        if (listenfd < 0) { _stop = 1; break; }
+        client_close(S, i);
+        continue;
+      }
+      nactive++;
+      if (!c->at_eof && c->nread - c->ndone < (UV)S->window && c->inlen < 1048576) {
+        FD_SET(c->infd, &rset);
+        if (c->infd > maxfd) maxfd = c->infd;
+      }
+      if (c->out.len > 0) {
+        FD_SET(c->outfd, &wset);
+        if (c->outfd > maxfd) maxfd = c->outfd;
+      }
+    }
+    if (_stop) break;
+    for (i = 0; i < nworkers; i++) {
+      worker_t* W = &S->workers[i];
+      if (W->client == -1)  continue;
+      FD_SET(W->rfd, &rset);
+      if (W->rfd > maxfd) maxfd = W->rfd;
+      if (W->deadline > 0 && (first == 0 || W->deadline < first))
+        first = W->deadline;
+    }
+    if (listenfd >= 0 && nactive < MAX_CLIENTS) {
+      FD_SET(listenfd, &rset);
+      if (listenfd > maxfd) maxfd = listenfd;
+    }
+    if (first > 0) {
+      double wait = first - _now();
+      if (wait < 0) wait = 0;
+      tv.tv_sec = (long) wait;
+      tv.tv_usec = (long) ((wait - tv.tv_sec) * 1e6);
+      ptv = &tv;
+    }
+    if (maxfd < 0 && ptv == 0)  break;
+    if (select(maxfd+1, &rset, &wset, 0, ptv) < 0) {
+      if (errno == EINTR) continue;
+      croak("mpu-cli: select failed\n");
+    }
+
+    /* Results, and workers that died or ran out of time */
+    now = _now();
+    for (i = 0; i < nworkers; i++) {
+      worker_t* W = &S->workers[i];
+      int ci = W->client;
+      const char* msg = 0;
+      if (ci == -1)  continue;
+      if (FD_ISSET(W->rfd, &rset)) {
+        if (worker_result(W, &res)) {
+          W->client = -1;
+          if (ci >= 0) client_result(S, ci, W->seq, res.s);
+          continue;
+        }
+        msg = "error: worker failed\n";
+      } else if (W->deadline > 0 && now >= W->deadline) {
+        msg = "error: timeout\n";
+      } else {
+        continue;
+      }
+      worker_stop(W, 1);
+      worker_start(W, defcmd);
+      if (ci >= 0) client_result(S, ci, W->seq, msg);
+    }
+
+    /* Client input and output */
+    for (i = 0; i < S->nclients; i++) {
+      client_t* c = &S->clients[i];
+      if (c->outfd >= 0 && c->out.len > 0 && FD_ISSET(c->outfd, &wset))
+        client_flush(S, i);
+      if (c->infd >= 0 && !c->at_eof && FD_ISSET(c->infd, &rset)) {
+        ssize_t r;
+        if (c->inlen + 4096 > c->inalloc) {
+          c->inalloc *= 2;
+          Renew(c->in, c->inalloc, char);
+        }
+        r = read(c->infd, c->in + c->inlen, c->inalloc - c->inlen);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) c->at_eof = 1;
+        else        c->inlen += r;
+      }
+    }
+
+    if (listenfd >= 0 && FD_ISSET(listenfd, &rset)) {
+      int fd = accept(listenfd, 0, 0);
+      if (fd >= 0 && client_open(S, fd, fd, 1) < 0)
+        close(fd);
+    }
+  }
+
+  for (i = 0; i < S->nclients; i++)
+    if (S->clients[i].infd >= 0 || S->clients[i].outfd >= 0) {
+      if (listenfd < 0) { S->clients[i].infd = S->clients[i].outfd = -1; }
+      client_close(S, i);
+    }
+  for (i = 0; i < nworkers; i++)
+    worker_stop(&S->workers[i], S->workers[i].client != -1);
+  if (line.s) Safefree(line.s);
+  if (res.s) Safefree(res.s);
+  Safefree(S);
+}
+
+/* Listen on a Unix domain socket at path. */
+static int listen_socket(const char* path)
+{
+  struct sockaddr_un addr;
+  int fd;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    croak("mpu-cli: socket path too long\n");
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    croak("mpu-cli: can't create socket\n");
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+    croak("mpu-cli: can't listen on %s\n", path);
+  return fd;
+}
+
+/* Build the tables that are otherwise made on first use, so the workers
+ * start with them. */
+static void warm_up(void)
+{
+  mpz_t n;
+  mpz_init(n);
+  mpz_setbit(n, 1200);
+  _GMP_next_prime(n);             /* the pretest GCD tables */
+  init_ecpp_gcds(1000);           /* as for a first proof of 1000 bits */
+  mpz_clear(n);
+}
+
+/*****************************************************************************/
+
+static void dieusage(char* prog) {
+  int i;
+  printf("Usage: %s [options] [command] [expression ...]\n\n", prog);
+  printf("With no expressions, requests are read from stdin, one per line.\n\n");
+  printf("Options:\n");
+  printf("   -j <n>       worker processes for stdin or socket requests (default 1)\n");
+  printf("   -c <cmd>     command for lines with only an expression (default factor)\n");
+  printf("   -t <secs>    time limit per request (default none)\n");
+  printf("   -socket <p>  serve requests on the Unix domain socket p\n");
+  printf("   -v           set verbose (to stderr for stdin or socket requests)\n");
+  printf("   -help        this message\n");
+  printf("\nCommands:");
+  for (i = 0; commands[i] != 0; i++)  printf(" %s", commands[i]);
+  printf("\n\nA line \"timeout <secs>\" sets the time limit for later requests.\n");
+  exit(3);
+}
+
+int main(int argc, char **argv)
+{
+  int i, nworkers = 1, defcmd = 0;
+  double timeout = 0;
+  const char* sockpath = 0;
+
+  for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'
+              && strchr("0123456789(", argv[i][1]) == 0; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+      nworkers = atoi(argv[++i]);
+      if (nworkers < 1 || nworkers > MAX_WORKERS)  dieusage(argv[0]);
+    } else if (strcmp(argv[i], "-c") == 0 && i+1 < argc) {
+      i++;
+      defcmd = find_command(argv[i], strlen(argv[i]));
+      if (defcmd < 0)  dieusage(argv[0]);
+    } else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+      timeout = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-socket") == 0 && i+1 < argc) {
+      sockpath = argv[++i];
+    } else if (strcmp(argv[i], "-v") == 0) {
+      set_verbose_level(1);
+    } else {
+      dieusage(argv[0]);
+    }
+  }
+
+  /* A command with no expressions sets the command for stdin requests */
+  if (i == argc-1 && find_command(argv[i], strlen(argv[i])) >= 0) {
+    defcmd = find_command(argv[i], strlen(argv[i]));
+    i++;
+  }
+
+  _GMP_init();
+  if (sockpath != 0) {
+    int fd = listen_socket(sockpath);
+    warm_up();
+    serve(nworkers, defcmd, timeout, fd);
+    close(fd);
+    unlink(sockpath);
+  } else if (i < argc) {
+    int cmd = find_command(argv[i], strlen(argv[i]));
+    outbuf_t out = {0, 0, 0};
+    if (cmd >= 0) i++;
+    else          cmd = defcmd;
+    for ( ; i < argc; i++) {
+      out.len = 0;
+      run_command(cmd, argv[i], &out);
+      fputs(out.s, stdout);
+    }
+    if (out.s) Safefree(out.s);
+  } else {
+    serve(nworkers, defcmd, timeout, -1);
+  }
+  _GMP_destroy();
+  return 0;
+}
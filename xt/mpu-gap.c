@@ -0,0 +1,518 @@
+/*
+ * mpu-gap: verify prime gaps, and search for large ones.  Built with the
+ * standalone ECPP program (see xt/create-standalone.sh).
+ *
+ *   mpu-gap '1931*1933#/7230 - 30244'          verify the gap after a prime
+ *   mpu-gap -j 8 -prove '9169*439#/55230 - 6926'
+ *   mpu-gap -j 8 -merit 20 -search '1933#/7230' 1 100000
+ *
+ * Verifying sieves the interval after the start once with partial_sieve,
+ * then runs BPSW on the survivors in order until one is prime.  With -j
+ * the survivors are dealt out to worker processes, and the end is the
+ * first prime with every survivor before it known to be composite.
+ * examples/verify_primegap.pl does the same from Perl, calling is_prime on
+ * every number from a pool of threads.
+ *
+ * Searching looks at m = k*M for each k in the range, where M is the
+ * expression (usually P#/d), and finds the primes on either side of m.  A
+ * batch of k values is sieved together: M mod p is computed once per
+ * batch, and each k's window starts from k*(M mod p) with single-word
+ * arithmetic.  Each gap of at least the minimum merit is printed as
+ * "gap merit start", where the start is "k*M - b" and can be given back
+ * to verify it.  With -j each worker process takes every j-th batch.
+ *
+ * As with mpu-cli, parallel work uses processes rather than threads since
+ * the library keeps global state.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include <gmp.h>
+
+#include "ptypes.h"
+#include "gmp_main.h"
+#include "prime_iterator.h"
+#include "utility.h"
+#include "expr.h"
+
+#define MAX_WORKERS 64
+
+/* Odd-only bit array from partial_sieve */
+#define TSTAVAL(arr, val)   (arr[(val) >> 6] & (1U << (((val)>>1) & 0x1F)))
+/* Bit array for every position of a search window */
+#define TSTBIT(arr, i)      (arr[(i) >> 5] & (1U << ((i) & 0x1F)))
+#define SETBIT(arr, i)      arr[(i) >> 5] |= 1U << ((i) & 0x1F)
+
+/* Sieve depths.  Verifying tests everything up to the end of the gap, so
+ * it pays to sieve deep.  Searching mostly stops at the first prime on
+ * each side of m, and a sieving prime costs a remainder for every k, so
+ * it stops at about the depth next_prime uses. */
+#define VERIFY_DEPTH(log2n) (log2n >  32000 ? 4200000000UL : 4*log2n*log2n)
+#define SEARCH_DEPTH(log2n) (log2n > 200000 ? 4200000000UL : log2n*(log2n/10))
+/* Width of the interval verify sieves at a time, in multiples of log n */
+#define VERIFY_MERIT  40.0
+/* Bits of window sieved together in a search batch */
+#define SEARCH_BATCH_BITS (UVCONST(1) << 24)
+
+static double mpz_logn(mpz_t n)
+{
+  long exp;
+  double logn = mpz_get_d_2exp(&exp, n);
+  return log(logn) + log(2) * exp;
+}
+
+static int write_all(int fd, const char* s, size_t len)
+{
+  while (len > 0) {
+    ssize_t w = write(fd, s, len);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return 0;
+    s += w;  len -= w;
+  }
+  return 1;
+}
+
+/* Fork a worker that runs fn(w, arg) with its stdout on a pipe, and
+ * return the read end of the pipe. */
+static int worker_fork(pid_t* pid, void (*fn)(int, void*), int w, void* arg)
+{
+  int fd[2];
+  if (pipe(fd) != 0)
+    croak("mpu-gap: pipe failed\n");
+  fflush(stdout);
+  *pid = fork();
+  if (*pid < 0)
+    croak("mpu-gap: fork failed\n");
+  if (*pid == 0) {
+    close(fd[0]);
+    dup2(fd[1], 1);
+    close(fd[1]);
+    fn(w, arg);
+    fflush(stdout);
+    _exit(0);
+  }
+  close(fd[1]);
+  return fd[0];
+}
+
+static void workers_stop(pid_t* pid, int* fd, int nworkers)
+{
+  int w;
+  for (w = 0; w < nworkers; w++) {
+    if (pid[w] > 0) {
+      kill(pid[w], SIGKILL);
+      waitpid(pid[w], 0, 0);
+    }
+    if (fd[w] >= 0) close(fd[w]);
+  }
+}
+
+/*****************************************************************************/
+/* Verify */
+
+typedef struct {
+  mpz_ptr base;
+  UV*     off;
+  UV      n;
+  int     nworkers;
+} verify_job_t;
+
+/* Worker w tests survivors w, w+j, w+2j, ... and writes one byte for each,
+ * stopping after the first prime. */
+static void verify_worker(int w, void* arg)
+{
+  verify_job_t* J = (verify_job_t*) arg;
+  mpz_t t;
+  UV j;
+  mpz_init(t);
+  for (j = w; j < J->n; j += J->nworkers) {
+    char r;
+    mpz_add_ui(t, J->base, J->off[j]);
+    r = _GMP_BPSW(t) ? 'p' : 'c';
+    if (!write_all(1, &r, 1) || r == 'p') break;
+  }
+  mpz_clear(t);
+}
+
+/* Index of the first of the survivors base+off[i] that is prime, or n. */
+static UV first_prime(mpz_t base, UV* off, UV n, int nworkers)
+{
+  verify_job_t J;
+  pid_t pid[MAX_WORKERS];
+  int fd[MAX_WORKERS], w;
+  UV next[MAX_WORKERS], lo = 0;
+  char* res;
+
+  if (nworkers > 1 && n < 4*(UV)nworkers)
+    nworkers = 1;
+  if (nworkers <= 1) {
+    mpz_t t;
+    mpz_init(t);
+    for (lo = 0; lo < n; lo++) {
+      mpz_add_ui(t, base, off[lo]);
+      if (_GMP_BPSW(t)) break;
+    }
+    mpz_clear(t);
+    return lo;
+  }
+
+  J.base = base;  J.off = off;  J.n = n;  J.nworkers = nworkers;
+  Newz(0, res, n, char);
+  for (w = 0; w < nworkers; w++) {
+    fd[w] = worker_fork(&pid[w], verify_worker, w, &J);
+    next[w] = w;
+  }
+  while (1) {
+    fd_set rfds;
+    int maxfd = -1;
+    while (lo < n && res[lo] == 'c')  lo++;
+    if (lo >= n || res[lo] == 'p')  break;
+    FD_ZERO(&rfds);
+    for (w = 0; w < nworkers; w++)
+      if (fd[w] >= 0) { FD_SET(fd[w], &rfds);  if (fd[w] > maxfd) maxfd = fd[w]; }
+    if (maxfd < 0)
+      croak("mpu-gap: workers exited early\n");
+    if (select(maxfd+1, &rfds, 0, 0, 0) < 0) {
+      if (errno == EINTR) continue;
+      croak("mpu-gap: select failed\n");
+    }
+    for (w = 0; w < nworkers; w++) {
+      char buf[256];
+      ssize_t i, r;
+      if (fd[w] < 0 || !FD_ISSET(fd[w], &rfds))  continue;
+      r = read(fd[w], buf, sizeof(buf));
+      if (r < 0 && errno == EINTR)  continue;
+      if (r <= 0) {
+        /* Done: past the end, or stopped at a prime.  Otherwise it died. */
+        if (next[w] < n && (next[w] < (UV)nworkers || res[next[w]-nworkers] != 'p'))
+          croak("mpu-gap: worker %d exited early\n", w);
+        close(fd[w]);  fd[w] = -1;
+        continue;
+      }
+      for (i = 0; i < r; i++) {
+        res[next[w]] = buf[i];
+        next[w] += nworkers;
+      }
+    }
+  }
+  workers_stop(pid, fd, nworkers);
+  Safefree(res);
+  return lo;
+}
+
+/* Set end to the first prime after start, sieving VERIFY_MERIT*log(n)
+ * numbers at a time.  Returns the gap. */
+static UV verify_next_prime(mpz_t end, mpz_t start, int nworkers, UV depth)
+{
+  UV log2n = mpz_sizeinbase(start, 2);
+  UV width = (UV) (VERIFY_MERIT/1.4427 * (double)log2n + 0.5);
+  UV *off, i, n;
+  uint32_t* comp;
+  mpz_t base;
+
+  if (log2n <= 120) {
+    mpz_set(end, start);
+    _GMP_next_prime(end);
+    mpz_sub(end, end, start);
+    i = mpz_get_ui(end);
+    mpz_add(end, end, start);
+    return i;
+  }
+  if (depth == 0)  depth = VERIFY_DEPTH(log2n);
+  if (width & 1) width++;
+  New(0, off, width/2+1, UV);
+  mpz_init(base);
+  mpz_add_ui(end, start, mpz_even_p(start) ? 1 : 2);   /* first odd after */
+  while (1) {
+    mpz_set(base, end);
+    comp = partial_sieve(base, width, depth);          /* base = end-1 */
+    for (i = 1, n = 0; i <= width; i += 2)
+      if (!TSTAVAL(comp, i))
+        off[n++] = i;
+    Safefree(comp);
+    if (get_verbose_level())
+      fprintf(stderr, "  sieved %lu to depth %lu, %lu candidates\n",
+              (unsigned long)width, (unsigned long)depth, (unsigned long)n);
+    i = first_prime(base, off, n, nworkers);
+    if (i < n) {
+      mpz_add_ui(end, base, off[i]);
+      break;
+    }
+    mpz_add_ui(end, base, width+1);
+  }
+  mpz_sub(base, end, start);   /* the gap, which fits in a UV */
+  i = mpz_get_ui(base);
+  mpz_clear(base);
+  Safefree(off);
+  return i;
+}
+
+static const char* primality_text(mpz_t n, int prove)
+{
+  int r = prove ? _GMP_is_provable_prime(n, 0) : _GMP_BPSW(n);
+  return (r == 0) ? "composite"
+       : (r == 2) ? "proven prime"
+       :            "probable prime (BPSW)";
+}
+
+static int verify(const char* expr, int nworkers, UV depth, int prove)
+{
+  mpz_t start, end;
+  UV gap;
+  int isprime;
+
+  mpz_init(start);  mpz_init(end);
+  if (mpz_expr(start, 10, expr) || mpz_sgn(start) <= 0)
+    croak("mpu-gap: can't evaluate \"%s\"\n", expr);
+  isprime = _GMP_BPSW(start);
+  printf("start (%lu digits) is %s\n", (unsigned long)mpz_sizeinbase(start, 10),
+         isprime ? primality_text(start, prove) : "composite");
+  fflush(stdout);
+  gap = verify_next_prime(end, start, nworkers, depth);
+  printf("end n+%lu is %s\n", (unsigned long)gap, primality_text(end, prove));
+  printf("gap %lu merit %.4f\n", (unsigned long)gap, (double)gap / mpz_logn(start));
+  mpz_clear(start);  mpz_clear(end);
+  return isprime;
+}
+
+/*****************************************************************************/
+/* Search */
+
+typedef struct {
+  mpz_t  M;
+  const char* mexpr;
+  UV     k1, k2;
+  UV     W;             /* window each side of m */
+  UV     batch;         /* k values per batch */
+  UV     depth;
+  double minmerit;
+  int    prove;
+  int    nworkers;
+} search_t;
+
+/* Sieve windows [k*M-W, k*M+W] for k = k1..k2 into comp, one window of
+ * 2W+1 bits every words words. */
+static void search_sieve(search_t* S, uint32_t* comp, UV words, UV k1, UV k2)
+{
+  UV span = 2*S->W+1, p;
+  PRIME_ITERATOR(iter);
+  for (p = 2; p <= S->depth; p = prime_iterator_next(&iter)) {
+    UV r = mpz_fdiv_ui(S->M, p), wr = S->W % p, k;
+    uint32_t* c = comp;
+    for (k = k1; k <= k2; k++, c += words) {
+      UV lomod = ((k % p) * r + (p - wr)) % p;       /* (k*M - W) mod p */
+      UV pos = (lomod == 0) ? 0 : p - lomod;
+      for ( ; pos < span; pos += p)
+        SETBIT(c, pos);
+    }
+  }
+  prime_iterator_destroy(&iter);
+}
+
+static void search_batch(search_t* S, UV k1, UV k2, mpz_t m, mpz_t lo, mpz_t t)
+{
+  UV span = 2*S->W+1, words = (span+31)/32, k, i, a, b;
+  uint32_t* comp;
+
+  Newz(0, comp, (k2-k1+1)*words, uint32_t);
+  search_sieve(S, comp, words, k1, k2);
+  for (k = k1; k <= k2; k++) {
+    uint32_t* c = comp + (k-k1)*words;
+    double logm, merit;
+    mpz_mul_ui(m, S->M, k);
+    mpz_sub_ui(lo, m, S->W);
+    logm = mpz_logn(m);
+    /* Next prime at or after m */
+    for (i = S->W; i < span; i++) {
+      if (TSTBIT(c, i))  continue;
+      mpz_add_ui(t, lo, i);
+      if (_GMP_BPSW(t))  break;
+    }
+    if (i < span) {
+      a = i - S->W;
+    } else {
+      mpz_add_ui(t, lo, span-1);
+      _GMP_next_prime(t);
+      mpz_sub(t, t, m);
+      a = mpz_get_ui(t);
+    }
+    /* Previous prime before m.  Stop early if the gap is already short. */
+    for (i = S->W; i-- > 0; ) {
+      if (TSTBIT(c, i))  continue;
+      mpz_add_ui(t, lo, i);
+      if (_GMP_BPSW(t))  break;
+    }
+    if (i != UV_MAX && (double)(a + S->W - i) / logm < S->minmerit)
+      continue;
+    if (i != UV_MAX) {
+      b = S->W - i;
+    } else {
+      mpz_set(t, lo);
+      _GMP_prev_prime(t);
+      mpz_sub(t, m, t);
+      b = mpz_get_ui(t);
+    }
+    merit = (double)(a + b) / logm;
+    if (merit < S->minmerit)  continue;
+    printf("%lu %.4f %lu*%s - %lu", (unsigned long)(a+b), merit,
+           (unsigned long)k, S->mexpr, (unsigned long)b);
+    if (S->prove) {
+      mpz_sub_ui(t, m, b);
+      printf("  %s", primality_text(t, 1));
+      mpz_add_ui(t, m, a);
+      printf(", %s", primality_text(t, 1));
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+  Safefree(comp);
+}
+
+/* Batches w, w+j, w+2j, ... */
+static void search_worker(int w, void* arg)
+{
+  search_t* S = (search_t*) arg;
+  UV k1;
+  mpz_t m, lo, t;
+  mpz_init(m);  mpz_init(lo);  mpz_init(t);
+  for (k1 = S->k1 + w*S->batch;  k1 <= S->k2;  k1 += S->nworkers*S->batch) {
+    UV k2 = (S->k2 - k1 < S->batch) ? S->k2 : k1 + S->batch - 1;
+    search_batch(S, k1, k2, m, lo, t);
+    if (get_verbose_level())
+      fprintf(stderr, "  k %lu to %lu done\n", (unsigned long)k1, (unsigned long)k2);
+    if (k2 == S->k2) break;
+  }
+  mpz_clear(m);  mpz_clear(lo);  mpz_clear(t);
+}
+
+static void search(const char* mexpr, UV k1, UV k2, double minmerit,
+                   int nworkers, UV depth, int prove)
+{
+  search_t S;
+  pid_t pid[MAX_WORKERS];
+  int fd[MAX_WORKERS], w, nopen;
+  UV log2n;
+
+  mpz_init(S.M);
+  if (mpz_expr(S.M, 10, mexpr) || mpz_sgn(S.M) <= 0)
+    croak("mpu-gap: can't evaluate \"%s\"\n", mexpr);
+  if (k1 < 1 || k2 < k1)
+    croak("mpu-gap: bad k range %lu to %lu\n", (unsigned long)k1, (unsigned long)k2);
+  S.mexpr = mexpr;  S.k1 = k1;  S.k2 = k2;
+  S.minmerit = minmerit;  S.prove = prove;  S.nworkers = nworkers;
+  mpz_mul_ui(S.M, S.M, k2);
+  log2n = mpz_sizeinbase(S.M, 2);
+  /* Half the wanted gap each side, so the window rarely runs out. */
+  S.W = (UV) (((minmerit < 8) ? 4 : minmerit/2) * mpz_logn(S.M)) + 1;
+  mpz_divexact_ui(S.M, S.M, k2);
+  S.depth = (depth > 0) ? depth : SEARCH_DEPTH(log2n);
+#if BITS_PER_WORD == 32
+  if (S.depth > 65535)  S.depth = 65535;       /* (k mod p) * r fits */
+#endif
+  if (mpz_cmp_ui(S.M, S.depth + S.W) <= 0)
+    croak("mpu-gap: M is too small for a sieve to depth %lu\n", (unsigned long)S.depth);
+  S.batch = SEARCH_BATCH_BITS / (2*S.W+1);
+  if (S.batch < 1)  S.batch = 1;
+  if (S.batch > (k2-k1)/nworkers + 1)  S.batch = (k2-k1)/nworkers + 1;
+  if (get_verbose_level())
+    fprintf(stderr, "  window %lu, depth %lu, %lu k per batch\n",
+            (unsigned long)(2*S.W), (unsigned long)S.depth, (unsigned long)S.batch);
+
+  if (nworkers <= 1) {
+    search_worker(0, &S);
+  } else {
+    for (w = 0; w < nworkers; w++)
+      fd[w] = worker_fork(&pid[w], search_worker, w, &S);
+    /* Pass the workers' lines through as they come. */
+    for (nopen = nworkers; nopen > 0; ) {
+      fd_set rfds;
+      int maxfd = -1;
+      FD_ZERO(&rfds);
+      for (w = 0; w < nworkers; w++)
+        if (fd[w] >= 0) { FD_SET(fd[w], &rfds);  if (fd[w] > maxfd) maxfd = fd[w]; }
+      if (select(maxfd+1, &rfds, 0, 0, 0) < 0) {
+        if (errno == EINTR) continue;
+        croak("mpu-gap: select failed\n");
+      }
+      for (w = 0; w < nworkers; w++) {
+        char buf[4096];
+        ssize_t r;
+        if (fd[w] < 0 || !FD_ISSET(fd[w], &rfds))  continue;
+        r = read(fd[w], buf, sizeof(buf));
+        if (r < 0 && errno == EINTR)  continue;
+        if (r <= 0) {
+          close(fd[w]);  fd[w] = -1;  nopen--;
+          waitpid(pid[w], 0, 0);  pid[w] = 0;
+          continue;
+        }
+        fwrite(buf, 1, r, stdout);
+        fflush(stdout);
+      }
+    }
+  }
+  mpz_clear(S.M);
+}
+
+/*****************************************************************************/
+
+static void dieusage(char* prog) {
+  printf("Usage: %s [options] <start>\n", prog);
+  printf("       %s [options] -search <M> <k1> <k2>\n\n", prog);
+  printf("The first form finds the gap after start, usually given as an expression\n");
+  printf("such as \"1931*1933#/7230 - 30244\".  The second prints each gap around\n");
+  printf("k*M for k1 <= k <= k2 with at least the minimum merit.\n\n");
+  printf("Options:\n");
+  printf("   -j <n>       worker processes (default 1)\n");
+  printf("   -depth <n>   sieve with primes up to n (default depends on size)\n");
+  printf("   -merit <m>   minimum merit for -search (default 15)\n");
+  printf("   -prove       prove the endpoints rather than BPSW\n");
+  printf("   -v           set verbose\n");
+  printf("   -help        this message\n");
+  exit(3);
+}
+
+int main(int argc, char **argv)
+{
+  int i, nworkers = 1, prove = 0, do_search = 0, ret = 0;
+  UV depth = 0;
+  double minmerit = 15;
+
+  for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'
+              && strchr("0123456789(", argv[i][1]) == 0; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+      nworkers = atoi(argv[++i]);
+      if (nworkers < 1 || nworkers > MAX_WORKERS)  dieusage(argv[0]);
+    } else if (strcmp(argv[i], "-depth") == 0 && i+1 < argc) {
+      depth = strtoul(argv[++i], 0, 10);
+    } else if (strcmp(argv[i], "-merit") == 0 && i+1 < argc) {
+      minmerit = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-prove") == 0) {
+      prove = 1;
+    } else if (strcmp(argv[i], "-search") == 0) {
+      do_search = 1;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      set_verbose_level(1);
+    } else {
+      dieusage(argv[0]);
+    }
+  }
+  if (i != argc - (do_search ? 3 : 1))
+    dieusage(argv[0]);
+
+  _GMP_init();
+  if (do_search)
+    search(argv[i], strtoul(argv[i+1], 0, 10), strtoul(argv[i+2], 0, 10),
+           minmerit, nworkers, depth, prove);
+  else
+    ret = !verify(argv[i], nworkers, depth, prove);
+  _GMP_destroy();
+  return ret;
+}